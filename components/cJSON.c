@@ -49,6 +49,12 @@
 #include <locale.h>
 #endif
 
+/* the structural index of cJSON_LazyParse is built 16 bytes at a time where SSE2 is available */
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__)) && !defined(CJSON_DISABLE_SIMD)
+#include <emmintrin.h>
+#define CJSON_SSE2_INDEX
+#endif
+
 #if defined(_MSC_VER)
 #pragma warning (pop)
 #endif
@@ -129,6 +135,21 @@ CJSON_PUBLIC(const char*) cJSON_Version(void)
     return version;
 }
 
+/* ASCII case folding table. Keys are compared ignoring ASCII case only, which is what tolower does in the "C" locale. */
+#define identity_row(row) \
+    (row), (row) + 1, (row) + 2, (row) + 3, (row) + 4, (row) + 5, (row) + 6, (row) + 7, \
+    (row) + 8, (row) + 9, (row) + 10, (row) + 11, (row) + 12, (row) + 13, (row) + 14, (row) + 15
+static const unsigned char ascii_lowercase[256] =
+{
+    identity_row(0x00), identity_row(0x10), identity_row(0x20), identity_row(0x30),
+    0x40, 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o',
+    'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z', 0x5B, 0x5C, 0x5D, 0x5E, 0x5F,
+    identity_row(0x60), identity_row(0x70),
+    identity_row(0x80), identity_row(0x90), identity_row(0xA0), identity_row(0xB0),
+    identity_row(0xC0), identity_row(0xD0), identity_row(0xE0), identity_row(0xF0)
+};
+#undef identity_row
+
 /* Case insensitive string comparison, doesn't consider two NULL pointers equal though */
 static int case_insensitive_strcmp(const unsigned char *string1, const unsigned char *string2)
 {
@@ -142,7 +163,7 @@ static int case_insensitive_strcmp(const unsigned char *string1, const unsigned
         return 0;
     }
 
-    for(; tolower(*string1) == tolower(*string2); (void)string1++, string2++)
+    for(; ascii_lowercase[*string1] == ascii_lowercase[*string2]; (void)string1++, string2++)
     {
         if (*string1 == '\0')
         {
@@ -150,7 +171,52 @@ static int case_insensitive_strcmp(const unsigned char *string1, const unsigned
         }
     }
 
-    return tolower(*string1) - tolower(*string2);
+    return ascii_lowercase[*string1] - ascii_lowercase[*string2];
+}
+
+/* Keys up to this length are folded once per lookup instead of once per comparison */
+#ifndef CJSON_FOLDED_KEY_LENGTH
+#define CJSON_FOLDED_KEY_LENGTH 64
+#endif
+
+/* Fold string into folded (which holds CJSON_FOLDED_KEY_LENGTH bytes), returns false if it doesn't fit */
+static cJSON_bool fold_key(const unsigned char *string, unsigned char *folded, size_t *length)
+{
+    size_t i = 0;
+
+    for (i = 0; i < CJSON_FOLDED_KEY_LENGTH; i++)
+    {
+        folded[i] = ascii_lowercase[string[i]];
+        if (string[i] == '\0')
+        {
+            *length = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* Compare a key folded by fold_key with string, ignoring case */
+static cJSON_bool case_insensitive_equals(const unsigned char *folded, size_t length, const unsigned char *string)
+{
+    size_t i = 0;
+
+    if (string == NULL)
+    {
+        return false;
+    }
+
+    /* the terminator of a shorter string mismatches here as well, so string is never read past its end */
+    for (i = 0; i < length; i++)
+    {
+        if (ascii_lowercase[string[i]] != folded[i])
+        {
+            return false;
+        }
+    }
+
+    return string[length] == '\0';
 }
 
 typedef struct internal_hooks
@@ -293,6 +359,7 @@ typedef struct
     size_t offset;
     size_t depth; /* How deeply nested (in arrays/objects) is the input at the current offset. */
     internal_hooks hooks;
+    int hints; /* cJSON_Packed* and cJSON_ValidateUTF8 flags passed to cJSON_ParseWithLengthHints, 0 otherwise */
 } parse_buffer;
 
 /* check if the given size is left to read in a given parse buffer (starting with 1) */
@@ -309,6 +376,7 @@ static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_bu
     double number = 0;
     unsigned char *after_end = NULL;
     unsigned char *number_c_string;
+    unsigned char number_c_string_stack[64]; /* short numbers don't need an allocation */
     unsigned char decimal_point = get_decimal_point();
     size_t i = 0;
     size_t number_string_length = 0;
@@ -353,11 +421,18 @@ static cJSON_bool parse_number(cJSON * const item, parse_buffer * const input_bu
         }
     }
 loop_end:
-    /* malloc for temporary buffer, add 1 for '\0' */
-    number_c_string = (unsigned char *) input_buffer->hooks.allocate(number_string_length + 1);
-    if (number_c_string == NULL)
+    if (number_string_length < sizeof(number_c_string_stack))
+    {
+        number_c_string = number_c_string_stack;
+    }
+    else
     {
-        return false; /* allocation failure */
+        /* malloc for temporary buffer, add 1 for '\0' */
+        number_c_string = (unsigned char *) input_buffer->hooks.allocate(number_string_length + 1);
+        if (number_c_string == NULL)
+        {
+            return false; /* allocation failure */
+        }
     }
 
     memcpy(number_c_string, buffer_at_offset(input_buffer), number_string_length);
@@ -379,7 +454,10 @@ loop_end:
     if (number_c_string == after_end)
     {
         /* free the temporary buffer */
-        input_buffer->hooks.deallocate(number_c_string);
+        if (number_c_string != number_c_string_stack)
+        {
+            input_buffer->hooks.deallocate(number_c_string);
+        }
         return false; /* parse_error */
     }
 
@@ -403,7 +481,10 @@ loop_end:
 
     input_buffer->offset += (size_t)(after_end - number_c_string);
     /* free the temporary buffer */
-    input_buffer->hooks.deallocate(number_c_string);
+    if (number_c_string != number_c_string_stack)
+    {
+        input_buffer->hooks.deallocate(number_c_string);
+    }
     return true;
 }
 
@@ -587,30 +668,21 @@ static cJSON_bool compare_double(double a, double b)
     return (fabs(a - b) <= maxVal * DBL_EPSILON);
 }
 
-/* Render the number nicely from the given item into a string. */
-static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
+/* Render a double into number_buffer (at least 26 bytes), returns the length or a negative value on failure.
+ * valueint is the saturated integer value of d, as kept in cJSON.valueint. */
+static int print_double_to_buffer(double d, int valueint, unsigned char * const number_buffer)
 {
-    unsigned char *output_pointer = NULL;
-    double d = item->valuedouble;
     int length = 0;
-    size_t i = 0;
-    unsigned char number_buffer[26] = {0}; /* temporary buffer to print the number into */
-    unsigned char decimal_point = get_decimal_point();
     double test = 0.0;
 
-    if (output_buffer == NULL)
-    {
-        return false;
-    }
-
     /* This checks for NaN and Infinity */
     if (isnan(d) || isinf(d))
     {
         length = sprintf((char*)number_buffer, "null");
     }
-    else if(d == (double)item->valueint)
+    else if(d == (double)valueint)
     {
-        length = sprintf((char*)number_buffer, "%d", item->valueint);
+        length = sprintf((char*)number_buffer, "%d", valueint);
     }
     else
     {
@@ -625,8 +697,18 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
         }
     }
 
+    return length;
+}
+
+/* Copy a number rendered by sprintf to the output, replacing the locale dependent decimal point with '.' */
+static cJSON_bool print_number_buffer(const unsigned char * const number_buffer, int length, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+    unsigned char decimal_point = get_decimal_point();
+    size_t i = 0;
+
     /* sprintf failed or buffer overrun occurred */
-    if ((length < 0) || (length > (int)(sizeof(number_buffer) - 1)))
+    if ((length < 0) || (length > 25))
     {
         return false;
     }
@@ -638,8 +720,6 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
         return false;
     }
 
-    /* copy the printed number to the output and replace locale
-     * dependent decimal point with '.' */
     for (i = 0; i < ((size_t)length); i++)
     {
         if (number_buffer[i] == decimal_point)
@@ -657,6 +737,113 @@ static cJSON_bool print_number(const cJSON * const item, printbuffer * const out
     return true;
 }
 
+/* Render the number nicely from the given item into a string. */
+static cJSON_bool print_number(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char number_buffer[26] = {0}; /* temporary buffer to print the number into */
+
+    if (output_buffer == NULL)
+    {
+        return false;
+    }
+
+    return print_number_buffer(number_buffer, print_double_to_buffer(item->valuedouble, item->valueint, number_buffer), output_buffer);
+}
+
+/* saturating conversion of a double to the int kept in cJSON.valueint */
+static int saturate_to_int(double number)
+{
+    if (number >= INT_MAX)
+    {
+        return INT_MAX;
+    }
+    else if (number <= (double)INT_MIN)
+    {
+        return INT_MIN;
+    }
+
+    return (int)number;
+}
+
+/* size of one element of a packed array, 0 if packed_type isn't exactly one cJSON_Packed* flag */
+static size_t packed_element_size(int packed_type)
+{
+    switch (packed_type & cJSON_Packed)
+    {
+        case cJSON_PackedInt:
+            return sizeof(int);
+        case cJSON_PackedFloat:
+            return sizeof(float);
+        case cJSON_PackedDouble:
+            return sizeof(double);
+        default:
+            return 0;
+    }
+}
+
+/* get element "index" of a packed array as a double */
+static double get_packed_number(const cJSON * const array, size_t index)
+{
+    switch (array->type & cJSON_Packed)
+    {
+        case cJSON_PackedInt:
+            return (double)((const int*)array->valuestring)[index];
+        case cJSON_PackedFloat:
+            return (double)((const float*)array->valuestring)[index];
+        default:
+            return ((const double*)array->valuestring)[index];
+    }
+}
+
+/* Render an int without going through sprintf */
+static int print_int_to_buffer(int number, unsigned char * const number_buffer)
+{
+    unsigned char digits[12];
+    size_t digit_count = 0;
+    int length = 0;
+    /* work with the magnitude as unsigned so that INT_MIN doesn't overflow */
+    unsigned int magnitude = (number < 0) ? (0U - (unsigned int)number) : (unsigned int)number;
+
+    do
+    {
+        digits[digit_count++] = (unsigned char)('0' + (magnitude % 10));
+        magnitude /= 10;
+    }
+    while (magnitude != 0);
+
+    if (number < 0)
+    {
+        number_buffer[length++] = '-';
+    }
+    while (digit_count > 0)
+    {
+        number_buffer[length++] = digits[--digit_count];
+    }
+    number_buffer[length] = '\0';
+
+    return length;
+}
+
+/* Render a float with the fewest digits that still read back as the same float */
+static int print_float_to_buffer(float number, unsigned char * const number_buffer)
+{
+    int length = 0;
+    float test = 0.0f;
+
+    if (isnan(number) || isinf(number))
+    {
+        return sprintf((char*)number_buffer, "null");
+    }
+
+    length = sprintf((char*)number_buffer, "%1.7g", (double)number);
+    if ((sscanf((char*)number_buffer, "%g", &test) != 1) || (test != number))
+    {
+        length = sprintf((char*)number_buffer, "%1.9g", (double)number);
+    }
+
+    return length;
+}
+
 /* parse 4 digit hexadecimal number */
 static unsigned parse_hex4(const unsigned char * const input)
 {
@@ -815,54 +1002,12 @@ fail:
     return 0;
 }
 
-/* Parse the input text into an unescaped cinput, and populate item. */
-static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
+/* Unescape the string literal from input_pointer up to input_end (the closing quote) into output, which has to
+ * hold at least (input_end - input_pointer) + 1 bytes. On failure *error_pointer is set to the offending escape sequence. */
+static cJSON_bool unescape_string(const unsigned char *input_pointer, const unsigned char * const input_end, unsigned char * const output, const unsigned char ** const error_pointer)
 {
-    const unsigned char *input_pointer = buffer_at_offset(input_buffer) + 1;
-    const unsigned char *input_end = buffer_at_offset(input_buffer) + 1;
-    unsigned char *output_pointer = NULL;
-    unsigned char *output = NULL;
+    unsigned char *output_pointer = output;
 
-    /* not a string */
-    if (buffer_at_offset(input_buffer)[0] != '\"')
-    {
-        goto fail;
-    }
-
-    {
-        /* calculate approximate size of the output (overestimate) */
-        size_t allocation_length = 0;
-        size_t skipped_bytes = 0;
-        while (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (*input_end != '\"'))
-        {
-            /* is escape sequence */
-            if (input_end[0] == '\\')
-            {
-                if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
-                {
-                    /* prevent buffer overflow when last input character is a backslash */
-                    goto fail;
-                }
-                skipped_bytes++;
-                input_end++;
-            }
-            input_end++;
-        }
-        if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
-        {
-            goto fail; /* string ended unexpectedly */
-        }
-
-        /* This is at most how much we need for the output */
-        allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
-        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
-        if (output == NULL)
-        {
-            goto fail; /* allocation failure */
-        }
-    }
-
-    output_pointer = output;
     /* loop through the string literal */
     while (input_pointer < input_end)
     {
@@ -922,147 +1067,353 @@ static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_bu
     /* zero terminate the output */
     *output_pointer = '\0';
 
-    item->type = cJSON_String;
-    item->valuestring = (char*)output;
-
-    input_buffer->offset = (size_t) (input_end - input_buffer->content);
-    input_buffer->offset++;
-
     return true;
 
 fail:
-    if (output != NULL)
-    {
-        input_buffer->hooks.deallocate(output);
-        output = NULL;
-    }
-
-    if (input_pointer != NULL)
-    {
-        input_buffer->offset = (size_t)(input_pointer - input_buffer->content);
-    }
+    *error_pointer = input_pointer;
 
     return false;
 }
 
-/* Render the cstring provided to an escaped version that can be printed. */
-static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
+/* Strict UTF-8 validation (cJSON_ValidateUTF8).
+ * Lead bytes 0xC0 - 0xFF map to one of the classes in utf8_sequences, which give the length of the sequence and the
+ * range of its second byte. This rejects overlong encodings, surrogates and code points above U+10FFFF. */
+static const unsigned char utf8_lead_class[64] =
 {
-    const unsigned char *input_pointer = NULL;
-    unsigned char *output = NULL;
-    unsigned char *output_pointer = NULL;
-    size_t output_length = 0;
-    /* numbers of additional characters needed for escaping */
-    size_t escape_characters = 0;
+    0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 0xC0 - 0xCF */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, /* 0xD0 - 0xDF */
+    2, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 4, 3, 3, /* 0xE0 - 0xEF */
+    5, 6, 6, 6, 7, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0  /* 0xF0 - 0xFF */
+};
 
-    if (output_buffer == NULL)
+typedef struct
+{
+    unsigned char length;
+    unsigned char second_min;
+    unsigned char second_max;
+} utf8_sequence;
+
+static const utf8_sequence utf8_sequences[8] =
+{
+    { 0, 0, 0 }, /* invalid lead byte */
+    { 2, 0x80, 0xBF },
+    { 3, 0xA0, 0xBF }, /* 0xE0: no overlong encodings */
+    { 3, 0x80, 0xBF },
+    { 3, 0x80, 0x9F }, /* 0xED: no surrogates */
+    { 4, 0x90, 0xBF }, /* 0xF0: no overlong encodings */
+    { 4, 0x80, 0xBF },
+    { 4, 0x80, 0x8F } /* 0xF4: nothing above U+10FFFF */
+};
+
+/* length of the valid UTF-8 sequence that starts with the non-ASCII byte at input_pointer, 0 if it is invalid */
+static size_t utf8_sequence_length(const unsigned char * const input_pointer, const unsigned char * const input_end)
+{
+    const utf8_sequence *sequence = NULL;
+    size_t i = 0;
+
+    if (input_pointer[0] < 0xC0)
     {
-        return false;
+        return 0; /* continuation byte without a lead byte */
     }
 
-    /* empty string */
-    if (input == NULL)
+    sequence = &utf8_sequences[utf8_lead_class[input_pointer[0] - 0xC0]];
+    if ((sequence->length == 0) || ((size_t)(input_end - input_pointer) < sequence->length))
     {
-        output = ensure(output_buffer, sizeof("\"\""));
-        if (output == NULL)
-        {
-            return false;
-        }
-        strcpy((char*)output, "\"\"");
-
-        return true;
+        return 0;
     }
-
-    /* set "flag" to 1 if something needs to be escaped */
-    for (input_pointer = input; *input_pointer; input_pointer++)
+    if ((input_pointer[1] < sequence->second_min) || (input_pointer[1] > sequence->second_max))
     {
-        switch (*input_pointer)
+        return 0;
+    }
+    for (i = 2; i < sequence->length; i++)
+    {
+        if ((input_pointer[i] & 0xC0) != 0x80)
         {
-            case '\"':
-            case '\\':
-            case '\b':
-            case '\f':
-            case '\n':
-            case '\r':
-            case '\t':
-                /* one character escape sequence */
-                escape_characters++;
-                break;
-            default:
-                if (*input_pointer < 32)
-                {
-                    /* UTF-16 escape sequence uXXXX */
-                    escape_characters += 5;
-                }
-                break;
+            return 0;
         }
     }
-    output_length = (size_t)(input_pointer - input) + escape_characters;
 
-    output = ensure(output_buffer, output_length + sizeof("\"\""));
-    if (output == NULL)
-    {
-        return false;
-    }
+    return sequence->length;
+}
 
-    /* no characters have to be escaped */
-    if (escape_characters == 0)
-    {
-        output[0] = '\"';
-        memcpy(output + 1, input, output_length);
-        output[output_length + 1] = '\"';
-        output[output_length + 2] = '\0';
+/* true if word contains only ASCII bytes and neither a quote nor a backslash */
+static cJSON_bool is_plain_ascii_word(size_t word)
+{
+    const size_t ones = ((size_t)-1) / 0xFF;
+    const size_t high_bits = ones * 0x80;
+    const size_t quotes = word ^ (ones * '\"');
+    const size_t backslashes = word ^ (ones * '\\');
 
-        return true;
-    }
+    /* (x - ones) & ~x has the high bit of a byte set if x has a zero byte */
+    return ((word | ((quotes - ones) & ~quotes) | ((backslashes - ones) & ~backslashes)) & high_bits) == 0;
+}
 
-    output[0] = '\"';
-    output_pointer = output + 1;
-    /* copy the string */
-    for (input_pointer = input; *input_pointer != '\0'; (void)input_pointer++, output_pointer++)
+/* Find the closing quote of a string like the scan in parse_string, but check that it is valid UTF-8 on the way.
+ * Runs of plain ASCII are skipped a word at a time. On failure, input_end points to the invalid byte. */
+static cJSON_bool scan_utf8_string(const unsigned char ** const input_end, const unsigned char * const buffer_end, size_t * const skipped_bytes)
+{
+    const unsigned char *input_pointer = *input_end;
+
+    while (input_pointer < buffer_end)
     {
-        if ((*input_pointer > 31) && (*input_pointer != '\"') && (*input_pointer != '\\'))
+        size_t word = 0;
+
+        if ((size_t)(buffer_end - input_pointer) >= sizeof(word))
         {
-            /* normal character, copy */
-            *output_pointer = *input_pointer;
+            memcpy(&word, input_pointer, sizeof(word));
+            if (is_plain_ascii_word(word))
+            {
+                input_pointer += sizeof(word);
+                continue;
+            }
+        }
+
+        if (input_pointer[0] == '\"')
+        {
+            break;
+        }
+        else if (input_pointer[0] == '\\')
+        {
+            /* the escaped character is checked by unescape_string */
+            (*skipped_bytes)++;
+            input_pointer += 2;
+        }
+        else if (input_pointer[0] < 0x80)
+        {
+            input_pointer++;
         }
         else
         {
-            /* character needs to be escaped */
-            *output_pointer++ = '\\';
-            switch (*input_pointer)
+            size_t sequence_length = utf8_sequence_length(input_pointer, buffer_end);
+            if (sequence_length == 0)
             {
-                case '\\':
-                    *output_pointer = '\\';
-                    break;
-                case '\"':
-                    *output_pointer = '\"';
-                    break;
-                case '\b':
-                    *output_pointer = 'b';
-                    break;
-                case '\f':
-                    *output_pointer = 'f';
-                    break;
-                case '\n':
-                    *output_pointer = 'n';
-                    break;
-                case '\r':
-                    *output_pointer = 'r';
-                    break;
-                case '\t':
-                    *output_pointer = 't';
-                    break;
-                default:
-                    /* escape and print as unicode codepoint */
-                    sprintf((char*)output_pointer, "u%04x", *input_pointer);
-                    output_pointer += 4;
-                    break;
+                *input_end = input_pointer;
+                return false;
+            }
+            input_pointer += sequence_length;
+        }
+    }
+
+    /* parse_string checks whether the closing quote was found */
+    *input_end = (input_pointer < buffer_end) ? input_pointer : buffer_end;
+    return true;
+}
+
+/* Parse the input text into an unescaped cinput, and populate item. */
+static cJSON_bool parse_string(cJSON * const item, parse_buffer * const input_buffer)
+{
+    const unsigned char *input_pointer = buffer_at_offset(input_buffer) + 1;
+    const unsigned char *input_end = buffer_at_offset(input_buffer) + 1;
+    unsigned char *output = NULL;
+
+    /* not a string */
+    if (buffer_at_offset(input_buffer)[0] != '\"')
+    {
+        goto fail;
+    }
+
+    {
+        /* calculate approximate size of the output (overestimate) */
+        size_t allocation_length = 0;
+        size_t skipped_bytes = 0;
+        if (input_buffer->hints & cJSON_ValidateUTF8)
+        {
+            if (!scan_utf8_string(&input_end, input_buffer->content + input_buffer->length, &skipped_bytes))
+            {
+                input_pointer = input_end;
+                goto fail; /* invalid UTF-8 */
+            }
+        }
+        else
+        {
+            while (((size_t)(input_end - input_buffer->content) < input_buffer->length) && (*input_end != '\"'))
+            {
+                /* is escape sequence */
+                if (input_end[0] == '\\')
+                {
+                    if ((size_t)(input_end + 1 - input_buffer->content) >= input_buffer->length)
+                    {
+                        /* prevent buffer overflow when last input character is a backslash */
+                        goto fail;
+                    }
+                    skipped_bytes++;
+                    input_end++;
+                }
+                input_end++;
+            }
+        }
+        if (((size_t)(input_end - input_buffer->content) >= input_buffer->length) || (*input_end != '\"'))
+        {
+            goto fail; /* string ended unexpectedly */
+        }
+
+        /* This is at most how much we need for the output */
+        allocation_length = (size_t) (input_end - buffer_at_offset(input_buffer)) - skipped_bytes;
+        output = (unsigned char*)input_buffer->hooks.allocate(allocation_length + sizeof(""));
+        if (output == NULL)
+        {
+            goto fail; /* allocation failure */
+        }
+    }
+
+    if (!unescape_string(input_pointer, input_end, output, &input_pointer))
+    {
+        goto fail;
+    }
+
+    item->type = cJSON_String;
+    item->valuestring = (char*)output;
+
+    input_buffer->offset = (size_t) (input_end - input_buffer->content);
+    input_buffer->offset++;
+
+    return true;
+
+fail:
+    if (output != NULL)
+    {
+        input_buffer->hooks.deallocate(output);
+        output = NULL;
+    }
+
+    if (input_pointer != NULL)
+    {
+        input_buffer->offset = (size_t)(input_pointer - input_buffer->content);
+    }
+
+    return false;
+}
+
+/* Escape sequences for print_string_ptr: the character after the backslash, 'u' for \u00XX and 0 if the
+ * character is printed as is. Everything from 0x60 on is 0. */
+static const unsigned char escape_sequences[256] =
+{
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+    'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0, 0, '\"', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, '\\', 0, 0, 0
+};
+
+/* true if word contains a byte that escape_sequences escapes: a control character, a quote or a backslash */
+static cJSON_bool word_needs_escape(size_t word)
+{
+    const size_t ones = ((size_t)-1) / 0xFF;
+    const size_t high_bits = ones * 0x80;
+    const size_t quotes = word ^ (ones * '\"');
+    const size_t backslashes = word ^ (ones * '\\');
+
+    /* (x - ones * n) & ~x has the high bit of a byte set if x has a byte below n (for n <= 0x80) */
+    return ((((word - ones * 0x20) & ~word) | ((quotes - ones) & ~quotes) | ((backslashes - ones) & ~backslashes)) & high_bits) != 0;
+}
+
+/* Render the cstring provided to an escaped version that can be printed.
+ * The offset is moved past it, so the update_offset of the caller doesn't count its length again. */
+static cJSON_bool print_string_ptr(const unsigned char * const input, printbuffer * const output_buffer)
+{
+    static const unsigned char hex_digits[] = "0123456789abcdef";
+    const unsigned char *input_pointer = NULL;
+    unsigned char *output = NULL;
+    unsigned char *output_pointer = NULL;
+    size_t input_length = 0;
+    size_t output_length = 0;
+    /* numbers of additional characters needed for escaping */
+    size_t escape_characters = 0;
+
+    if (output_buffer == NULL)
+    {
+        return false;
+    }
+
+    /* empty string */
+    if (input == NULL)
+    {
+        output = ensure(output_buffer, sizeof("\"\""));
+        if (output == NULL)
+        {
+            return false;
+        }
+        strcpy((char*)output, "\"\"");
+        output_buffer->offset += 2;
+
+        return true;
+    }
+
+    /* count the additional characters needed for escape sequences, skipping words without any */
+    input_length = strlen((const char*)input);
+    for (input_pointer = input; input_pointer < input + input_length; input_pointer++)
+    {
+        size_t word = 0;
+        if ((size_t)(input + input_length - input_pointer) >= sizeof(word))
+        {
+            memcpy(&word, input_pointer, sizeof(word));
+            if (!word_needs_escape(word))
+            {
+                input_pointer += sizeof(word) - 1;
+                continue;
             }
         }
+        if (escape_sequences[*input_pointer] != 0)
+        {
+            /* \uXXXX takes 5 more characters, all others one */
+            escape_characters += (escape_sequences[*input_pointer] == 'u') ? 5 : 1;
+        }
+    }
+    output_length = input_length + escape_characters;
+
+    output = ensure(output_buffer, output_length + sizeof("\"\""));
+    if (output == NULL)
+    {
+        return false;
+    }
+
+    /* no characters have to be escaped */
+    if (escape_characters == 0)
+    {
+        output[0] = '\"';
+        memcpy(output + 1, input, output_length);
+        output[output_length + 1] = '\"';
+        output[output_length + 2] = '\0';
+        output_buffer->offset += output_length + 2;
+
+        return true;
+    }
+
+    output[0] = '\"';
+    output_pointer = output + 1;
+    input_pointer = input;
+    for (;;)
+    {
+        /* copy the run of characters up to the next one that needs escaping (the terminating '\0' does as well) */
+        const unsigned char *run_start = input_pointer;
+        while (escape_sequences[*input_pointer] == 0)
+        {
+            input_pointer++;
+        }
+        memcpy(output_pointer, run_start, (size_t)(input_pointer - run_start));
+        output_pointer += input_pointer - run_start;
+
+        if (*input_pointer == '\0')
+        {
+            break;
+        }
+
+        *output_pointer++ = '\\';
+        *output_pointer++ = escape_sequences[*input_pointer];
+        if (escape_sequences[*input_pointer] == 'u')
+        {
+            /* control character as unicode codepoint */
+            *output_pointer++ = '0';
+            *output_pointer++ = '0';
+            *output_pointer++ = hex_digits[*input_pointer >> 4];
+            *output_pointer++ = hex_digits[*input_pointer & 0x0F];
+        }
+        input_pointer++;
     }
     output[output_length + 1] = '\"';
     output[output_length + 2] = '\0';
+    output_buffer->offset += output_length + 2;
 
     return true;
 }
@@ -1139,9 +1490,9 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return
 }
 
 /* Parse an object - create a new root, and populate. */
-CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+static cJSON *parse_root(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated, int hints)
 {
-    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 } };
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, 0 };
     cJSON *item = NULL;
 
     /* reset error position */
@@ -1157,6 +1508,7 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer
     buffer.length = buffer_length;
     buffer.offset = 0;
     buffer.hooks = global_hooks;
+    buffer.hints = hints;
 
     item = cJSON_New_Item(&global_hooks);
     if (item == NULL) /* memory fail */
@@ -1218,6 +1570,16 @@ fail:
     return NULL;
 }
 
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated)
+{
+    return parse_root(value, buffer_length, return_parse_end, require_null_terminated, 0);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthHints(const char *value, size_t buffer_length, int hints)
+{
+    return parse_root(value, buffer_length, 0, 0, hints & (cJSON_Packed | cJSON_ValidateUTF8));
+}
+
 /* Default options for cJSON_Parse */
 CJSON_PUBLIC(cJSON *) cJSON_Parse(const char *value)
 {
@@ -1229,6 +1591,128 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
     return cJSON_ParseWithLengthOpts(value, buffer_length, 0, 0);
 }
 
+CJSON_PUBLIC(void) cJSON_InitStream(cJSON_Stream *stream, const char *value, size_t length, cJSON_bool final)
+{
+    if (stream == NULL)
+    {
+        return;
+    }
+
+    stream->hints = 0;
+    cJSON_FeedStream(stream, value, length, final);
+}
+
+CJSON_PUBLIC(void) cJSON_FeedStream(cJSON_Stream *stream, const char *value, size_t length, cJSON_bool final)
+{
+    if (stream == NULL)
+    {
+        return;
+    }
+
+    stream->content = (value != NULL) ? value : "";
+    stream->length = (value != NULL) ? length : 0;
+    stream->offset = 0;
+    stream->final = final;
+    stream->status = cJSON_StreamOk;
+    stream->error_offset = 0;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_ParseStreamNext(cJSON_Stream *stream, size_t *record_start, size_t *record_end)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, 0 };
+    const unsigned char *content = NULL;
+    const unsigned char *line_end = NULL;
+    size_t start = 0;
+    size_t end = 0;
+    size_t document_end = 0;
+    cJSON *item = NULL;
+
+    if ((stream == NULL) || (stream->content == NULL))
+    {
+        return NULL;
+    }
+    content = (const unsigned char*)stream->content;
+
+    /* skip blank lines */
+    while ((stream->offset < stream->length) && (content[stream->offset] <= 32))
+    {
+        stream->offset++;
+    }
+    if (stream->offset >= stream->length)
+    {
+        stream->status = stream->final ? cJSON_StreamEnd : cJSON_StreamNeedMore;
+        return NULL;
+    }
+
+    start = stream->offset;
+    line_end = (const unsigned char*)memchr(content + start, '\n', stream->length - start);
+    if (line_end != NULL)
+    {
+        end = (size_t)(line_end - content);
+        stream->offset = end + 1;
+    }
+    else if (stream->final)
+    {
+        end = stream->length;
+        stream->offset = end;
+    }
+    else
+    {
+        /* the record continues in the next chunk */
+        stream->status = cJSON_StreamNeedMore;
+        return NULL;
+    }
+
+    /* the parse buffer only covers this record, so a document can't run into the next one */
+    buffer.content = content + start;
+    buffer.length = end - start;
+    buffer.offset = 0;
+    buffer.hooks = global_hooks;
+    buffer.hints = stream->hints;
+
+    item = cJSON_New_Item(&global_hooks);
+    if (item == NULL) /* memory fail */
+    {
+        goto fail;
+    }
+
+    if (!parse_value(item, buffer_skip_whitespace(&buffer)))
+    {
+        goto fail;
+    }
+    document_end = start + buffer.offset;
+
+    /* only whitespace may follow the document */
+    buffer_skip_whitespace(&buffer);
+    if ((buffer.offset < buffer.length) && (buffer_at_offset(&buffer)[0] > 32))
+    {
+        goto fail;
+    }
+
+    if (record_start != NULL)
+    {
+        *record_start = start;
+    }
+    if (record_end != NULL)
+    {
+        *record_end = document_end;
+    }
+    stream->status = cJSON_StreamOk;
+
+    return item;
+
+fail:
+    if (item != NULL)
+    {
+        cJSON_Delete(item);
+    }
+
+    stream->status = cJSON_StreamError;
+    stream->error_offset = start + ((buffer.offset < buffer.length) ? buffer.offset : buffer.length);
+
+    return NULL;
+}
+
 #define cjson_min(a, b) (((a) < (b)) ? (a) : (b))
 
 static unsigned char *print(const cJSON * const item, cJSON_bool format, const internal_hooks * const hooks)
@@ -1488,27 +1972,135 @@ static cJSON_bool print_value(const cJSON * const item, printbuffer * const outp
     }
 }
 
-/* Build an array from input text. */
-static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer)
+/* Try to parse the elements of an array into one packed block of the type requested in input_buffer->hints.
+ * The offset has to be at the first element. Returns false (with the offset unchanged) if the array contains
+ * anything that doesn't fit the packed type, so that it can be parsed as a regular array instead. */
+static cJSON_bool parse_packed_array(cJSON * const item, parse_buffer * const input_buffer)
 {
-    cJSON *head = NULL; /* head of the linked list */
-    cJSON *current_item = NULL;
+    const size_t element_size = packed_element_size(input_buffer->hints);
+    const size_t start_offset = input_buffer->offset;
+    unsigned char *elements = NULL;
+    size_t capacity = 0;
+    size_t count = 0;
+    cJSON number = { NULL, NULL, NULL, 0, NULL, 0, 0, NULL };
 
-    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
+    if (element_size == 0)
     {
-        return false; /* to deeply nested */
+        return false;
     }
-    input_buffer->depth++;
 
-    if (buffer_at_offset(input_buffer)[0] != '[')
+    for (;;)
     {
-        /* not an array */
-        goto fail;
-    }
+        buffer_skip_whitespace(input_buffer);
+        if (cannot_access_at_index(input_buffer, 0) || !((buffer_at_offset(input_buffer)[0] == '-') || ((buffer_at_offset(input_buffer)[0] >= '0') && (buffer_at_offset(input_buffer)[0] <= '9'))))
+        {
+            goto fail; /* not a number */
+        }
+        if (!parse_number(&number, input_buffer))
+        {
+            goto fail;
+        }
+        if ((input_buffer->hints & cJSON_PackedInt) && (number.valuedouble != (double)number.valueint))
+        {
+            goto fail; /* doesn't fit an int */
+        }
 
-    input_buffer->offset++;
-    buffer_skip_whitespace(input_buffer);
-    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ']'))
+        if (count == capacity)
+        {
+            /* grow the block geometrically */
+            size_t new_capacity = (capacity == 0) ? 16 : capacity * 2;
+            unsigned char *new_elements = NULL;
+            if (new_capacity > ((size_t)INT_MAX / element_size))
+            {
+                goto fail; /* count has to fit valueint */
+            }
+            if (input_buffer->hooks.reallocate != NULL)
+            {
+                new_elements = (unsigned char*)input_buffer->hooks.reallocate(elements, new_capacity * element_size);
+            }
+            else
+            {
+                new_elements = (unsigned char*)input_buffer->hooks.allocate(new_capacity * element_size);
+                if ((new_elements != NULL) && (elements != NULL))
+                {
+                    memcpy(new_elements, elements, count * element_size);
+                    input_buffer->hooks.deallocate(elements);
+                }
+            }
+            if (new_elements == NULL)
+            {
+                goto fail; /* allocation failure */
+            }
+            elements = new_elements;
+            capacity = new_capacity;
+        }
+
+        switch (input_buffer->hints & cJSON_Packed)
+        {
+            case cJSON_PackedInt:
+                ((int*)elements)[count] = number.valueint;
+                break;
+            case cJSON_PackedFloat:
+                ((float*)elements)[count] = (float)number.valuedouble;
+                break;
+            default:
+                ((double*)elements)[count] = number.valuedouble;
+                break;
+        }
+        count++;
+
+        buffer_skip_whitespace(input_buffer);
+        if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != ','))
+        {
+            break;
+        }
+        input_buffer->offset++;
+    }
+
+    if (cannot_access_at_index(input_buffer, 0) || buffer_at_offset(input_buffer)[0] != ']')
+    {
+        goto fail; /* something else than a number, or not the end of the array */
+    }
+
+    item->type = cJSON_Array | (input_buffer->hints & cJSON_Packed);
+    item->valuestring = (char*)elements;
+    item->valueint = (int)count;
+
+    input_buffer->offset++;
+
+    return true;
+
+fail:
+    if (elements != NULL)
+    {
+        input_buffer->hooks.deallocate(elements);
+    }
+    input_buffer->offset = start_offset;
+
+    return false;
+}
+
+/* Build an array from input text. */
+static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buffer)
+{
+    cJSON *head = NULL; /* head of the linked list */
+    cJSON *current_item = NULL;
+
+    if (input_buffer->depth >= CJSON_NESTING_LIMIT)
+    {
+        return false; /* to deeply nested */
+    }
+    input_buffer->depth++;
+
+    if (buffer_at_offset(input_buffer)[0] != '[')
+    {
+        /* not an array */
+        goto fail;
+    }
+
+    input_buffer->offset++;
+    buffer_skip_whitespace(input_buffer);
+    if (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ']'))
     {
         /* empty array */
         goto success;
@@ -1521,6 +2113,13 @@ static cJSON_bool parse_array(cJSON * const item, parse_buffer * const input_buf
         goto fail;
     }
 
+    /* arrays of numbers can be stored packed if the caller asked for it */
+    if ((input_buffer->hints & cJSON_Packed) && parse_packed_array(item, input_buffer))
+    {
+        input_buffer->depth--;
+        return true;
+    }
+
     /* step back to character in front of the first element */
     input_buffer->offset--;
     /* loop through the comma separated array elements */
@@ -1586,6 +2185,79 @@ fail:
     return false;
 }
 
+/* Render the elements of a packed array to text */
+static cJSON_bool print_packed_array(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+    unsigned char number_buffer[26] = {0};
+    size_t separator_length = (size_t) (output_buffer->format ? 2 : 1);
+    size_t count = (item->valueint > 0) ? (size_t)item->valueint : 0;
+    size_t i = 0;
+    int length = 0;
+
+    if ((count > 0) && (item->valuestring == NULL))
+    {
+        return false;
+    }
+
+    output_pointer = ensure(output_buffer, 1);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+    *output_pointer = '[';
+    output_buffer->offset++;
+
+    for (i = 0; i < count; i++)
+    {
+        switch (item->type & cJSON_Packed)
+        {
+            case cJSON_PackedInt:
+                length = print_int_to_buffer(((const int*)item->valuestring)[i], number_buffer);
+                break;
+            case cJSON_PackedFloat:
+                length = print_float_to_buffer(((const float*)item->valuestring)[i], number_buffer);
+                break;
+            default:
+            {
+                double number = ((const double*)item->valuestring)[i];
+                length = print_double_to_buffer(number, saturate_to_int(number), number_buffer);
+                break;
+            }
+        }
+        if (!print_number_buffer(number_buffer, length, output_buffer))
+        {
+            return false;
+        }
+
+        if ((i + 1) < count)
+        {
+            output_pointer = ensure(output_buffer, separator_length + 1);
+            if (output_pointer == NULL)
+            {
+                return false;
+            }
+            *output_pointer++ = ',';
+            if (output_buffer->format)
+            {
+                *output_pointer++ = ' ';
+            }
+            *output_pointer = '\0';
+            output_buffer->offset += separator_length;
+        }
+    }
+
+    output_pointer = ensure(output_buffer, 2);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+    *output_pointer++ = ']';
+    *output_pointer = '\0';
+
+    return true;
+}
+
 /* Render an array to text */
 static cJSON_bool print_array(const cJSON * const item, printbuffer * const output_buffer)
 {
@@ -1598,6 +2270,11 @@ static cJSON_bool print_array(const cJSON * const item, printbuffer * const outp
         return false;
     }
 
+    if (item->type & cJSON_Packed)
+    {
+        return print_packed_array(item, output_buffer);
+    }
+
     /* Compose the output array. */
     /* opening square bracket */
     output_pointer = ensure(output_buffer, 1);
@@ -1737,147 +2414,1427 @@ static cJSON_bool parse_object(cJSON * const item, parse_buffer * const input_bu
         }
         buffer_skip_whitespace(input_buffer);
     }
-    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
+    while (can_access_at_index(input_buffer, 0) && (buffer_at_offset(input_buffer)[0] == ','));
+
+    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '}'))
+    {
+        goto fail; /* expected end of object */
+    }
+
+success:
+    input_buffer->depth--;
+
+    if (head != NULL) {
+        head->prev = current_item;
+    }
+
+    item->type = cJSON_Object;
+    item->child = head;
+
+    input_buffer->offset++;
+    return true;
+
+fail:
+    if (head != NULL)
+    {
+        cJSON_Delete(head);
+    }
+
+    return false;
+}
+
+/* Render an object to text. */
+static cJSON_bool print_object(const cJSON * const item, printbuffer * const output_buffer)
+{
+    unsigned char *output_pointer = NULL;
+    size_t length = 0;
+    cJSON *current_item = item->child;
+
+    if (output_buffer == NULL)
+    {
+        return false;
+    }
+
+    /* Compose the output: */
+    length = (size_t) (output_buffer->format ? 2 : 1); /* fmt: {\n */
+    output_pointer = ensure(output_buffer, length + 1);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+
+    *output_pointer++ = '{';
+    output_buffer->depth++;
+    if (output_buffer->format)
+    {
+        *output_pointer++ = '\n';
+    }
+    output_buffer->offset += length;
+
+    while (current_item)
+    {
+        if (output_buffer->format)
+        {
+            output_pointer = ensure(output_buffer, output_buffer->depth);
+            if (output_pointer == NULL)
+            {
+                return false;
+            }
+            memset(output_pointer, '\t', output_buffer->depth);
+            output_buffer->offset += output_buffer->depth;
+        }
+
+        /* print key */
+        if (!print_string_ptr((unsigned char*)current_item->string, output_buffer))
+        {
+            return false;
+        }
+        update_offset(output_buffer);
+
+        length = (size_t) (output_buffer->format ? 2 : 1);
+        output_pointer = ensure(output_buffer, length);
+        if (output_pointer == NULL)
+        {
+            return false;
+        }
+        *output_pointer++ = ':';
+        if (output_buffer->format)
+        {
+            *output_pointer++ = '\t';
+        }
+        output_buffer->offset += length;
+
+        /* print value */
+        if (!print_value(current_item, output_buffer))
+        {
+            return false;
+        }
+        update_offset(output_buffer);
+
+        /* print comma if not last */
+        length = ((size_t)(output_buffer->format ? 1 : 0) + (size_t)(current_item->next ? 1 : 0));
+        output_pointer = ensure(output_buffer, length + 1);
+        if (output_pointer == NULL)
+        {
+            return false;
+        }
+        if (current_item->next)
+        {
+            *output_pointer++ = ',';
+        }
+
+        if (output_buffer->format)
+        {
+            *output_pointer++ = '\n';
+        }
+        *output_pointer = '\0';
+        output_buffer->offset += length;
+
+        current_item = current_item->next;
+    }
+
+    output_pointer = ensure(output_buffer, output_buffer->format ? (output_buffer->depth + 1) : 2);
+    if (output_pointer == NULL)
+    {
+        return false;
+    }
+    if (output_buffer->format)
+    {
+        memset(output_pointer, '\t', output_buffer->depth - 1);
+        output_pointer += output_buffer->depth - 1;
+    }
+    *output_pointer++ = '}';
+    *output_pointer = '\0';
+    output_buffer->depth--;
+
+    return true;
+}
+
+/* Structural index (used by cJSON_LazyParse).
+ * Records the offset of every structural character ({ } [ ] : ,) outside of strings and of both
+ * quotes of every string, so the parts of the document that aren't looked into are never scanned
+ * byte by byte again. */
+typedef struct
+{
+    unsigned int *positions;
+    size_t count;
+    size_t capacity;
+    cJSON_bool escapes; /* a string has a backslash in it */
+} structural_index;
+
+typedef struct
+{
+    cJSON_bool in_string;
+    size_t escaped_position; /* the byte after a backslash in a string, which is never structural */
+} structural_scan;
+
+/* make room for at least needed more entries */
+static cJSON_bool structural_index_reserve(structural_index * const index, size_t needed, const internal_hooks * const hooks)
+{
+    if ((index->capacity - index->count) < needed)
+    {
+        size_t new_capacity = index->capacity * 2;
+        unsigned int *new_positions = NULL;
+
+        if (new_capacity > ((size_t)-1 / sizeof(unsigned int)))
+        {
+            return false;
+        }
+        if (hooks->reallocate != NULL)
+        {
+            new_positions = (unsigned int*)hooks->reallocate(index->positions, new_capacity * sizeof(unsigned int));
+        }
+        else
+        {
+            new_positions = (unsigned int*)hooks->allocate(new_capacity * sizeof(unsigned int));
+            if (new_positions != NULL)
+            {
+                memcpy(new_positions, index->positions, index->count * sizeof(unsigned int));
+                hooks->deallocate(index->positions);
+            }
+        }
+        if (new_positions == NULL)
+        {
+            return false;
+        }
+        index->positions = new_positions;
+        index->capacity = new_capacity;
+    }
+
+    return true;
+}
+
+/* Feed one quote, backslash or structural character at position to the stage 1 state machine,
+ * the caller has reserved space for it in the index */
+static void structural_index_byte(structural_index * const index, structural_scan * const scan, unsigned char c, size_t position)
+{
+    if ((c == 'Y') || (c == 'y') || (c == '_') || (c == 0x7F))
+    {
+        return; /* false positives of the SSE2 bracket test */
+    }
+
+    if (scan->in_string)
+    {
+        if ((position == scan->escaped_position) && (position != 0))
+        {
+            return;
+        }
+        if (c == '\\')
+        {
+            scan->escaped_position = position + 1;
+            index->escapes = true;
+        }
+        else if (c == '\"')
+        {
+            scan->in_string = false;
+            index->positions[index->count++] = (unsigned int)position;
+        }
+        return;
+    }
+
+    if (c == '\"')
+    {
+        scan->in_string = true;
+    }
+    else if (c == '\\')
+    {
+        /* invalid outside of a string, lazy_validate rejects it because it isn't indexed */
+        return;
+    }
+
+    index->positions[index->count++] = (unsigned int)position;
+}
+
+static cJSON_bool build_structural_index(const unsigned char * const content, size_t length, structural_index * const index, const internal_hooks * const hooks)
+{
+    structural_scan scan = { false, 0 };
+    size_t position = 0;
+
+    if (length >= UINT_MAX)
+    {
+        return false; /* offsets are stored as unsigned int */
+    }
+
+    /* a guess at the density of structural characters, the index grows if needed */
+    index->count = 0;
+    index->escapes = false;
+    index->capacity = (length / 8) + 16;
+    index->positions = (unsigned int*)hooks->allocate(index->capacity * sizeof(unsigned int));
+    if (index->positions == NULL)
+    {
+        return false;
+    }
+
+#ifdef CJSON_SSE2_INDEX
+    {
+        const __m128i quote = _mm_set1_epi8('\"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i colon = _mm_set1_epi8(':');
+        const __m128i comma = _mm_set1_epi8(',');
+        /* '[' ']' '{' '}' only differ in bits 0x20 and 0x06: OR-ing in 0x26 maps all of them to '\x7F' */
+        const __m128i bracket_bits = _mm_set1_epi8(0x26);
+        const __m128i bracket = _mm_set1_epi8(0x7F);
+
+        for (; (position + 16) <= length; position += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128((const __m128i*)(const void*)(content + position));
+            __m128i interesting = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash));
+            unsigned int mask = 0;
+
+            interesting = _mm_or_si128(interesting, _mm_cmpeq_epi8(chunk, colon));
+            interesting = _mm_or_si128(interesting, _mm_cmpeq_epi8(chunk, comma));
+            interesting = _mm_or_si128(interesting, _mm_cmpeq_epi8(_mm_or_si128(chunk, bracket_bits), bracket));
+            mask = (unsigned int)_mm_movemask_epi8(interesting);
+            if ((mask != 0) && !structural_index_reserve(index, 16, hooks))
+            {
+                return false;
+            }
+
+            while (mask != 0)
+            {
+                size_t byte_position = position + (size_t)__builtin_ctz(mask);
+                unsigned char c = content[byte_position];
+                mask &= mask - 1;
+
+                structural_index_byte(index, &scan, c, byte_position);
+            }
+        }
+    }
+#endif
+
+    for (; position < length; position++)
+    {
+        switch (content[position])
+        {
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+            case '\"':
+            case '\\':
+                if (!structural_index_reserve(index, 1, hooks))
+                {
+                    return false;
+                }
+                structural_index_byte(index, &scan, content[position], position);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return true;
+}
+
+/* On-demand parsing (cJSON_LazyParse and the cJSON_Cursor functions).
+ * The document is indexed by build_structural_index and checked for well-formed structure once,
+ * which also pairs every opening bracket and quote with its partner in match. After that a cursor is just
+ * a byte range in the input: strings are only unescaped and numbers only converted by the getters, and
+ * containers that aren't looked into are stepped over with a single lookup in match. */
+#define LAZY_NO_PARENT ((unsigned int)-1)
+
+typedef enum
+{
+    lazy_expect_value,
+    lazy_expect_value_or_close, /* after '[' */
+    lazy_expect_key,
+    lazy_expect_key_or_close, /* after '{' */
+    lazy_expect_colon,
+    lazy_after_value
+} lazy_state;
+
+static size_t lazy_skip_whitespace(const cJSON_Lazy * const document, size_t position)
+{
+    while ((position < document->length) && (document->content[position] <= 32) && (document->content[position] != '\0'))
+    {
+        position++;
+    }
+
+    return position;
+}
+
+static cJSON_bool lazy_is_structural(const cJSON_Lazy * const document, size_t slot, size_t position)
+{
+    return (slot < document->count) && (document->index[slot] == position);
+}
+
+static cJSON_bool is_scalar_character(unsigned char c)
+{
+    return ((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || (c == '+') || (c == '-') || (c == '.');
+}
+
+/* check that the bytes from start to end are a literal or a number as JSON defines it */
+static cJSON_bool lazy_scalar_is_valid(const unsigned char *start, const unsigned char *end)
+{
+    const size_t length = (size_t)(end - start);
+
+    if (((length == 4) && (strncmp((const char*)start, "true", 4) == 0))
+        || ((length == 5) && (strncmp((const char*)start, "false", 5) == 0))
+        || ((length == 4) && (strncmp((const char*)start, "null", 4) == 0)))
+    {
+        return true;
+    }
+
+    /* -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)? */
+    if ((start < end) && (*start == '-'))
+    {
+        start++;
+    }
+    if ((start == end) || (*start < '0') || (*start > '9'))
+    {
+        return false;
+    }
+    if (*start++ != '0')
+    {
+        while ((start < end) && (*start >= '0') && (*start <= '9'))
+        {
+            start++;
+        }
+    }
+    if ((start < end) && (*start == '.'))
+    {
+        start++;
+        if ((start == end) || (*start < '0') || (*start > '9'))
+        {
+            return false;
+        }
+        while ((start < end) && (*start >= '0') && (*start <= '9'))
+        {
+            start++;
+        }
+    }
+    if ((start < end) && ((*start == 'e') || (*start == 'E')))
+    {
+        start++;
+        if ((start < end) && ((*start == '+') || (*start == '-')))
+        {
+            start++;
+        }
+        if ((start == end) || (*start < '0') || (*start > '9'))
+        {
+            return false;
+        }
+        while ((start < end) && (*start >= '0') && (*start <= '9'))
+        {
+            start++;
+        }
+    }
+
+    return start == end;
+}
+
+/* Check the structure of the indexed document and fill in match. While a container is open, its match entry
+ * holds the slot of the enclosing container, so the nesting needs no stack. */
+static cJSON_bool lazy_validate(cJSON_Lazy * const document, size_t * const error_position)
+{
+    lazy_state state = lazy_expect_value;
+    unsigned int parent = LAZY_NO_PARENT;
+    size_t depth = 0;
+    size_t slot = 0;
+    size_t position = 0;
+
+    /* skip the UTF-8 BOM */
+    if ((document->length >= 3) && (strncmp((const char*)document->content, "\xEF\xBB\xBF", 3) == 0))
+    {
+        position = 3;
+    }
+
+    for (;;)
+    {
+        unsigned char c = '\0';
+
+        position = lazy_skip_whitespace(document, position);
+        *error_position = position;
+
+        if ((state == lazy_after_value) && (parent == LAZY_NO_PARENT))
+        {
+            /* the root value is complete, only a '\0' may follow */
+            return (slot == document->count) && ((position == document->length) || (document->content[position] == '\0'));
+        }
+
+        if (!lazy_is_structural(document, slot, position))
+        {
+            const size_t scalar_start = position;
+
+            if ((state != lazy_expect_value) && (state != lazy_expect_value_or_close))
+            {
+                return false;
+            }
+
+            while ((position < document->length) && is_scalar_character(document->content[position]))
+            {
+                position++;
+            }
+            if (!lazy_scalar_is_valid(document->content + scalar_start, document->content + position))
+            {
+                return false;
+            }
+            state = lazy_after_value;
+            continue;
+        }
+
+        c = document->content[position];
+        switch (c)
+        {
+            case '\"':
+                if ((state == lazy_after_value) || (state == lazy_expect_colon) || ((slot + 1) >= document->count))
+                {
+                    return false;
+                }
+                document->match[slot] = (unsigned int)(slot + 1);
+                document->match[slot + 1] = (unsigned int)slot;
+                position = document->index[slot + 1] + 1;
+                slot += 2;
+                state = ((state == lazy_expect_key) || (state == lazy_expect_key_or_close)) ? lazy_expect_colon : lazy_after_value;
+                break;
+
+            case '{':
+            case '[':
+                if ((state != lazy_expect_value) && (state != lazy_expect_value_or_close))
+                {
+                    return false;
+                }
+                if (++depth > CJSON_NESTING_LIMIT)
+                {
+                    return false;
+                }
+                document->match[slot] = parent;
+                parent = (unsigned int)slot;
+                state = (c == '{') ? lazy_expect_key_or_close : lazy_expect_value_or_close;
+                slot++;
+                position++;
+                break;
+
+            case '}':
+            case ']':
+                if ((parent == LAZY_NO_PARENT)
+                    || (document->content[document->index[parent]] != ((c == '}') ? '{' : '['))
+                    || ((state != lazy_after_value) && (state != lazy_expect_key_or_close) && (state != lazy_expect_value_or_close)))
+                {
+                    return false;
+                }
+                {
+                    const unsigned int grandparent = document->match[parent];
+                    document->match[parent] = (unsigned int)slot;
+                    document->match[slot] = parent;
+                    parent = grandparent;
+                }
+                depth--;
+                state = lazy_after_value;
+                slot++;
+                position++;
+                break;
+
+            case ':':
+                if (state != lazy_expect_colon)
+                {
+                    return false;
+                }
+                state = lazy_expect_value;
+                slot++;
+                position++;
+                break;
+
+            case ',':
+                if ((state != lazy_after_value) || (parent == LAZY_NO_PARENT))
+                {
+                    return false;
+                }
+                state = (document->content[document->index[parent]] == '{') ? lazy_expect_key : lazy_expect_value;
+                slot++;
+                position++;
+                break;
+
+            default:
+                return false;
+        }
+    }
+}
+
+CJSON_PUBLIC(cJSON_Lazy *) cJSON_LazyParse(const char *value, size_t buffer_length)
+{
+    structural_index index = { NULL, 0, 0, false };
+    cJSON_Lazy *document = NULL;
+    size_t error_position = 0;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if ((value == NULL) || (buffer_length == 0))
+    {
+        goto fail;
+    }
+
+    document = (cJSON_Lazy*)global_hooks.allocate(sizeof(cJSON_Lazy));
+    if (document == NULL)
+    {
+        goto fail;
+    }
+    memset(document, '\0', sizeof(cJSON_Lazy));
+    document->content = (const unsigned char*)value;
+    document->length = buffer_length;
+
+    if (!build_structural_index(document->content, document->length, &index, &global_hooks))
+    {
+        goto fail;
+    }
+    document->index = index.positions;
+    document->count = index.count;
+    index.positions = NULL;
+
+    document->match = (unsigned int*)global_hooks.allocate((document->count + 1) * sizeof(unsigned int));
+    if (document->match == NULL)
+    {
+        goto fail;
+    }
+
+    if (!lazy_validate(document, &error_position))
+    {
+        goto fail;
+    }
+
+    return document;
+
+fail:
+    if (index.positions != NULL)
+    {
+        global_hooks.deallocate(index.positions);
+    }
+    cJSON_LazyDelete(document);
+
+    if (value != NULL)
+    {
+        global_error.json = (const unsigned char*)value;
+        global_error.position = ((error_position < buffer_length) || (buffer_length == 0)) ? error_position : buffer_length - 1;
+    }
+
+    return NULL;
+}
+
+CJSON_PUBLIC(void) cJSON_LazyDelete(cJSON_Lazy *document)
+{
+    if (document == NULL)
+    {
+        return;
+    }
+    if (document->index != NULL)
+    {
+        global_hooks.deallocate(document->index);
+    }
+    if (document->match != NULL)
+    {
+        global_hooks.deallocate(document->match);
+    }
+    global_hooks.deallocate(document);
+}
+
+/* point cursor at the value that starts at position (after whitespace), slot is the first index entry at or after it */
+static void lazy_cursor_at(const cJSON_Lazy * const document, size_t position, size_t slot, size_t key_slot, cJSON_Cursor * const cursor)
+{
+    position = lazy_skip_whitespace(document, position);
+
+    cursor->document = document;
+    cursor->start = position;
+    cursor->key_slot = key_slot;
+
+    if (lazy_is_structural(document, slot, position))
+    {
+        /* string or container: it ends at its partner */
+        const size_t closing = document->match[slot];
+        cursor->slot = slot;
+        cursor->end = document->index[closing] + 1;
+        cursor->next_slot = closing + 1;
+    }
+    else
+    {
+        size_t end = position;
+        while ((end < document->length) && is_scalar_character(document->content[end]))
+        {
+            end++;
+        }
+        cursor->slot = slot;
+        cursor->end = end;
+        cursor->next_slot = slot;
+    }
+}
+
+/* point cursor at the member whose key starts at key_slot */
+static void lazy_cursor_at_member(const cJSON_Lazy * const document, size_t key_slot, cJSON_Cursor * const cursor)
+{
+    /* key_slot and key_slot + 1 are the quotes, key_slot + 2 the colon */
+    lazy_cursor_at(document, document->index[key_slot + 2] + 1, key_slot + 3, key_slot, cursor);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_LazyRoot(const cJSON_Lazy *document, cJSON_Cursor *cursor)
+{
+    size_t position = 0;
+
+    if ((document == NULL) || (cursor == NULL))
+    {
+        return false;
+    }
+
+    if ((document->length >= 3) && (strncmp((const char*)document->content, "\xEF\xBB\xBF", 3) == 0))
+    {
+        position = 3;
+    }
+    lazy_cursor_at(document, position, 0, (size_t)-1, cursor);
+
+    return true;
+}
+
+CJSON_PUBLIC(int) cJSON_CursorType(const cJSON_Cursor *cursor)
+{
+    if ((cursor == NULL) || (cursor->document == NULL) || (cursor->start >= cursor->end))
+    {
+        return cJSON_Invalid;
+    }
+
+    switch (cursor->document->content[cursor->start])
+    {
+        case '{':
+            return cJSON_Object;
+        case '[':
+            return cJSON_Array;
+        case '\"':
+            return cJSON_String;
+        case 't':
+            return cJSON_True;
+        case 'f':
+            return cJSON_False;
+        case 'n':
+            return cJSON_NULL;
+        default:
+            return cJSON_Number;
+    }
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_CursorChild(const cJSON_Cursor *container, cJSON_Cursor *child)
+{
+    const cJSON_Lazy *document = NULL;
+    size_t position = 0;
+    int type = cJSON_CursorType(container);
+
+    if (((type != cJSON_Array) && (type != cJSON_Object)) || (child == NULL))
+    {
+        return false;
+    }
+    document = container->document;
+
+    /* empty container */
+    position = lazy_skip_whitespace(document, container->start + 1);
+    if (position == (container->end - 1))
+    {
+        return false;
+    }
+
+    if (type == cJSON_Object)
+    {
+        lazy_cursor_at_member(document, container->slot + 1, child);
+    }
+    else
+    {
+        lazy_cursor_at(document, position, container->slot + 1, (size_t)-1, child);
+    }
+
+    return true;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_CursorNext(const cJSON_Cursor *item, cJSON_Cursor *next)
+{
+    const cJSON_Lazy *document = NULL;
+    size_t separator = 0;
+
+    if ((item == NULL) || (item->document == NULL) || (next == NULL))
+    {
+        return false;
+    }
+    document = item->document;
+
+    /* the index entry after a value is a comma or the end of its container */
+    separator = item->next_slot;
+    if ((separator >= document->count) || (document->content[document->index[separator]] != ','))
+    {
+        return false;
+    }
+
+    if (item->key_slot != (size_t)-1)
+    {
+        lazy_cursor_at_member(document, separator + 1, next);
+    }
+    else
+    {
+        lazy_cursor_at(document, document->index[separator] + 1, separator + 1, (size_t)-1, next);
+    }
+
+    return true;
+}
+
+/* unescape the string between the quotes at slot and its partner into output (which needs at least as many bytes as the raw string) */
+static cJSON_bool lazy_unescape(const cJSON_Lazy * const document, size_t slot, unsigned char * const output)
+{
+    const unsigned char *error_pointer = NULL;
+    const unsigned char *start = document->content + document->index[slot] + 1;
+    const unsigned char *end = document->content + document->index[document->match[slot]];
+
+    return unescape_string(start, end, output, &error_pointer);
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_CursorGetObjectItem(const cJSON_Cursor *object, const char *key, cJSON_Cursor *item)
+{
+    const cJSON_Lazy *document = NULL;
+    const size_t key_length = (key != NULL) ? strlen(key) : 0;
+    cJSON_Cursor current;
+
+    if ((cJSON_CursorType(object) != cJSON_Object) || (key == NULL) || (item == NULL))
+    {
+        return false;
+    }
+    document = object->document;
+
+    if (!cJSON_CursorChild(object, &current))
+    {
+        return false;
+    }
+    do
+    {
+        const unsigned char *raw_key = document->content + document->index[current.key_slot] + 1;
+        const size_t raw_length = document->index[current.key_slot + 1] - document->index[current.key_slot] - 1;
+        cJSON_bool equal = false;
+
+        if (memchr(raw_key, '\\', raw_length) == NULL)
+        {
+            equal = (raw_length == key_length) && (memcmp(raw_key, key, key_length) == 0);
+        }
+        else if (raw_length >= key_length)
+        {
+            /* an escaped key is at most as long as its raw form */
+            unsigned char *unescaped = (unsigned char*)global_hooks.allocate(raw_length + 1);
+            if (unescaped == NULL)
+            {
+                return false;
+            }
+            equal = lazy_unescape(document, current.key_slot, unescaped) && (strcmp((const char*)unescaped, key) == 0);
+            global_hooks.deallocate(unescaped);
+        }
+
+        if (equal)
+        {
+            *item = current;
+            return true;
+        }
+    }
+    while (cJSON_CursorNext(&current, &current));
+
+    return false;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_CursorGetNumber(const cJSON_Cursor *cursor, double *number)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, 0 };
+    cJSON item;
+
+    if ((cJSON_CursorType(cursor) != cJSON_Number) || (number == NULL))
+    {
+        return false;
+    }
+
+    memset(&item, '\0', sizeof(item));
+    buffer.content = cursor->document->content;
+    buffer.length = cursor->end;
+    buffer.offset = cursor->start;
+    buffer.hooks = global_hooks;
+    if (!parse_number(&item, &buffer))
+    {
+        return false;
+    }
+
+    *number = item.valuedouble;
+    return true;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_CursorGetBool(const cJSON_Cursor *cursor, cJSON_bool *value)
+{
+    const int type = cJSON_CursorType(cursor);
+
+    if (((type != cJSON_True) && (type != cJSON_False)) || (value == NULL))
+    {
+        return false;
+    }
+
+    *value = (type == cJSON_True);
+    return true;
+}
+
+CJSON_PUBLIC(cJSON_bool) cJSON_CursorGetString(const cJSON_Cursor *cursor, char *buffer, size_t buffer_size)
+{
+    size_t raw_length = 0;
+    unsigned char *unescaped = NULL;
+    cJSON_bool success = false;
+
+    if ((cJSON_CursorType(cursor) != cJSON_String) || (buffer == NULL) || (buffer_size == 0))
+    {
+        return false;
+    }
+    raw_length = cursor->end - cursor->start - 2;
+
+    /* unescaping never makes a string longer, so if the raw string fits it can be written directly */
+    if (raw_length < buffer_size)
+    {
+        return lazy_unescape(cursor->document, cursor->slot, (unsigned char*)buffer);
+    }
+
+    unescaped = (unsigned char*)global_hooks.allocate(raw_length + 1);
+    if (unescaped == NULL)
+    {
+        return false;
+    }
+    if (lazy_unescape(cursor->document, cursor->slot, unescaped) && (strlen((const char*)unescaped) < buffer_size))
+    {
+        memcpy(buffer, unescaped, strlen((const char*)unescaped) + 1);
+        success = true;
+    }
+    global_hooks.deallocate(unescaped);
+
+    return success;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_CursorToItem(const cJSON_Cursor *cursor)
+{
+    parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, 0 };
+    cJSON *item = NULL;
+
+    if (cJSON_CursorType(cursor) == cJSON_Invalid)
+    {
+        return NULL;
+    }
+
+    item = cJSON_New_Item(&global_hooks);
+    if (item == NULL)
+    {
+        return NULL;
+    }
+
+    buffer.content = cursor->document->content;
+    buffer.length = cursor->end;
+    buffer.offset = cursor->start;
+    buffer.hooks = global_hooks;
+    if (!parse_value(item, &buffer))
+    {
+        cJSON_Delete(item);
+        return NULL;
+    }
+
+    return item;
+}
+
+/* Tape parsing (cJSON_TapeParse and the cJSON_Tape functions).
+ * Every word holds a type character in the top byte:
+ *   '{' '['  the position after the matching '}' ']' (while the container is open: the position of the enclosing one)
+ *   '}' ']'  the position of the matching '{' '['
+ *   '"'      the offset of the string in strings
+ *   'd'      a number, the next word holds the double
+ *   't' 'f' 'n'
+ * The tape is written in a single pass over the structural index, which is checked on the way with the states
+ * of lazy_validate. */
+#define TAPE_TYPE_SHIFT 56
+#define TAPE_NO_PARENT (((uint64_t)1 << TAPE_TYPE_SHIFT) - 1)
+#define tape_word(type, payload) ((((uint64_t)(type)) << TAPE_TYPE_SHIFT) | (uint64_t)(payload))
+#define tape_type(word) ((unsigned char)((word) >> TAPE_TYPE_SHIFT))
+#define tape_payload(word) ((size_t)((word) & TAPE_NO_PARENT))
+
+/* the powers of ten that are exact as a double */
+static const double exact_powers_of_ten[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* Convert the literal or number at *position and write it to words, *position is moved past it.
+ * A number whose digits fit into 53 bits and whose exponent is an exact power of ten is one multiplication or
+ * division, which rounds correctly (Clinger's fast path). Anything else goes through parse_number (strtod). */
+static cJSON_bool tape_scalar(const unsigned char * const content, size_t length, size_t * const position, uint64_t * const words, size_t * const word)
+{
+    const unsigned char *pointer = content + *position;
+    const unsigned char * const start = pointer;
+    const unsigned char * const end = content + length;
+    unsigned long long mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    cJSON_bool negative = false;
+    double number = 0;
+
+    if ((*pointer == 't') && ((end - pointer) >= 4) && (memcmp(pointer, "true", 4) == 0))
+    {
+        words[(*word)++] = tape_word('t', 0);
+        pointer += 4;
+        goto done;
+    }
+    if ((*pointer == 'f') && ((end - pointer) >= 5) && (memcmp(pointer, "false", 5) == 0))
+    {
+        words[(*word)++] = tape_word('f', 0);
+        pointer += 5;
+        goto done;
+    }
+    if ((*pointer == 'n') && ((end - pointer) >= 4) && (memcmp(pointer, "null", 4) == 0))
+    {
+        words[(*word)++] = tape_word('n', 0);
+        pointer += 4;
+        goto done;
+    }
+
+    /* -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?, up to 19 digits are collected in mantissa */
+    if (*pointer == '-')
+    {
+        negative = true;
+        pointer++;
+    }
+    if ((pointer == end) || (*pointer < '0') || (*pointer > '9'))
+    {
+        return false;
+    }
+    if (*pointer == '0')
+    {
+        pointer++;
+    }
+    else
+    {
+        while ((pointer < end) && (*pointer >= '0') && (*pointer <= '9'))
+        {
+            mantissa = (mantissa * 10) + (unsigned long long)(*pointer++ - '0');
+            digits++;
+        }
+    }
+    if ((pointer < end) && (*pointer == '.'))
+    {
+        pointer++;
+        if ((pointer == end) || (*pointer < '0') || (*pointer > '9'))
+        {
+            return false;
+        }
+        while ((pointer < end) && (*pointer >= '0') && (*pointer <= '9'))
+        {
+            mantissa = (mantissa * 10) + (unsigned long long)(*pointer++ - '0');
+            digits++;
+            exponent--;
+        }
+    }
+    if ((pointer < end) && ((*pointer == 'e') || (*pointer == 'E')))
+    {
+        cJSON_bool negative_exponent = false;
+        int value = 0;
+
+        pointer++;
+        if ((pointer < end) && ((*pointer == '+') || (*pointer == '-')))
+        {
+            negative_exponent = (*pointer++ == '-');
+        }
+        if ((pointer == end) || (*pointer < '0') || (*pointer > '9'))
+        {
+            return false;
+        }
+        while ((pointer < end) && (*pointer >= '0') && (*pointer <= '9'))
+        {
+            /* past this the number is 0 or infinite, strtod knows which */
+            if (value < 100000)
+            {
+                value = (value * 10) + (*pointer - '0');
+            }
+            pointer++;
+        }
+        exponent += negative_exponent ? -value : value;
+    }
+
+    if ((digits <= 19) && ((mantissa == 0) || ((mantissa <= (1ULL << 53)) && (exponent >= -22) && (exponent <= 22))))
+    {
+        number = (double)mantissa;
+        if (exponent < 0)
+        {
+            number /= exact_powers_of_ten[(mantissa == 0) ? 0 : -exponent];
+        }
+        else
+        {
+            number *= exact_powers_of_ten[(mantissa == 0) ? 0 : exponent];
+        }
+        if (negative)
+        {
+            number = -number;
+        }
+    }
+    else
+    {
+        parse_buffer buffer = { 0, 0, 0, 0, { 0, 0, 0 }, 0 };
+        cJSON item;
+
+        memset(&item, '\0', sizeof(item));
+        buffer.content = content;
+        buffer.length = (size_t)(pointer - content);
+        buffer.offset = (size_t)(start - content);
+        buffer.hooks = global_hooks;
+        if (!parse_number(&item, &buffer))
+        {
+            return false;
+        }
+        number = item.valuedouble;
+    }
+
+    words[*word] = tape_word('d', 0);
+    memcpy(&words[*word + 1], &number, sizeof(number));
+    *word += 2;
+
+done:
+    /* "truex", "1.5.3" */
+    if ((pointer < end) && is_scalar_character(*pointer))
+    {
+        return false;
+    }
+    *position = (size_t)(pointer - content);
+
+    return true;
+}
+
+/* Follow the structural index of content and write the tape, which has room for the most words and string bytes
+ * the index can produce (see cJSON_TapeParse) */
+static cJSON_bool tape_build(const unsigned char * const content, size_t length, const structural_index * const index, cJSON_Tape * const tape, size_t * const error_position)
+{
+    const unsigned int * const positions = index->positions;
+    const size_t count = index->count;
+    uint64_t * const words = tape->words;
+    unsigned char * const strings = tape->strings;
+    lazy_state state = lazy_expect_value;
+    uint64_t parent = TAPE_NO_PARENT;
+    size_t depth = 0;
+    size_t slot = 0;
+    size_t position = 0;
+    size_t word = 0;
+    size_t string_offset = 0;
+
+    /* skip the UTF-8 BOM */
+    if ((length >= 3) && (strncmp((const char*)content, "\xEF\xBB\xBF", 3) == 0))
+    {
+        position = 3;
+    }
+
+    for (;;)
+    {
+        unsigned char c = '\0';
+
+        while ((position < length) && (content[position] <= 32) && (content[position] != '\0'))
+        {
+            position++;
+        }
+        *error_position = position;
+
+        if ((state == lazy_after_value) && (parent == TAPE_NO_PARENT))
+        {
+            /* the root value is complete, only a '\0' may follow */
+            tape->count = word;
+            tape->strings_length = string_offset;
+            return (slot == count) && ((position == length) || (content[position] == '\0'));
+        }
+
+        if ((slot >= count) || (positions[slot] != position))
+        {
+            if (((state != lazy_expect_value) && (state != lazy_expect_value_or_close)) || (position == length))
+            {
+                return false;
+            }
+            if (!tape_scalar(content, length, &position, words, &word))
+            {
+                return false;
+            }
+            state = lazy_after_value;
+            continue;
+        }
+
+        c = content[position];
+        switch (c)
+        {
+            case '\"':
+            {
+                const unsigned char *error_pointer = NULL;
+                const unsigned char *raw = content + position + 1;
+                unsigned char *output = strings + string_offset + 4;
+                size_t raw_length = 0;
+                unsigned int string_length = 0;
+
+                if ((state == lazy_after_value) || (state == lazy_expect_colon) || ((slot + 1) >= count))
+                {
+                    return false;
+                }
+                raw_length = positions[slot + 1] - position - 1;
+                if (!index->escapes || (memchr(raw, '\\', raw_length) == NULL))
+                {
+                    memcpy(output, raw, raw_length);
+                    output[raw_length] = '\0';
+                    string_length = (unsigned int)raw_length;
+                }
+                else
+                {
+                    if (!unescape_string(raw, raw + raw_length, output, &error_pointer))
+                    {
+                        *error_position = (size_t)(error_pointer - content);
+                        return false;
+                    }
+                    string_length = (unsigned int)strlen((const char*)output);
+                }
+                memcpy(strings + string_offset, &string_length, 4);
+                words[word++] = tape_word('\"', string_offset);
+                string_offset += 4 + string_length + 1;
+
+                position = positions[slot + 1] + 1;
+                slot += 2;
+                state = ((state == lazy_expect_key) || (state == lazy_expect_key_or_close)) ? lazy_expect_colon : lazy_after_value;
+                break;
+            }
+
+            case '{':
+            case '[':
+                if ((state != lazy_expect_value) && (state != lazy_expect_value_or_close))
+                {
+                    return false;
+                }
+                if (++depth > CJSON_NESTING_LIMIT)
+                {
+                    return false;
+                }
+                words[word] = tape_word(c, parent);
+                parent = word++;
+                state = (c == '{') ? lazy_expect_key_or_close : lazy_expect_value_or_close;
+                slot++;
+                position++;
+                break;
+
+            case '}':
+            case ']':
+                if ((parent == TAPE_NO_PARENT)
+                    || (tape_type(words[parent]) != ((c == '}') ? '{' : '['))
+                    || ((state != lazy_after_value) && (state != lazy_expect_key_or_close) && (state != lazy_expect_value_or_close)))
+                {
+                    return false;
+                }
+                {
+                    const uint64_t grandparent = words[parent] & TAPE_NO_PARENT;
+                    words[parent] = tape_word(tape_type(words[parent]), word + 1);
+                    words[word++] = tape_word(c, parent);
+                    parent = grandparent;
+                }
+                depth--;
+                state = lazy_after_value;
+                slot++;
+                position++;
+                break;
+
+            case ':':
+                if (state != lazy_expect_colon)
+                {
+                    return false;
+                }
+                state = lazy_expect_value;
+                slot++;
+                position++;
+                break;
+
+            case ',':
+                if ((state != lazy_after_value) || (parent == TAPE_NO_PARENT))
+                {
+                    return false;
+                }
+                state = (tape_type(words[parent]) == '{') ? lazy_expect_key : lazy_expect_value;
+                slot++;
+                position++;
+                break;
+
+            default:
+                return false;
+        }
+    }
+}
+
+CJSON_PUBLIC(cJSON_Tape *) cJSON_TapeParse(const char *value, size_t buffer_length)
+{
+    structural_index index = { NULL, 0, 0, false };
+    cJSON_Tape *tape = NULL;
+    size_t error_position = 0;
+
+    /* reset error position */
+    global_error.json = NULL;
+    global_error.position = 0;
+
+    if ((value == NULL) || (buffer_length == 0))
+    {
+        goto fail;
+    }
 
-    if (cannot_access_at_index(input_buffer, 0) || (buffer_at_offset(input_buffer)[0] != '}'))
+    tape = (cJSON_Tape*)global_hooks.allocate(sizeof(cJSON_Tape));
+    if (tape == NULL)
     {
-        goto fail; /* expected end of object */
+        goto fail;
     }
+    memset(tape, '\0', sizeof(cJSON_Tape));
 
-success:
-    input_buffer->depth--;
+    if (!build_structural_index((const unsigned char*)value, buffer_length, &index, &global_hooks))
+    {
+        goto fail;
+    }
 
-    if (head != NULL) {
-        head->prev = current_item;
+    /* Every index entry gives at most one word (a pair of quotes one) and a scalar at most two. Scalars are
+     * followed by an index entry or end the document, so there are at most count + 1 of them. A string takes 5
+     * bytes besides its own, and there are at most count / 2 strings. */
+    tape->words = (uint64_t*)global_hooks.allocate(((3 * index.count) + 2) * sizeof(uint64_t));
+    tape->strings = (unsigned char*)global_hooks.allocate(buffer_length + (3 * index.count) + 1);
+    if ((tape->words == NULL) || (tape->strings == NULL))
+    {
+        goto fail;
     }
 
-    item->type = cJSON_Object;
-    item->child = head;
+    if (!tape_build((const unsigned char*)value, buffer_length, &index, tape, &error_position))
+    {
+        goto fail;
+    }
+    global_hooks.deallocate(index.positions);
 
-    input_buffer->offset++;
-    return true;
+    return tape;
 
 fail:
-    if (head != NULL)
+    if (index.positions != NULL)
     {
-        cJSON_Delete(head);
+        global_hooks.deallocate(index.positions);
     }
+    cJSON_TapeDelete(tape);
 
-    return false;
+    if (value != NULL)
+    {
+        global_error.json = (const unsigned char*)value;
+        global_error.position = ((error_position < buffer_length) || (buffer_length == 0)) ? error_position : buffer_length - 1;
+    }
+
+    return NULL;
 }
 
-/* Render an object to text. */
-static cJSON_bool print_object(const cJSON * const item, printbuffer * const output_buffer)
+CJSON_PUBLIC(void) cJSON_TapeDelete(cJSON_Tape *tape)
 {
-    unsigned char *output_pointer = NULL;
-    size_t length = 0;
-    cJSON *current_item = item->child;
-
-    if (output_buffer == NULL)
+    if (tape == NULL)
     {
-        return false;
+        return;
     }
-
-    /* Compose the output: */
-    length = (size_t) (output_buffer->format ? 2 : 1); /* fmt: {\n */
-    output_pointer = ensure(output_buffer, length + 1);
-    if (output_pointer == NULL)
+    if (tape->words != NULL)
     {
-        return false;
+        global_hooks.deallocate(tape->words);
+    }
+    if (tape->strings != NULL)
+    {
+        global_hooks.deallocate(tape->strings);
     }
+    global_hooks.deallocate(tape);
+}
 
-    *output_pointer++ = '{';
-    output_buffer->depth++;
-    if (output_buffer->format)
+CJSON_PUBLIC(int) cJSON_TapeType(const cJSON_Tape *tape, size_t position)
+{
+    if ((tape == NULL) || (position >= tape->count))
+    {
+        return cJSON_Invalid;
+    }
+
+    switch (tape_type(tape->words[position]))
+    {
+        case '{':
+            return cJSON_Object;
+        case '[':
+            return cJSON_Array;
+        case '\"':
+            return cJSON_String;
+        case 'd':
+            return cJSON_Number;
+        case 't':
+            return cJSON_True;
+        case 'f':
+            return cJSON_False;
+        case 'n':
+            return cJSON_NULL;
+        default:
+            return cJSON_Invalid;
+    }
+}
+
+CJSON_PUBLIC(size_t) cJSON_TapeNext(const cJSON_Tape *tape, size_t position)
+{
+    if ((tape == NULL) || (position >= tape->count))
     {
-        *output_pointer++ = '\n';
+        return position;
     }
-    output_buffer->offset += length;
 
-    while (current_item)
+    switch (tape_type(tape->words[position]))
     {
-        if (output_buffer->format)
-        {
-            size_t i;
-            output_pointer = ensure(output_buffer, output_buffer->depth);
-            if (output_pointer == NULL)
-            {
-                return false;
-            }
-            for (i = 0; i < output_buffer->depth; i++)
-            {
-                *output_pointer++ = '\t';
-            }
-            output_buffer->offset += output_buffer->depth;
-        }
+        case '{':
+        case '[':
+            return tape_payload(tape->words[position]);
+        case 'd':
+            return position + 2;
+        default:
+            return position + 1;
+    }
+}
 
-        /* print key */
-        if (!print_string_ptr((unsigned char*)current_item->string, output_buffer))
-        {
-            return false;
-        }
-        update_offset(output_buffer);
+CJSON_PUBLIC(cJSON_bool) cJSON_TapeGetObjectItem(const cJSON_Tape *tape, size_t object, const char *key, size_t *item)
+{
+    size_t key_length = 0;
+    size_t position = 0;
 
-        length = (size_t) (output_buffer->format ? 2 : 1);
-        output_pointer = ensure(output_buffer, length);
-        if (output_pointer == NULL)
-        {
-            return false;
-        }
-        *output_pointer++ = ':';
-        if (output_buffer->format)
-        {
-            *output_pointer++ = '\t';
-        }
-        output_buffer->offset += length;
+    if ((cJSON_TapeType(tape, object) != cJSON_Object) || (key == NULL) || (item == NULL))
+    {
+        return false;
+    }
+    key_length = strlen(key);
 
-        /* print value */
-        if (!print_value(current_item, output_buffer))
-        {
-            return false;
-        }
-        update_offset(output_buffer);
+    for (position = object + 1; cJSON_TapeType(tape, position) == cJSON_String; position = cJSON_TapeNext(tape, position + 1))
+    {
+        size_t length = 0;
+        const char *member = cJSON_TapeGetString(tape, position, &length);
 
-        /* print comma if not last */
-        length = ((size_t)(output_buffer->format ? 1 : 0) + (size_t)(current_item->next ? 1 : 0));
-        output_pointer = ensure(output_buffer, length + 1);
-        if (output_pointer == NULL)
+        if ((length == key_length) && (memcmp(member, key, key_length) == 0))
         {
-            return false;
-        }
-        if (current_item->next)
-        {
-            *output_pointer++ = ',';
+            *item = position + 1;
+            return true;
         }
+    }
 
-        if (output_buffer->format)
-        {
-            *output_pointer++ = '\n';
-        }
-        *output_pointer = '\0';
-        output_buffer->offset += length;
+    return false;
+}
 
-        current_item = current_item->next;
+CJSON_PUBLIC(cJSON_bool) cJSON_TapeGetNumber(const cJSON_Tape *tape, size_t position, double *number)
+{
+    if ((cJSON_TapeType(tape, position) != cJSON_Number) || (number == NULL))
+    {
+        return false;
     }
 
-    output_pointer = ensure(output_buffer, output_buffer->format ? (output_buffer->depth + 1) : 2);
-    if (output_pointer == NULL)
+    memcpy(number, &tape->words[position + 1], sizeof(*number));
+    return true;
+}
+
+CJSON_PUBLIC(const char *) cJSON_TapeGetString(const cJSON_Tape *tape, size_t position, size_t *length)
+{
+    const unsigned char *string = NULL;
+    unsigned int string_length = 0;
+
+    if (cJSON_TapeType(tape, position) != cJSON_String)
     {
-        return false;
+        return NULL;
     }
-    if (output_buffer->format)
+
+    string = tape->strings + tape_payload(tape->words[position]);
+    if (length != NULL)
     {
-        size_t i;
-        for (i = 0; i < (output_buffer->depth - 1); i++)
-        {
-            *output_pointer++ = '\t';
-        }
+        memcpy(&string_length, string, 4);
+        *length = string_length;
     }
-    *output_pointer++ = '}';
-    *output_pointer = '\0';
-    output_buffer->depth--;
 
-    return true;
+    return (const char*)(string + 4);
 }
 
 /* Get Array size/item / object item. */
@@ -1891,6 +3848,11 @@ CJSON_PUBLIC(int) cJSON_GetArraySize(const cJSON *array)
         return 0;
     }
 
+    if ((array->type & cJSON_Packed) && cJSON_IsArray(array))
+    {
+        return array->valueint;
+    }
+
     child = array->child;
 
     while(child != NULL)
@@ -1952,9 +3914,23 @@ static cJSON *get_object_item(const cJSON * const object, const char * const nam
     }
     else
     {
-        while ((current_element != NULL) && (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)(current_element->string)) != 0))
+        unsigned char folded_name[CJSON_FOLDED_KEY_LENGTH];
+        size_t name_length = 0;
+
+        if (fold_key((const unsigned char*)name, folded_name, &name_length))
         {
-            current_element = current_element->next;
+            /* the name is folded once, every key only once per character */
+            while ((current_element != NULL) && !case_insensitive_equals(folded_name, name_length, (const unsigned char*)(current_element->string)))
+            {
+                current_element = current_element->next;
+            }
+        }
+        else
+        {
+            while ((current_element != NULL) && (case_insensitive_strcmp((const unsigned char*)name, (const unsigned char*)(current_element->string)) != 0))
+            {
+                current_element = current_element->next;
+            }
         }
     }
 
@@ -2018,6 +3994,12 @@ static cJSON_bool add_item_to_array(cJSON *array, cJSON *item)
         return false;
     }
 
+    if (array->type & cJSON_Packed)
+    {
+        /* packed arrays don't have child items */
+        return false;
+    }
+
     child = array->child;
     /*
      * To find the last item in array quickly, we use prev in array
@@ -2763,6 +4745,54 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateStringArray(const char *const *strings, int co
     return a;
 }
 
+/* Create a packed array holding a copy of count elements of element_size bytes */
+static cJSON *create_packed_array(const void *numbers, int count, int packed_type)
+{
+    const size_t element_size = packed_element_size(packed_type);
+    cJSON *a = NULL;
+
+    if ((count < 0) || (numbers == NULL) || (element_size == 0))
+    {
+        return NULL;
+    }
+
+    a = cJSON_CreateArray();
+    if (a == NULL)
+    {
+        return NULL;
+    }
+
+    a->type |= packed_type;
+    a->valueint = count;
+    if (count > 0)
+    {
+        a->valuestring = (char*)global_hooks.allocate((size_t)count * element_size);
+        if (a->valuestring == NULL)
+        {
+            cJSON_Delete(a);
+            return NULL;
+        }
+        memcpy(a->valuestring, numbers, (size_t)count * element_size);
+    }
+
+    return a;
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_CreatePackedIntArray(const int *numbers, int count)
+{
+    return create_packed_array(numbers, count, cJSON_PackedInt);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_CreatePackedFloatArray(const float *numbers, int count)
+{
+    return create_packed_array(numbers, count, cJSON_PackedFloat);
+}
+
+CJSON_PUBLIC(cJSON *) cJSON_CreatePackedDoubleArray(const double *numbers, int count)
+{
+    return create_packed_array(numbers, count, cJSON_PackedDouble);
+}
+
 /* Duplication */
 cJSON * cJSON_Duplicate_rec(const cJSON *item, size_t depth, cJSON_bool recurse);
 
@@ -2793,7 +4823,18 @@ cJSON * cJSON_Duplicate_rec(const cJSON *item, size_t depth, cJSON_bool recurse)
     newitem->type = item->type & (~cJSON_IsReference);
     newitem->valueint = item->valueint;
     newitem->valuedouble = item->valuedouble;
-    if (item->valuestring)
+    if ((item->type & cJSON_Packed) && (item->valuestring != NULL) && (item->valueint > 0))
+    {
+        /* packed arrays own a block of numbers, not a string */
+        size_t size = packed_element_size(item->type) * (size_t)item->valueint;
+        newitem->valuestring = (char*)global_hooks.allocate(size);
+        if (!newitem->valuestring)
+        {
+            goto fail;
+        }
+        memcpy(newitem->valuestring, item->valuestring, size);
+    }
+    else if ((item->valuestring != NULL) && !(item->type & cJSON_Packed))
     {
         newitem->valuestring = (char*)cJSON_strdup((unsigned char*)item->valuestring, &global_hooks);
         if (!newitem->valuestring)
@@ -3054,6 +5095,81 @@ CJSON_PUBLIC(cJSON_bool) cJSON_IsRaw(const cJSON * const item)
     return (item->type & 0xFF) == cJSON_Raw;
 }
 
+CJSON_PUBLIC(cJSON_bool) cJSON_IsPackedArray(const cJSON * const item)
+{
+    if (item == NULL)
+    {
+        return false;
+    }
+
+    return ((item->type & 0xFF) == cJSON_Array) && ((item->type & cJSON_Packed) != 0);
+}
+
+CJSON_PUBLIC(void *) cJSON_GetPackedArrayData(const cJSON * const item)
+{
+    if (!cJSON_IsPackedArray(item))
+    {
+        return NULL;
+    }
+
+    return item->valuestring;
+}
+
+/* compare two arrays of numbers of which at least one is packed */
+static cJSON_bool compare_packed_arrays(const cJSON * const a, const cJSON * const b)
+{
+    const cJSON *a_element = a->child;
+    const cJSON *b_element = b->child;
+    size_t count = (size_t)cJSON_GetArraySize(a);
+    size_t i = 0;
+
+    if (cJSON_GetArraySize(b) != (int)count)
+    {
+        return false;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        double a_number = 0;
+        double b_number = 0;
+
+        if (a->type & cJSON_Packed)
+        {
+            a_number = get_packed_number(a, i);
+        }
+        else
+        {
+            if (!cJSON_IsNumber(a_element))
+            {
+                return false;
+            }
+            a_number = a_element->valuedouble;
+            a_element = a_element->next;
+        }
+
+        if (b->type & cJSON_Packed)
+        {
+            b_number = get_packed_number(b, i);
+        }
+        else
+        {
+            if (!cJSON_IsNumber(b_element))
+            {
+                return false;
+            }
+            b_number = b_element->valuedouble;
+            b_element = b_element->next;
+        }
+
+        if (!compare_double(a_number, b_number))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * const b, const cJSON_bool case_sensitive)
 {
     if ((a == NULL) || (b == NULL) || ((a->type & 0xFF) != (b->type & 0xFF)))
@@ -3117,6 +5233,11 @@ CJSON_PUBLIC(cJSON_bool) cJSON_Compare(const cJSON * const a, const cJSON * cons
             cJSON *a_element = a->child;
             cJSON *b_element = b->child;
 
+            if ((a->type | b->type) & cJSON_Packed)
+            {
+                return compare_packed_arrays(a, b);
+            }
+
             for (; (a_element != NULL) && (b_element != NULL);)
             {
                 if (!cJSON_Compare(a_element, b_element, case_sensitive))
@@ -0,0 +1,137 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "lwip/dns.h"
+#include "lwip/sockets.h"
+#include "lwip/tcpip.h"
+#include "dns_cache.h"
+
+static const char *TAG = "dns_cache";
+
+RTC_SLOW_ATTR static struct {
+    char host[DNS_CACHE_HOST_MAX_LEN];  // empty if nothing is cached
+    uint32_t address;                   // network byte order
+    time_t expires;
+} cache;
+
+// The lookup in progress, the one lwIP's thread answers. A late answer to a lookup that timed out can still
+// come in when the next one has started, generation tells them apart.
+static struct {
+    SemaphoreHandle_t done;             // given with the answer
+    char host[DNS_CACHE_HOST_MAX_LEN];
+    uint32_t generation;                // of the current lookup
+    uint32_t answered;                  // generation the answer below is for
+    bool found;
+    uint32_t address;                   // network byte order
+} pending;
+
+// ---------------- PRIVATE FUNCTIONS -------------
+static bool cache_valid(const char *host, time_t now) {
+    if (cache.host[0] == '\0' || strcmp(cache.host, host) != 0) {
+        return false;
+    }
+    // the clock can jump when SNTP sets it, an expiry too far ahead means the entry is from before that
+    return now < cache.expires && cache.expires - now <= CONFIG_HTTP_DNS_CACHE_TTL_S;
+}
+
+/**
+ * @brief runs in lwIP's thread with the answer to the lookup generation (or NULL if there is none). A lookup
+ * that was given up on can still be answered, that answer is dropped
+ */
+static void lookup_done(const char *name, const ip_addr_t *address, void *arg) {
+    uint32_t generation = (uint32_t)(uintptr_t)arg;
+
+    if (generation != pending.generation) {
+        return;
+    }
+    pending.found = (address != NULL && IP_IS_V4(address));
+    if (pending.found) {
+        pending.address = ip4_addr_get_u32(ip_2_ip4(address));
+    }
+    pending.answered = generation;
+    xSemaphoreGive(pending.done);
+}
+
+/**
+ * @brief starts the lookup in lwIP's thread, which is where dns_gethostbyname() has to be called from
+ */
+static void lookup_start(void *arg) {
+    ip_addr_t address;
+
+    err_t err = dns_gethostbyname_addrtype(pending.host, &address, lookup_done, arg, LWIP_DNS_ADDRTYPE_IPV4);
+    if (err != ERR_INPROGRESS) {
+        // a literal address or one in lwIP's own cache, or an error
+        lookup_done(pending.host, (err == ERR_OK) ? &address : NULL, arg);
+    }
+}
+
+/**
+ * @brief resolves host, waiting at most timeout_ms. getaddrinfo() would wait for all of lwIP's retries
+ */
+static esp_err_t lookup(const char *host, uint32_t *address, uint32_t timeout_ms) {
+    if (pending.done == NULL && (pending.done = xSemaphoreCreateBinary()) == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    uint32_t generation = ++pending.generation;
+    xSemaphoreTake(pending.done, 0);    // left by a late answer to an earlier lookup
+    strcpy(pending.host, host);
+    if (tcpip_callback(lookup_start, (void *)(uintptr_t)generation) != ERR_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    do {
+        int64_t remaining_us = deadline_us - esp_timer_get_time();
+        if (remaining_us <= 0 || xSemaphoreTake(pending.done, pdMS_TO_TICKS(remaining_us / 1000)) != pdTRUE) {
+            ESP_LOGE(TAG, "DNS lookup for %s took longer than %"PRIu32" ms", host, timeout_ms);
+            return ESP_ERR_TIMEOUT;
+        }
+    } while (pending.answered != generation);
+
+    if (!pending.found) {
+        ESP_LOGE(TAG, "DNS lookup for %s failed", host);
+        return ESP_FAIL;
+    }
+    *address = pending.address;
+    return ESP_OK;
+}
+
+// ---------------- PUBLIC FUNCTIONS -------------
+esp_err_t dns_cache_resolve(const char *host, char *address, size_t size, uint32_t timeout_ms) {
+    time_t now = time(NULL);
+    struct in_addr in;
+
+    if (strlen(host) >= sizeof(cache.host)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (cache_valid(host, now)) {
+        ESP_LOGI(TAG, "Using cached address for %s", host);
+    }
+    else {
+        uint32_t resolved;
+        esp_err_t err = lookup(host, &resolved, timeout_ms);
+        if (err != ESP_OK) {
+            return err;
+        }
+        strcpy(cache.host, host);
+        cache.address = resolved;
+        cache.expires = now + CONFIG_HTTP_DNS_CACHE_TTL_S;
+    }
+
+    in.s_addr = cache.address;
+    if (inet_ntop(AF_INET, &in, address, size) == NULL) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+void dns_cache_invalidate(void) {
+    cache.host[0] = '\0';
+}
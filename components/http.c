@@ -1,90 +1,101 @@
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "dns_cache.h"
 #include "http.h"
+#include "http_inflate.h"
+#include "telemetry.h"
+#include "tls_pin.h"
 
-#define RCV_BUF_SIZE    512
-static char rcv_buf[RCV_BUF_SIZE];
+#define HTTP_MAX_REDIRECTS      3
+#define HTTP_RAW_BUFFER_SIZE    512 // compressed bytes read from the connection at once
+#define HTTP_DEFAULT_TIMEOUT_MS 5000    // esp_http_client's wait for a connect, read or write
+
+#ifdef CONFIG_HTTP_TRUST_PINNED_CA
+// CONFIG_HTTP_PINNED_CA_FILE, embedded by components/CMakeLists.txt (TEXT, so it is null terminated)
+extern const char pinned_ca_pem[] asm("_binary_pinned_ca_pem_start");
+#endif
 
 static const char *TAG = "http";
 
+/**
+ * @brief stores a validator header, one that doesn't fit is dropped (the request just won't be conditional then)
+ */
+static void copy_validator(char *dest, size_t size, const char *value) {
+    size_t length = strlen(value);
+    if (length >= size) {
+        ESP_LOGW(TAG, "Validator too long to cache (%d bytes)", (int)length);
+        dest[0] = '\0';
+        return;
+    }
+    memcpy(dest, value, length + 1);
+}
+
+/**
+ * @brief keeps the client's next wait (connect, read or write) within what is left of the session's budget.
+ * Once it has run out, the wait is cut to 1 ms and this returns ESP_ERR_TIMEOUT
+ */
+static esp_err_t limit_to_budget(http_session_t *session) {
+    if (session->budget == NULL) {
+        return ESP_OK;
+    }
+    uint32_t timeout_ms = (session->timeout_ms > 0) ? (uint32_t)session->timeout_ms : HTTP_DEFAULT_TIMEOUT_MS;
+    uint32_t limit_ms = wake_budget_limit_ms(session->budget, timeout_ms);
+    esp_http_client_set_timeout_ms(session->client, (limit_ms > 0) ? (int)limit_ms : 1);
+    return (limit_ms > 0) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
 
 /**
  * @brief Event handler for HTTP events. I took it from the esp_http_client example
  */
 static esp_err_t _http_event_handler(esp_http_client_event_t *evt)
 {
-    static char *output_buffer;  // Buffer to store response of http request from event handler
-    static int output_len;       // Stores number of bytes read
-    
     switch(evt->event_id) {
         case HTTP_EVENT_ERROR:
             ESP_LOGD(TAG, "HTTP_EVENT_ERROR");
             break;
-        case HTTP_EVENT_ON_CONNECTED:
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_CONNECTED");
+        case HTTP_EVENT_ON_CONNECTED: {
+            // TCP connect and TLS handshake are done
+            http_session_t *session = evt->user_data;
+            session->timing.connect_us = (uint32_t)(esp_timer_get_time() - session->open_started_us);
+            uint32_t handshake_ms = session->timing.connect_us / 1000;
+            session->connections++;
+            telemetry_record_handshake(handshake_ms);
+            ESP_LOGD(TAG, "HTTP_EVENT_ON_CONNECTED after %"PRIu32" ms", handshake_ms);
             break;
+        }
         case HTTP_EVENT_HEADER_SENT:
             ESP_LOGD(TAG, "HTTP_EVENT_HEADER_SENT");
             break;
         case HTTP_EVENT_ON_HEADER:
             ESP_LOGD(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
-            break;
-        case HTTP_EVENT_ON_DATA:
-            ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-            
-            // Clean the buffer in case of a new request
-            if (output_len == 0 && evt->user_data) {
-                // we are just starting to copy the output data into the use
-                memset(evt->user_data, 0, MAX_HTTP_OUTPUT_BUFFER);
+            http_session_t *session = evt->user_data;
+            session->headers_received = true;
+            if (strcasecmp(evt->header_key, "ETag") == 0) {
+                copy_validator(session->received.etag, sizeof(session->received.etag), evt->header_value);
             }
-            
-            // Set rcv_buf to the received data
-            memcpy(rcv_buf, evt->data, evt->data_len);
-            rcv_buf[evt->data_len] = '\0';
-
-            /*
-             *  Check for chunked encoding is added as the URL for chunked encoding used in this example returns binary data.
-             *  However, event handler can also be used in case chunked encoding is used.
-             */
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                // If user_data buffer is configured, copy the response into the buffer
-                int copy_len = 0;
-                if (evt->user_data) {
-                    // The last byte in evt->user_data is kept for the NULL character in case of out-of-bound access.
-                    copy_len = MIN(evt->data_len, (MAX_HTTP_OUTPUT_BUFFER - output_len));
-                    
-                    if (copy_len) {
-                        memcpy(evt->user_data + output_len, evt->data, copy_len);
-                    }
-                } else {
-                    int content_len = esp_http_client_get_content_length(evt->client);
-                    if (output_buffer == NULL) {
-                        // We initialize output_buffer with 0 because it is used by strlen() and similar functions therefore should be null terminated.
-                        output_buffer = (char *) calloc(content_len + 1, sizeof(char));
-                        output_len = 0;
-                        if (output_buffer == NULL) {
-                            ESP_LOGE(TAG, "Failed to allocate memory for output buffer");
-                            return ESP_FAIL;
-                        }
-                    }
-                    copy_len = MIN(evt->data_len, (content_len - output_len));
-                    if (copy_len) {
-                        memcpy(output_buffer + output_len, evt->data, copy_len);
-                    }
+            else if (strcasecmp(evt->header_key, "Last-Modified") == 0) {
+                copy_validator(session->received.last_modified, sizeof(session->received.last_modified), evt->header_value);
+            }
+            else if (strcasecmp(evt->header_key, "Content-Encoding") == 0) {
+                if (strcasecmp(evt->header_value, "gzip") == 0 || strcasecmp(evt->header_value, "x-gzip") == 0) {
+                    session->content_encoding = HTTP_ENCODING_GZIP;
+                }
+                else if (strcasecmp(evt->header_value, "deflate") == 0) {
+                    session->content_encoding = HTTP_ENCODING_DEFLATE;
                 }
-                output_len += copy_len;
             }
-
+            break;
+        case HTTP_EVENT_ON_DATA:
+            // the body is read with esp_http_client_read() in read_body. One call reads until the buffer is
+            // full, so a server sending a few bytes at a time is only stopped by shortening each wait here
+            ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
+            limit_to_budget(evt->user_data);
             break;
         case HTTP_EVENT_ON_FINISH:
             ESP_LOGD(TAG, "HTTP_EVENT_ON_FINISH");
-            if (output_buffer != NULL) {
-#if CONFIG_EXAMPLE_ENABLE_RESPONSE_BUFFER_DUMP
-                ESP_LOG_BUFFER_HEX(TAG, output_buffer, output_len);
-#endif
-                free(output_buffer);
-                output_buffer = NULL;
-            }
-            output_len = 0;
             break;
         case HTTP_EVENT_DISCONNECTED:
             ESP_LOGI(TAG, "HTTP_EVENT_DISCONNECTED");
@@ -94,63 +105,676 @@ static esp_err_t _http_event_handler(esp_http_client_event_t *evt)
                 ESP_LOGI(TAG, "Last esp error code: 0x%x", err);
                 ESP_LOGI(TAG, "Last mbedtls failure: 0x%x", mbedtls_err);
             }
-            if (output_buffer != NULL) {
-                free(output_buffer);
-                output_buffer = NULL;
-            }
-            output_len = 0;
             break;
         case HTTP_EVENT_REDIRECT:
             ESP_LOGD(TAG, "HTTP_EVENT_REDIRECT");
-            esp_http_client_set_header(evt->client, "From", "user@example.com");
-            esp_http_client_set_header(evt->client, "Accept", "text/html");
-            esp_http_client_set_redirection(evt->client);
             break;
     }
     return ESP_OK;
 }
 
 /**
- * @brief Sends HTTP GET request (using TLS). On success, returns ESP_OK and prints received data
- * On failure, returns ESP_FAIL and prints error code
+ * @brief Sends the request body, which the producer writes into the session's body_buf piece by piece
  */
-static esp_err_t https_with_url(void) {
-    esp_http_client_handle_t client;    // handle for the http driver
-    esp_err_t err;  // variable for error codes
+static esp_err_t write_body(http_session_t *session, size_t length, http_body_producer_t producer, void *context) {
+    char *body_buf = session->body_buf;
+    size_t offset = 0;
+
+    while (offset < length) {
+        size_t size = MIN(length - offset, HTTP_BODY_BUFFER_SIZE);
+        int produced = producer(body_buf, size, offset, context);
+        if (produced <= 0 || (size_t)produced > size) {
+            ESP_LOGE(TAG, "Body producer failed");
+            return ESP_FAIL;
+        }
 
+        for (int written = 0; written < produced; ) {
+            int write_len = esp_http_client_write(session->client, body_buf + written, produced - written);
+            if (write_len <= 0) {
+                ESP_LOGE(TAG, "Error writing request body");
+                return ESP_FAIL;
+            }
+            written += write_len;
+        }
+        offset += produced;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Sends the request line, headers and body and reads the response headers, on the kept-alive connection
+ * if there is one. Returns ESP_FAIL if no response came back
+ */
+static esp_err_t start_request(http_session_t *session, size_t length, http_body_producer_t producer, void *context,
+        int64_t *content_length) {
+    memset(&session->received, 0, sizeof(session->received));
+    session->headers_received = false;
+    session->content_encoding = HTTP_ENCODING_IDENTITY;
+    session->open_started_us = esp_timer_get_time();
+    session->timing.connect_us = 0;
+    session->timing.status = 0;
+
+    esp_err_t err = esp_http_client_open(session->client, (producer != NULL) ? (int)length : 0);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open HTTP connection: %s", esp_err_to_name(err));
+        return err;
+    }
+    if (producer != NULL) {
+        err = write_body(session, length, producer, context);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    int64_t sent_us = esp_timer_get_time();
+    // the connect (if there was one) happened inside esp_http_client_open()
+    session->timing.send_us = (uint32_t)(sent_us - session->open_started_us) - session->timing.connect_us;
+
+    // a 304 has no body and often no Content-Length either, so a negative length alone isn't a failure
+    *content_length = esp_http_client_fetch_headers(session->client);
+    // esp_http_client only returns once all headers are in, so this is a little later than the first byte
+    session->headers_us = esp_timer_get_time();
+    session->timing.first_byte_us = (uint32_t)(session->headers_us - sent_us);
+    session->timing.status = (uint16_t)esp_http_client_get_status_code(session->client);
+    bool chunked = esp_http_client_is_chunked_response(session->client);
+    if (*content_length < 0 && !chunked && !session->headers_received) {
+        ESP_LOGE(TAG, "Failed to read response headers");
+        return ESP_FAIL;
+    }
+    session->ends_with_close = (*content_length < 0 && !chunked);
+    return ESP_OK;
+}
+
+/**
+ * @brief creates the session's client for url. With the DNS cache, certificates are checked against the
+ * session's common_name if it has one (url has an address in it then)
+ */
+static esp_err_t create_client(http_session_t *session, const char *url) {
     esp_http_client_config_t config = { // Configuration for HTTP client
-        .url = CONFIG_DATABASE_URL,
+        .url = url,
         .event_handler = _http_event_handler,
+        .user_data = session,
+        .timeout_ms = session->timeout_ms,
+#if defined(CONFIG_HTTP_TRUST_PINNED_CA)
+        .cert_pem = pinned_ca_pem,
+#elif defined(CONFIG_HTTP_TRUST_PINNED_SPKI)
+        .crt_bundle_attach = tls_pin_spki_attach,
+#else
         .crt_bundle_attach = esp_crt_bundle_attach,
+#endif
         .buffer_size_tx = 2048,
         .buffer_size = 2048,
+        .keep_alive_enable = true,
     };
+#ifdef CONFIG_HTTP_DNS_CACHE
+    if (session->common_name[0] != '\0') {
+        // with the address in the URL, the certificate still has to match the name. The client keeps the
+        // pointer and uses it for every connection, see unpin_for_url
+        config.common_name = session->common_name;
+    }
+#endif
 
-    ESP_LOGI(TAG, "HTTPS request with url");
-    client = esp_http_client_init(&config); // initializing the http driver with the config above
-    err = esp_http_client_perform(client);  // performing the GET request
+    session->client = esp_http_client_init(&config);  // handle for the http driver
+    if (session->client == NULL) {
+        ESP_LOGE(TAG, "Failed to initialize HTTP client");
+        return ESP_FAIL;
+    }
+    // the JSON documents compress well, read_body inflates them
+    esp_http_client_set_header(session->client, "Accept-Encoding", "gzip, deflate");
+    return ESP_OK;
+}
 
-    if (err == ESP_OK) {
-        ESP_LOGI(TAG, "HTTPS Status = %d, content_length = %"PRId64,
-                esp_http_client_get_status_code(client),
-                esp_http_client_get_content_length(client));
+#ifdef CONFIG_HTTP_DNS_CACHE
+/**
+ * @brief finds the host name in url. Returns false for URLs this doesn't handle (IPv6 literals, user info)
+ */
+static bool find_url_host(const char *url, size_t *start, size_t *length) {
+    const char *scheme_end = strstr(url, "://");
+    if (scheme_end == NULL) {
+        return false;
+    }
+    *start = scheme_end + 3 - url;
+    *length = strcspn(url + *start, ":/?#");
+    return *length > 0 && url[*start] != '[' && memchr(url + *start, '@', strcspn(url + *start, "/?#")) == NULL;
+}
+
+/**
+ * @brief Looks up the session's host in the DNS cache and points address_url at the address, so connecting
+ * needs no DNS lookup. The certificate and the Host header still use the name. Returns ESP_FAIL if the url
+ * can't be used this way (or the name can't be resolved, then the client will fail the same way later), and
+ * ESP_ERR_TIMEOUT if the lookup didn't finish within the budget
+ */
+static esp_err_t use_cached_address(http_session_t *session) {
+    char address[DNS_CACHE_ADDRESS_LEN];
+    struct in_addr literal;
+    size_t start, length;
+
+    if (!find_url_host(session->url, &start, &length) || length >= sizeof(session->host)) {
+        return ESP_FAIL;
+    }
+    memcpy(session->host, session->url + start, length);
+    session->host[length] = '\0';
+    if (inet_pton(AF_INET, session->host, &literal) == 1) {
+        session->host[0] = '\0';
+        return ESP_FAIL;
+    }
+    esp_err_t err = dns_cache_resolve(session->host, address, sizeof(address),
+            wake_budget_limit_ms(session->budget, HTTP_DEFAULT_TIMEOUT_MS));
+    if (err != ESP_OK) {
+        session->host[0] = '\0';
+        return err;
+    }
+
+    int written = snprintf(session->address_url, sizeof(session->address_url), "%.*s%s%s",
+            (int)start, session->url, address, session->url + start + length);
+    if (written < 0 || (size_t)written >= sizeof(session->address_url)) {
+        session->host[0] = '\0';
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief whether url is on the host the session's client checks certificates against: its name, or the cached
+ * address while the session connects to that (a relative redirect keeps the address)
+ */
+static bool on_pinned_host(const http_session_t *session, const char *url) {
+    size_t start, length, address_start, address_length;
+
+    if (!find_url_host(url, &start, &length)) {
+        return false;
+    }
+    if (length == strlen(session->common_name) && strncasecmp(url + start, session->common_name, length) == 0) {
+        return true;
+    }
+    return session->host[0] != '\0' && find_url_host(session->address_url, &address_start, &address_length) &&
+            length == address_length && memcmp(url + start, session->address_url + address_start, length) == 0;
+}
+
+/**
+ * @brief esp_http_client checks the certificate of every connection against the common_name it was created
+ * with. Before a request or redirect goes to another host, this replaces the client with one that checks the
+ * name in url, and the session connects by name from then on. Headers set on the old client are gone
+ */
+static esp_err_t unpin_for_url(http_session_t *session, const char *url) {
+    if (session->common_name[0] == '\0' || on_pinned_host(session, url)) {
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "%s is on another host than %s, connecting by name", url, session->common_name);
+    session->host[0] = '\0';
+    session->common_name[0] = '\0';
+    esp_http_client_cleanup(session->client);
+    session->client = NULL;
+    return create_client(session, url);
+}
+
+/**
+ * @brief unpin_for_url for the location esp_http_client_set_redirection just set
+ */
+static esp_err_t unpin_for_redirect(http_session_t *session) {
+    char url[HTTP_URL_MAX_LEN];
+
+    if (session->common_name[0] == '\0') {
+        return ESP_OK;
+    }
+    esp_err_t err = esp_http_client_get_url(session->client, url, sizeof(url));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Redirect location longer than %d bytes", HTTP_URL_MAX_LEN);
+        return err;
+    }
+    return unpin_for_url(session, url);
+}
+
+/**
+ * @brief sets the Host header to the host and port of url. esp_http_client only sets it when it is created and
+ * when the host of its URL changes, so one set for the name of a cached address would stay on the next request
+ */
+static esp_err_t set_host_header(esp_http_client_handle_t client, const char *url) {
+    char host[HTTP_URL_MAX_LEN];
+    const char *scheme_end = strstr(url, "://");
+
+    if (scheme_end == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const char *authority = scheme_end + 3;
+    size_t length = strcspn(authority, "/?#");
+    const char *user_info_end = memchr(authority, '@', length);
+    if (user_info_end != NULL) {
+        length -= user_info_end + 1 - authority;
+        authority = user_info_end + 1;
+    }
+    if (length == 0 || length >= sizeof(host)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(host, authority, length);
+    host[length] = '\0';
+    return esp_http_client_set_header(client, "Host", host);
+}
+
+/**
+ * @brief forgets the cached address and goes back to connecting by name. Returns false if the session wasn't
+ * using a cached address
+ */
+static bool drop_cached_address(http_session_t *session) {
+    if (session->host[0] == '\0') {
+        return false;
+    }
+    dns_cache_invalidate();
+    session->host[0] = '\0';
+    return esp_http_client_set_url(session->client, session->url) == ESP_OK;
+}
+#else
+static inline esp_err_t unpin_for_url(http_session_t *session, const char *url) {
+    (void)session;
+    (void)url;
+    return ESP_OK;
+}
+
+static inline esp_err_t unpin_for_redirect(http_session_t *session) {
+    (void)session;
+    return ESP_OK;
+}
 
-    } else {
-        ESP_LOGE(TAG, "Error perform http request %s", esp_err_to_name(err));
+static inline bool drop_cached_address(http_session_t *session) {
+    (void)session;
+    return false;
+}
+#endif
+
+/**
+ * @brief the URL requests without one of their own go to
+ */
+static const char *session_url(const http_session_t *session) {
+#ifdef CONFIG_HTTP_DNS_CACHE
+    if (session->host[0] != '\0') {
+        return session->address_url;
+    }
+#endif
+    return session->url;
+}
+
+/**
+ * @brief adds If-None-Match/If-Modified-Since for the cached copy, returns whether the request is conditional
+ */
+static bool set_conditional_headers(esp_http_client_handle_t client, const http_validators_t *validators) {
+    bool conditional = false;
+
+    if (validators->etag[0] != '\0') {
+        esp_http_client_set_header(client, "If-None-Match", validators->etag);
+        conditional = true;
+    }
+    if (validators->last_modified[0] != '\0') {
+        esp_http_client_set_header(client, "If-Modified-Since", validators->last_modified);
+        conditional = true;
+    }
+    return conditional;
+}
+
+/**
+ * @brief Opens the request and reads the response headers, following redirects (GET only, a POST returns the 3xx).
+ * If the kept-alive connection turns out to be closed by the server, reconnects and sends the request once more.
+ * On success the client is ready for esp_http_client_read(), or the status is 304 (Not Modified).
+ * validators are set again if a redirect needs a new client
+ */
+static esp_err_t open_request(http_session_t *session, const http_validators_t *validators, size_t length,
+        http_body_producer_t producer, void *context) {
+    bool retried = false;
+
+    for (int redirects = 0; redirects <= HTTP_MAX_REDIRECTS; ) {
+        if (limit_to_budget(session) != ESP_OK) {
+            ESP_LOGE(TAG, "Out of time before the request was sent");
+            return ESP_ERR_TIMEOUT;
+        }
+        int connections = session->connections;
+        int64_t content_length = 0;
+        esp_err_t err = start_request(session, length, producer, context, &content_length);
+        if (err != ESP_OK) {
+            esp_http_client_close(session->client);
+            // no new connection was made, so this went out on the kept-alive one, which the server had closed
+            if (connections > 0 && session->connections == connections && !retried) {
+                ESP_LOGI(TAG, "Kept-alive connection was closed, reconnecting");
+                retried = true;
+                continue;
+            }
+            // couldn't connect at all, maybe the server moved and the cached address is stale
+            if (session->connections == connections && !retried && drop_cached_address(session)) {
+                ESP_LOGW(TAG, "Connecting to the cached address failed, resolving the host name again");
+                retried = true;
+                continue;
+            }
+            return err;
+        }
+
+        int status = esp_http_client_get_status_code(session->client);
+        if (status == HttpStatus_NotModified) {
+            ESP_LOGI(TAG, "HTTPS Status = 304, cached copy is still valid");
+            return ESP_OK;
+        }
+
+        ESP_LOGI(TAG, "HTTPS Status = %d, content_length = %"PRId64"%s", status, content_length,
+                esp_http_client_is_chunked_response(session->client) ? " (chunked)" : "");
+        if (status >= 200 && status < 300) {
+            return ESP_OK;
+        }
+        if (status < 300 || status >= 400 || producer != NULL) {
+            // an error page (or a redirect, which isn't followed for a POST) is not the body the caller wants.
+            // Whatever the server sends with it isn't worth waiting for, the next request connects again
+            ESP_LOGE(TAG, "Server answered with status %d", status);
+            esp_http_client_close(session->client);
+            return HTTP_ERR_STATUS;
+        }
+
+        // redirect: point the client at the new location and try again
+        ESP_ERROR_CHECK_WITHOUT_ABORT(esp_http_client_flush_response(session->client, NULL));
+        esp_http_client_close(session->client);
+        err = esp_http_client_set_redirection(session->client);
+        if (err != ESP_OK) {
+            return err;
+        }
+        esp_http_client_handle_t redirected = session->client;
+        err = unpin_for_redirect(session);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (session->client != redirected && validators != NULL) {
+            set_conditional_headers(session->client, validators);
+        }
+        redirects++;
+    }
+
+    ESP_LOGE(TAG, "Too many redirects");
+    return ESP_FAIL;
+}
+
+/**
+ * @brief Reads up to size bytes of the response body as it came over the wire. end is set once all of it is there.
+ * A body without Content-Length that isn't chunked ends when the server closes the connection, esp_http_client
+ * never reports it as complete, so there the close is the end (and a cut off body can't be told apart)
+ */
+static esp_err_t read_raw(http_session_t *session, char *buffer, size_t size, size_t *length, bool *end) {
+    esp_http_client_handle_t client = session->client;
+    int read_len = esp_http_client_read(client, buffer, size);
+    if (read_len < 0) {
+        ESP_LOGE(TAG, "Error reading response body");
         return ESP_FAIL;
     }
+    bool complete = esp_http_client_is_complete_data_received(client);
+    if (read_len == 0 && !complete && !session->ends_with_close) {
+        ESP_LOGE(TAG, "Connection closed before the whole body was received");
+        return ESP_FAIL;
+    }
+    *length = read_len;
+    *end = (read_len == 0) || complete;
+    return ESP_OK;
+}
+
+/**
+ * @brief Reads the body into the session's body_buf and passes it to the consumer as it arrives. Bytes the
+ * consumer doesn't take yet are moved to the front, so it always sees one contiguous piece of input.
+ * Works the same for chunked responses, esp_http_client_read() takes the chunk framing off.
+ * A compressed body is read into raw_buf first and inflated into body_buf, so the consumer always gets plain data.
+ */
+static esp_err_t read_body(http_session_t *session, http_body_consumer_t consumer, void *context) {
+    esp_http_client_handle_t client = session->client;
+    char *body_buf = session->body_buf;
+    char *raw_buf = session->raw_buf;
+    http_inflate_t *inflate = NULL;
+    size_t filled = 0;      // bytes in body_buf that the consumer hasn't taken yet
+    size_t raw_filled = 0;  // compressed bytes in raw_buf that haven't been inflated yet
+    bool raw_end = false;   // everything has been read from the connection
+    bool last = false;
+    esp_err_t err = ESP_OK;
+
+    if (session->content_encoding != HTTP_ENCODING_IDENTITY) {
+        inflate = http_inflate_create(session->content_encoding);
+        if (inflate == NULL) {
+            ESP_LOGE(TAG, "Not enough memory to inflate the response");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    while (!last) {
+        if (filled == HTTP_BODY_BUFFER_SIZE) {
+            ESP_LOGE(TAG, "Consumer needs more than %d bytes at once", HTTP_BODY_BUFFER_SIZE);
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+
+        // a server can keep sending a few bytes at a time for as long as it likes
+        if (limit_to_budget(session) != ESP_OK) {
+            ESP_LOGE(TAG, "Out of time after %"PRIu32" bytes of the body", session->timing.body_length);
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+
+        size_t length;
+        if (inflate == NULL) {
+            err = read_raw(session, body_buf + filled, HTTP_BODY_BUFFER_SIZE - filled, &length, &last);
+            if (err != ESP_OK) {
+                break;
+            }
+            filled += length;
+            session->timing.body_length += length;
+        }
+        else {
+            if (!raw_end && raw_filled < HTTP_RAW_BUFFER_SIZE) {
+                err = read_raw(session, raw_buf + raw_filled, HTTP_RAW_BUFFER_SIZE - raw_filled, &length, &raw_end);
+                if (err != ESP_OK) {
+                    break;
+                }
+                raw_filled += length;
+                session->timing.body_length += length;
+            }
+
+            size_t in_length = raw_filled;
+            length = HTTP_BODY_BUFFER_SIZE - filled;
+            err = http_inflate_run(inflate, raw_buf, &in_length, raw_end, body_buf + filled, &length, &last);
+            if (err != ESP_OK) {
+                break;
+            }
+            filled += length;
+            raw_filled -= in_length;
+            if (in_length > 0 && raw_filled > 0) {
+                memmove(raw_buf, raw_buf + in_length, raw_filled);
+            }
+        }
+
+        int consumed = consumer(body_buf, filled, last, context);
+        if (consumed < 0 || (size_t)consumed > filled) {
+            ESP_LOGE(TAG, "Body consumer failed");
+            err = ESP_FAIL;
+            break;
+        }
+
+        // keep the unconsumed rest at the front for the next call
+        filled -= consumed;
+        if (consumed > 0 && filled > 0) {
+            memmove(body_buf, body_buf + consumed, filled);
+        }
+    }
 
-    esp_http_client_cleanup(client);
+    bool compressed = (inflate != NULL);
+    http_inflate_delete(inflate);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (filled > 0) {
+        ESP_LOGW(TAG, "%d bytes at the end of the body were not consumed", (int)filled);
+    }
+    if (compressed && (raw_filled > 0 || !raw_end)) {
+        // anything after the compressed stream is ignored, but has to be read for the connection to be reusable
+        ESP_LOGW(TAG, "Data after the end of the compressed body");
+        esp_http_client_flush_response(client, NULL);
+    }
     return ESP_OK;
 }
 
 /**
- * @brief sends HTTP request. On success, returns ESP_OK. On failure,
- * returns ESP_FAIL (works by calling https_with_url)
+ * @brief sends one request on the session and streams the response body to consumer. content_type is for the
+ * request body, NULL without one
  */
-esp_err_t http_send_request(char **buffer) {
-    esp_err_t ret = https_with_url();
-    *buffer = rcv_buf;
-    
-    return ret;
+static esp_err_t session_request(http_session_t *session, esp_http_client_method_t method, const char *url,
+        http_validators_t *validators, const char *content_type, size_t length, http_body_producer_t producer,
+        http_body_consumer_t consumer, void *context) {
+    int64_t started_us = esp_timer_get_time();
+    int connections = session->connections;
+
+    memset(&session->timing, 0, sizeof(session->timing));
+    session->timing.dns_us = session->dns_us;   // the lookup in http_session_init counts for the first request
+    session->dns_us = 0;
+    session->headers_us = 0;
+
+    // another host may need another client, so the headers are only set after this
+    esp_err_t err = unpin_for_url(session, (url != NULL) ? url : session_url(session));
+    if (err != ESP_OK) {
+        return err;
+    }
+    esp_http_client_handle_t client = session->client;
+
+    // switching to another host closes the kept-alive connection, the same host keeps it
+    err = esp_http_client_set_url(client, (url != NULL) ? url : session_url(session));
+    if (err != ESP_OK) {
+        return err;
+    }
+#ifdef CONFIG_HTTP_DNS_CACHE
+    // the URL may have the cached address in it, but the server wants to see the name
+    err = set_host_header(client, (url != NULL) ? url : session->url);
+    if (err != ESP_OK) {
+        return err;
+    }
+#endif
+    esp_http_client_set_method(client, method);
+    if (content_type != NULL) {
+        esp_http_client_set_header(client, "Content-Type", content_type);
+    }
+
+    // headers stay set between requests, so take off the ones this request doesn't use
+    esp_http_client_delete_header(client, "If-None-Match");
+    esp_http_client_delete_header(client, "If-Modified-Since");
+    bool conditional = false;
+    if (validators != NULL) {
+        validators->not_modified = false;
+        conditional = set_conditional_headers(client, validators);
+    }
+
+    err = open_request(session, validators, length, producer, context);
+    client = session->client;   // a redirect to another host replaces it
+    if (content_type != NULL) {
+        esp_http_client_delete_header(client, "Content-Type");
+    }
+    if (err == ESP_OK && esp_http_client_get_status_code(client) == HttpStatus_NotModified) {
+        if (conditional) {
+            // no body to transfer, the caller keeps using its copy
+            validators->not_modified = true;
+        }
+        else {
+            ESP_LOGE(TAG, "Got 304 for a request that wasn't conditional");
+            err = ESP_FAIL;
+        }
+    }
+    else if (err == ESP_OK) {
+        err = read_body(session, consumer, context);
+        if (err == ESP_OK && validators != NULL) {
+            memcpy(validators->etag, session->received.etag, sizeof(validators->etag));
+            memcpy(validators->last_modified, session->received.last_modified, sizeof(validators->last_modified));
+        }
+    }
+
+    bool reused = (session->connections == connections);
+    if (session->headers_us != 0) {
+        session->timing.body_us = (uint32_t)(esp_timer_get_time() - session->headers_us);
+    }
+    session->timing.connection_reused = reused;
+    telemetry_record_timing(&session->timing);
+    ESP_LOGI(TAG, "dns %"PRIu32" us, connect %"PRIu32" us, send %"PRIu32" us, first byte %"PRIu32" us, body %"PRIu32" us (%"PRIu32" bytes)",
+            session->timing.dns_us, session->timing.connect_us, session->timing.send_us,
+            session->timing.first_byte_us, session->timing.body_us, session->timing.body_length);
+
+    if (err != ESP_OK) {
+        // the response may be half read, the next request has to start on a fresh connection
+        esp_http_client_close(client);
+        // a wait cut short by the budget fails like a dropped connection
+        return wake_budget_expired(session->budget) ? ESP_ERR_TIMEOUT : err;
+    }
+
+    uint32_t request_ms = (uint32_t)((esp_timer_get_time() - started_us) / 1000);
+    telemetry_record_request(request_ms, reused);
+    ESP_LOGI(TAG, "Request took %"PRIu32" ms on a %s connection", request_ms, reused ? "reused" : "new");
+    return ESP_OK;
+}
+
+/**
+ * @brief sets up a session for url. Nothing is sent until the first request, only the DNS cache may look the
+ * host up
+ */
+esp_err_t http_session_init(http_session_t *session, const char *url, const wake_budget_t *budget) {
+    memset(session, 0, sizeof(*session));
+    session->url = url;
+    session->budget = budget;
+    session->body_buf = malloc(HTTP_BODY_BUFFER_SIZE + HTTP_RAW_BUFFER_SIZE);
+    if (session->body_buf == NULL) {
+        ESP_LOGE(TAG, "Not enough memory for the body buffers");
+        return ESP_ERR_NO_MEM;
+    }
+    session->raw_buf = session->body_buf + HTTP_BODY_BUFFER_SIZE;
+
+#ifdef CONFIG_HTTP_DNS_CACHE
+    int64_t lookup_started_us = esp_timer_get_time();
+    esp_err_t err = use_cached_address(session);
+    if (err == ESP_ERR_TIMEOUT) {
+        // connecting by name would look it up again, without a limit
+        return err;
+    }
+    if (err == ESP_OK) {
+        strcpy(session->common_name, session->host);
+    }
+    session->dns_us = (uint32_t)(esp_timer_get_time() - lookup_started_us);
+#endif
+    return create_client(session, session_url(session));
+}
+
+/**
+ * @brief closes the connection and frees the client. Safe to call more than once
+ */
+void http_session_deinit(http_session_t *session) {
+    free(session->body_buf);
+    session->body_buf = NULL;
+    session->raw_buf = NULL;
+    if (session->client == NULL) {
+        return;
+    }
+    esp_http_client_close(session->client);
+    esp_http_client_cleanup(session->client);
+    session->client = NULL;
+}
+
+esp_err_t http_session_set_timeout(http_session_t *session, int timeout_ms) {
+    session->timeout_ms = timeout_ms;   // for a client created later, see unpin_for_url
+    return esp_http_client_set_timeout_ms(session->client, timeout_ms);
+}
+
+esp_err_t http_session_get(http_session_t *session, const char *url, http_validators_t *validators,
+        http_body_consumer_t consumer, void *context) {
+    return session_request(session, HTTP_METHOD_GET, url, validators, NULL, 0, NULL, consumer, context);
+}
+
+esp_err_t http_session_post(http_session_t *session, const char *url, const char *content_type, size_t length,
+        http_body_producer_t producer, http_body_consumer_t consumer, void *context) {
+    return session_request(session, HTTP_METHOD_POST, url, NULL, content_type, length, producer, consumer, context);
+}
+
+/**
+ * @brief sends HTTP GET request (using TLS) to CONFIG_DATABASE_URL and streams the body to consumer.
+ * If validators is not NULL the request is conditional on them, see http.h.
+ * On success, returns ESP_OK. On failure, returns an error code and prints it
+ */
+esp_err_t http_send_request(http_validators_t *validators, http_body_consumer_t consumer, void *context) {
+    http_session_t session;
+
+    ESP_LOGI(TAG, "HTTPS request with url");
+    esp_err_t err = http_session_init(&session, CONFIG_DATABASE_URL, NULL);
+    if (err == ESP_OK) {
+        err = http_session_get(&session, NULL, validators, consumer, context);
+    }
+    http_session_deinit(&session);
+    return err;
 }
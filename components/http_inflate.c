@@ -0,0 +1,272 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "miniz.h"
+#include "http_inflate.h"
+
+static const char *TAG = "http_inflate";
+
+// gzip header flags (RFC 1952)
+#define GZIP_FHCRC      0x02
+#define GZIP_FEXTRA     0x04
+#define GZIP_FNAME      0x08
+#define GZIP_FCOMMENT   0x10
+#define GZIP_RESERVED   0xE0
+
+typedef enum {
+    STAGE_GZIP_HEADER,
+    STAGE_ZLIB_CHECK,   // deciding between zlib wrapped and raw deflate
+    STAGE_DATA,
+    STAGE_GZIP_TRAILER,
+    STAGE_DONE,
+} inflate_stage_t;
+
+// the parts of the gzip header, in the order they come
+typedef enum {
+    HEADER_FIXED,
+    HEADER_EXTRA_LENGTH,
+    HEADER_EXTRA,
+    HEADER_NAME,
+    HEADER_COMMENT,
+    HEADER_CRC,
+    HEADER_DONE,
+} gzip_header_step_t;
+
+struct http_inflate {
+    tinfl_decompressor decompressor;
+    uint8_t window[TINFL_LZ_DICT_SIZE];     // output goes here first, tinfl needs the last 32 KB for back references
+    size_t window_offset;                   // where tinfl writes next
+    size_t pending_start;                   // output in the window that hasn't been handed out yet
+    size_t pending_length;
+    inflate_stage_t stage;
+    int flags;                              // tinfl flags
+    // gzip framing
+    bool gzip;
+    gzip_header_step_t header_step;
+    uint8_t header_flags;
+    uint8_t bytes[10];                      // fixed header, then the trailer
+    size_t byte_count;
+    size_t skip;                            // length of the extra field
+    uint32_t crc;
+    uint32_t size;
+};
+
+// ---------------- PRIVATE FUNCTIONS -------------
+static gzip_header_step_t next_header_step(uint8_t flags, gzip_header_step_t step) {
+    switch (step) {
+        case HEADER_FIXED:
+            if (flags & GZIP_FEXTRA) {
+                return HEADER_EXTRA_LENGTH;
+            }
+            // fall through
+        case HEADER_EXTRA_LENGTH:
+        case HEADER_EXTRA:
+            if (flags & GZIP_FNAME) {
+                return HEADER_NAME;
+            }
+            // fall through
+        case HEADER_NAME:
+            if (flags & GZIP_FCOMMENT) {
+                return HEADER_COMMENT;
+            }
+            // fall through
+        case HEADER_COMMENT:
+            if (flags & GZIP_FHCRC) {
+                return HEADER_CRC;
+            }
+            // fall through
+        default:
+            return HEADER_DONE;
+    }
+}
+
+/**
+ * @brief Reads gzip header bytes from in (it may arrive in pieces). Returns ESP_FAIL if it isn't a gzip header
+ */
+static esp_err_t parse_gzip_header(http_inflate_t *inflate, const uint8_t *in, size_t length, size_t *used) {
+    while (*used < length && inflate->header_step != HEADER_DONE) {
+        uint8_t c = in[(*used)++];
+
+        switch (inflate->header_step) {
+            case HEADER_FIXED:
+                inflate->bytes[inflate->byte_count++] = c;
+                if (inflate->byte_count < 10) {
+                    break;
+                }
+                // magic, deflate as the method and no flags we don't know
+                if (inflate->bytes[0] != 0x1F || inflate->bytes[1] != 0x8B || inflate->bytes[2] != 8 ||
+                        (inflate->bytes[3] & GZIP_RESERVED) != 0) {
+                    ESP_LOGE(TAG, "Not a gzip stream");
+                    return ESP_FAIL;
+                }
+                inflate->header_flags = inflate->bytes[3];
+                inflate->byte_count = 0;
+                inflate->header_step = next_header_step(inflate->header_flags, HEADER_FIXED);
+                break;
+            case HEADER_EXTRA_LENGTH:
+                inflate->skip |= (size_t)c << (8 * inflate->byte_count++);
+                if (inflate->byte_count == 2) {
+                    inflate->byte_count = 0;
+                    inflate->header_step = (inflate->skip > 0) ? HEADER_EXTRA :
+                            next_header_step(inflate->header_flags, HEADER_EXTRA);
+                }
+                break;
+            case HEADER_EXTRA:
+                if (--inflate->skip == 0) {
+                    inflate->header_step = next_header_step(inflate->header_flags, HEADER_EXTRA);
+                }
+                break;
+            case HEADER_NAME:
+            case HEADER_COMMENT:
+                // zero terminated strings
+                if (c == 0) {
+                    inflate->header_step = next_header_step(inflate->header_flags, inflate->header_step);
+                }
+                break;
+            case HEADER_CRC:
+                if (++inflate->byte_count == 2) {
+                    inflate->byte_count = 0;
+                    inflate->header_step = HEADER_DONE;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Checks the CRC-32 and length of the inflated data against the gzip trailer
+ */
+static esp_err_t check_gzip_trailer(const http_inflate_t *inflate) {
+    const uint8_t *bytes = inflate->bytes;
+    uint32_t crc = bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    uint32_t size = bytes[4] | (uint32_t)bytes[5] << 8 | (uint32_t)bytes[6] << 16 | (uint32_t)bytes[7] << 24;
+
+    if (crc != inflate->crc || size != inflate->size) {
+        ESP_LOGE(TAG, "gzip trailer doesn't match the data");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// ---------------- PUBLIC FUNCTIONS -------------
+http_inflate_t *http_inflate_create(http_content_encoding_t encoding) {
+    http_inflate_t *inflate = calloc(1, sizeof(*inflate));
+    if (inflate == NULL) {
+        return NULL;
+    }
+    tinfl_init(&inflate->decompressor);
+    inflate->gzip = (encoding == HTTP_ENCODING_GZIP);
+    inflate->stage = inflate->gzip ? STAGE_GZIP_HEADER : STAGE_ZLIB_CHECK;
+    inflate->header_step = HEADER_FIXED;
+    return inflate;
+}
+
+void http_inflate_delete(http_inflate_t *inflate) {
+    free(inflate);
+}
+
+esp_err_t http_inflate_run(http_inflate_t *inflate, const char *in, size_t *in_length, bool input_end,
+        char *out, size_t *out_length, bool *done) {
+    const uint8_t *input = (const uint8_t *)in;
+    size_t in_used = 0, out_used = 0;
+    esp_err_t err = ESP_OK;
+
+    *done = false;
+    while (err == ESP_OK) {
+        // hand out what has been inflated already
+        if (inflate->pending_length > 0) {
+            size_t length = inflate->pending_length;
+            if (length > *out_length - out_used) {
+                length = *out_length - out_used;
+            }
+            memcpy(out + out_used, inflate->window + inflate->pending_start, length);
+            out_used += length;
+            inflate->pending_start += length;
+            inflate->pending_length -= length;
+            if (inflate->pending_length > 0) {
+                break;
+            }
+        }
+
+        if (inflate->stage == STAGE_GZIP_HEADER) {
+            err = parse_gzip_header(inflate, input, *in_length, &in_used);
+            if (err != ESP_OK || inflate->header_step != HEADER_DONE) {
+                break;
+            }
+            inflate->stage = STAGE_DATA;
+        }
+        else if (inflate->stage == STAGE_ZLIB_CHECK) {
+            // "deflate" is meant to be zlib wrapped (RFC 1950), but some servers send raw deflate
+            if (*in_length - in_used < 2 && !input_end) {
+                break;
+            }
+            if (*in_length - in_used >= 2 && (input[in_used] & 0x0F) == 8 &&
+                    ((input[in_used] << 8) | input[in_used + 1]) % 31 == 0) {
+                inflate->flags = TINFL_FLAG_PARSE_ZLIB_HEADER;
+            }
+            inflate->stage = STAGE_DATA;
+        }
+        else if (inflate->stage == STAGE_DATA) {
+            if (out_used == *out_length) {
+                break;
+            }
+            size_t in_available = *in_length - in_used;
+            size_t window_available = TINFL_LZ_DICT_SIZE - inflate->window_offset;
+            tinfl_status status = tinfl_decompress(&inflate->decompressor, input + in_used, &in_available,
+                    inflate->window, inflate->window + inflate->window_offset, &window_available,
+                    inflate->flags | (input_end ? 0 : TINFL_FLAG_HAS_MORE_INPUT));
+            in_used += in_available;
+
+            if (inflate->gzip) {
+                inflate->crc = esp_rom_crc32_le(inflate->crc, inflate->window + inflate->window_offset, window_available);
+                inflate->size += window_available;
+            }
+            inflate->pending_start = inflate->window_offset;
+            inflate->pending_length = window_available;
+            inflate->window_offset = (inflate->window_offset + window_available) & (TINFL_LZ_DICT_SIZE - 1);
+
+            if (status == TINFL_STATUS_FAILED_CANNOT_MAKE_PROGRESS) {
+                ESP_LOGE(TAG, "Compressed data ends early");
+                err = ESP_FAIL;
+            }
+            else if (status < TINFL_STATUS_DONE) {
+                ESP_LOGE(TAG, "Corrupt compressed data (%d)", status);
+                err = ESP_FAIL;
+            }
+            else if (status == TINFL_STATUS_DONE) {
+                inflate->stage = inflate->gzip ? STAGE_GZIP_TRAILER : STAGE_DONE;
+            }
+            else if (status == TINFL_STATUS_NEEDS_MORE_INPUT && window_available == 0) {
+                break;
+            }
+        }
+        else if (inflate->stage == STAGE_GZIP_TRAILER) {
+            while (inflate->byte_count < 8 && in_used < *in_length) {
+                inflate->bytes[inflate->byte_count++] = input[in_used++];
+            }
+            if (inflate->byte_count < 8) {
+                break;
+            }
+            err = check_gzip_trailer(inflate);
+            inflate->stage = STAGE_DONE;
+        }
+        else {
+            *done = (inflate->pending_length == 0);
+            break;
+        }
+    }
+
+    if (err == ESP_OK && input_end && !*done && in_used == *in_length && out_used < *out_length) {
+        // everything was read, there is room for output and the stream still isn't finished
+        ESP_LOGE(TAG, "Compressed data ends early");
+        err = ESP_FAIL;
+    }
+    *in_length = in_used;
+    *out_length = out_used;
+    return err;
+}
@@ -84,6 +84,7 @@ then using the CJSON_API_VISIBILITY flag to "export" the same symbols the way CJ
 #define CJSON_VERSION_PATCH 19
 
 #include <stddef.h>
+#include <stdint.h>
 
 /* cJSON Types: */
 #define cJSON_Invalid (0)
@@ -99,6 +100,16 @@ then using the CJSON_API_VISIBILITY flag to "export" the same symbols the way CJ
 #define cJSON_IsReference 256
 #define cJSON_StringIsConst 512
 
+/* Packed arrays: an item of type cJSON_Array with one of these flags set keeps its elements in one
+ * contiguous block (pointed to by valuestring) instead of a chain of child items. valueint holds the count. */
+#define cJSON_PackedInt    1024
+#define cJSON_PackedFloat  2048
+#define cJSON_PackedDouble 4096
+#define cJSON_Packed (cJSON_PackedInt | cJSON_PackedFloat | cJSON_PackedDouble)
+
+/* Parse hint (not a type): reject strings and keys that aren't valid UTF-8. */
+#define cJSON_ValidateUTF8 8192
+
 /* The cJSON structure: */
 typedef struct cJSON
 {
@@ -157,6 +168,122 @@ CJSON_PUBLIC(cJSON *) cJSON_ParseWithLength(const char *value, size_t buffer_len
 /* If you supply a ptr in return_parse_end and parsing fails, then return_parse_end will contain a pointer to the error so will match cJSON_GetErrorPtr(). */
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithOpts(const char *value, const char **return_parse_end, cJSON_bool require_null_terminated);
 CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthOpts(const char *value, size_t buffer_length, const char **return_parse_end, cJSON_bool require_null_terminated);
+/* ParseWithLengthHints takes one of cJSON_PackedInt/cJSON_PackedFloat/cJSON_PackedDouble as hint, and stores every array that only
+ * contains numbers as a packed array of that type. Other arrays (and, for cJSON_PackedInt, arrays with non-integral numbers) are parsed as usual.
+ * cJSON_ValidateUTF8 can be or'ed in (or passed alone) to make malformed UTF-8 in strings a parse error. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseWithLengthHints(const char *value, size_t buffer_length, int hints);
+
+/* On-demand parsing: cJSON_LazyParse only checks that the document is well formed (strings are not unescaped and numbers
+ * not converted) and keeps an index of its structure. A cJSON_Cursor then points at a value in it, and the getters decode
+ * just the values that are asked for. The document refers to value, which has to stay valid until cJSON_LazyDelete.
+ * Escape sequences in strings are only checked when the string is read. */
+typedef struct cJSON_Lazy
+{
+    const unsigned char *content;
+    size_t length;
+    /* offsets of all structural characters and quotes */
+    unsigned int *index;
+    /* for every bracket and quote in index, the index entry of its partner */
+    unsigned int *match;
+    size_t count;
+} cJSON_Lazy;
+
+typedef struct cJSON_Cursor
+{
+    const cJSON_Lazy *document;
+    /* the value's bytes in document->content */
+    size_t start;
+    size_t end;
+    /* index entry of the value's opening bracket or quote (for numbers and literals the next entry after it) */
+    size_t slot;
+    /* index entry after the value */
+    size_t next_slot;
+    /* index entry of the opening quote of the key for object members, (size_t)-1 otherwise */
+    size_t key_slot;
+} cJSON_Cursor;
+
+CJSON_PUBLIC(cJSON_Lazy *) cJSON_LazyParse(const char *value, size_t buffer_length);
+CJSON_PUBLIC(void) cJSON_LazyDelete(cJSON_Lazy *document);
+CJSON_PUBLIC(cJSON_bool) cJSON_LazyRoot(const cJSON_Lazy *document, cJSON_Cursor *cursor);
+/* returns cJSON_False, cJSON_True, cJSON_NULL, cJSON_Number, cJSON_String, cJSON_Array or cJSON_Object */
+CJSON_PUBLIC(int) cJSON_CursorType(const cJSON_Cursor *cursor);
+/* first element of an array or object / next element after item, false if there is none.
+ * Containers that are stepped over are not looked into. */
+CJSON_PUBLIC(cJSON_bool) cJSON_CursorChild(const cJSON_Cursor *container, cJSON_Cursor *child);
+CJSON_PUBLIC(cJSON_bool) cJSON_CursorNext(const cJSON_Cursor *item, cJSON_Cursor *next);
+/* case sensitive, like cJSON_GetObjectItemCaseSensitive */
+CJSON_PUBLIC(cJSON_bool) cJSON_CursorGetObjectItem(const cJSON_Cursor *object, const char *key, cJSON_Cursor *item);
+/* the getters return false if the value has a different type (or, for strings, doesn't fit into buffer or has an invalid escape) */
+CJSON_PUBLIC(cJSON_bool) cJSON_CursorGetNumber(const cJSON_Cursor *cursor, double *number);
+CJSON_PUBLIC(cJSON_bool) cJSON_CursorGetBool(const cJSON_Cursor *cursor, cJSON_bool *value);
+CJSON_PUBLIC(cJSON_bool) cJSON_CursorGetString(const cJSON_Cursor *cursor, char *buffer, size_t buffer_size);
+/* parse the value (and everything in it) into a regular cJSON item, free it with cJSON_Delete */
+CJSON_PUBLIC(cJSON *) cJSON_CursorToItem(const cJSON_Cursor *cursor);
+
+/* Tape parsing, for host tools that read all of a large document (e.g. months of recorded telemetry).
+ * cJSON_TapeParse indexes the document like cJSON_LazyParse and then follows the index once, writing every value
+ * into one array of 64-bit words (the tape) instead of allocating a node for it: strings are unescaped into one
+ * buffer and numbers converted on the way. A value is addressed by its position on the tape, the root is at 0.
+ * The elements of a container follow it (for objects the key, as a string, then the value) and cJSON_TapeNext
+ * steps over a whole value, so
+ *     for (position = container + 1; cJSON_TapeType(tape, position) != cJSON_Invalid; position = cJSON_TapeNext(tape, position))
+ * visits all of them. The tape doesn't refer to value. */
+typedef struct cJSON_Tape
+{
+    /* type character in the top byte and a position or offset below it, see cJSON.c */
+    uint64_t *words;
+    size_t count;
+    /* every string as its length (4 bytes), the bytes and a '\0' */
+    unsigned char *strings;
+    size_t strings_length;
+} cJSON_Tape;
+
+CJSON_PUBLIC(cJSON_Tape *) cJSON_TapeParse(const char *value, size_t buffer_length);
+CJSON_PUBLIC(void) cJSON_TapeDelete(cJSON_Tape *tape);
+/* like cJSON_CursorType, cJSON_Invalid at the end of a container or of the tape */
+CJSON_PUBLIC(int) cJSON_TapeType(const cJSON_Tape *tape, size_t position);
+/* position of whatever follows the value at position */
+CJSON_PUBLIC(size_t) cJSON_TapeNext(const cJSON_Tape *tape, size_t position);
+/* case sensitive, like cJSON_GetObjectItemCaseSensitive */
+CJSON_PUBLIC(cJSON_bool) cJSON_TapeGetObjectItem(const cJSON_Tape *tape, size_t object, const char *key, size_t *item);
+/* the getters return false / NULL if the value has a different type. length (can be NULL) receives the length of the string */
+CJSON_PUBLIC(cJSON_bool) cJSON_TapeGetNumber(const cJSON_Tape *tape, size_t position, double *number);
+CJSON_PUBLIC(const char *) cJSON_TapeGetString(const cJSON_Tape *tape, size_t position, size_t *length);
+
+/* Stream parsing of newline delimited JSON (NDJSON), one document per line.
+ * The stream can be fed in chunks: a record without a terminating newline is only parsed once final is set,
+ * until then cJSON_ParseStreamNext returns NULL with status cJSON_StreamNeedMore. The caller then passes the
+ * next chunk to cJSON_FeedStream, starting with the unparsed rest of the previous one (the bytes from offset on).
+ * One cJSON_Stream is the parser state for all documents and chunks. The documents are allocated through the hooks,
+ * so with slab allocator hooks installed (e.g. components/json_pool.h) a document that is deleted before the next
+ * one is parsed hands its blocks on to it. */
+#define cJSON_StreamOk       0
+#define cJSON_StreamEnd      1
+#define cJSON_StreamNeedMore 2
+#define cJSON_StreamError    3
+
+typedef struct cJSON_Stream
+{
+    const char *content;
+    size_t length;
+    /* start of the first byte that hasn't been parsed yet */
+    size_t offset;
+    /* no more input follows content */
+    cJSON_bool final;
+    /* passed to the parser like in cJSON_ParseWithLengthHints */
+    int hints;
+    /* one of cJSON_Stream*, describes the result of the last call to cJSON_ParseStreamNext */
+    int status;
+    /* position of the parse error in content if status is cJSON_StreamError */
+    size_t error_offset;
+} cJSON_Stream;
+
+CJSON_PUBLIC(void) cJSON_InitStream(cJSON_Stream *stream, const char *value, size_t length, cJSON_bool final);
+CJSON_PUBLIC(void) cJSON_FeedStream(cJSON_Stream *stream, const char *value, size_t length, cJSON_bool final);
+/* Parse the next document. Returns NULL at the end of the input, when more input is needed or on a parse error (see status).
+ * After a parse error the stream continues with the next record. If not NULL, record_start/record_end receive the byte range
+ * of the document in content. */
+CJSON_PUBLIC(cJSON *) cJSON_ParseStreamNext(cJSON_Stream *stream, size_t *record_start, size_t *record_end);
 
 /* Render a cJSON entity to text for transfer/storage. */
 CJSON_PUBLIC(char *) cJSON_Print(const cJSON *item);
@@ -170,9 +297,9 @@ CJSON_PUBLIC(cJSON_bool) cJSON_PrintPreallocated(cJSON *item, char *buffer, cons
 /* Delete a cJSON entity and all subentities. */
 CJSON_PUBLIC(void) cJSON_Delete(cJSON *item);
 
-/* Returns the number of items in an array (or object). */
+/* Returns the number of items in an array (or object). For packed arrays this is the number of elements. */
 CJSON_PUBLIC(int) cJSON_GetArraySize(const cJSON *array);
-/* Retrieve item number "index" from array "array". Returns NULL if unsuccessful. */
+/* Retrieve item number "index" from array "array". Returns NULL if unsuccessful (always for packed arrays, use cJSON_GetPackedArrayData). */
 CJSON_PUBLIC(cJSON *) cJSON_GetArrayItem(const cJSON *array, int index);
 /* Get item "string" from object. Case insensitive. */
 CJSON_PUBLIC(cJSON *) cJSON_GetObjectItem(const cJSON * const object, const char * const string);
@@ -196,6 +323,11 @@ CJSON_PUBLIC(cJSON_bool) cJSON_IsString(const cJSON * const item);
 CJSON_PUBLIC(cJSON_bool) cJSON_IsArray(const cJSON * const item);
 CJSON_PUBLIC(cJSON_bool) cJSON_IsObject(const cJSON * const item);
 CJSON_PUBLIC(cJSON_bool) cJSON_IsRaw(const cJSON * const item);
+CJSON_PUBLIC(cJSON_bool) cJSON_IsPackedArray(const cJSON * const item);
+
+/* Direct access to the elements of a packed array: returns an int*, float* or double* (depending on the cJSON_Packed* flag in type)
+ * to cJSON_GetArraySize elements, or NULL if item is not a packed array. */
+CJSON_PUBLIC(void *) cJSON_GetPackedArrayData(const cJSON * const item);
 
 /* These calls create a cJSON item of the appropriate type. */
 CJSON_PUBLIC(cJSON *) cJSON_CreateNull(void);
@@ -223,6 +355,12 @@ CJSON_PUBLIC(cJSON *) cJSON_CreateIntArray(const int *numbers, int count);
 CJSON_PUBLIC(cJSON *) cJSON_CreateFloatArray(const float *numbers, int count);
 CJSON_PUBLIC(cJSON *) cJSON_CreateDoubleArray(const double *numbers, int count);
 CJSON_PUBLIC(cJSON *) cJSON_CreateStringArray(const char *const *strings, int count);
+/* These utilities create a packed Array: the count numbers are copied into a single block instead of one item per element.
+ * Packed arrays print like any other array, but have no child items, so cJSON_ArrayForEach does not visit them
+ * and items cannot be added to them. */
+CJSON_PUBLIC(cJSON *) cJSON_CreatePackedIntArray(const int *numbers, int count);
+CJSON_PUBLIC(cJSON *) cJSON_CreatePackedFloatArray(const float *numbers, int count);
+CJSON_PUBLIC(cJSON *) cJSON_CreatePackedDoubleArray(const double *numbers, int count);
 
 /* Append item to the specified array/object. */
 CJSON_PUBLIC(cJSON_bool) cJSON_AddItemToArray(cJSON *array, cJSON *item);
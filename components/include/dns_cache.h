@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// One-entry cache of a host's IPv4 address in RTC slow memory, so the next wakes can connect without a DNS
+// lookup. Entries expire after CONFIG_HTTP_DNS_CACHE_TTL_S (lwIP doesn't tell us the real TTL).
+
+#define DNS_CACHE_HOST_MAX_LEN  64
+#define DNS_CACHE_ADDRESS_LEN   16  // "255.255.255.255" and the '\0'
+
+// Writes host's address as a dotted string into address (DNS_CACHE_ADDRESS_LEN bytes), from the cache if it
+// is still valid and through lwIP's resolver otherwise. Returns ESP_ERR_TIMEOUT if the lookup takes longer than
+// timeout_ms.
+esp_err_t dns_cache_resolve(const char *host, char *address, size_t size, uint32_t timeout_ms);
+
+// forgets the cached address, e.g. because connecting to it failed
+void dns_cache_invalidate(void);
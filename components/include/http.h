@@ -1,14 +1,95 @@
 #pragma once
 
+#include <stdbool.h>
 #include <sys/param.h>
 #include "esp_event.h"
 #include "esp_log.h"
-#include "freertos/FreeRTOS.H"
+#include "freertos/FreeRTOS.h"
 #include "lwip/netdb.h"
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
 #include "esp_tls.h"
+#include "dns_cache.h"
+#include "http_inflate.h"
+#include "telemetry.h"
+#include "wake_budget.h"
 
-#define MAX_HTTP_OUTPUT_BUFFER 2048
+// size of the window the response body is received into (after inflating it, if it came compressed), the most the
+// body consumer can be handed at once
+#define HTTP_BODY_BUFFER_SIZE 2048
 
-esp_err_t http_send_request();
+// Receives the response body as it arrives. data holds the bytes that haven't been consumed yet, followed by the new
+// ones; last is true once the whole body is there. Returns how many bytes from the start of data it used (the rest is
+// passed again with the next call), or -1 to abort the request.
+typedef int (*http_body_consumer_t)(const char *data, size_t length, bool last, void *context);
+
+// A request failed because the server answered with a status outside 2xx (other than a 304 to a conditional GET,
+// or a redirect it followed). It may well work when asked again later. The status is in the request's telemetry.
+#define HTTP_ERR_STATUS             (ESP_ERR_HTTP_BASE + 0x100)
+
+#define HTTP_URL_MAX_LEN            256
+#define HTTP_ETAG_MAX_LEN           64
+#define HTTP_LAST_MODIFIED_MAX_LEN  32  // an HTTP date is 29 characters
+
+// Validators of a cached copy of the response, for conditional requests. Empty strings mean the header wasn't sent.
+typedef struct {
+    char etag[HTTP_ETAG_MAX_LEN];
+    char last_modified[HTTP_LAST_MODIFIED_MAX_LEN];
+    bool not_modified;  // set by http_send_request when the server answered 304
+} http_validators_t;
+
+// Writes the request body bytes starting at offset into buffer (at most size of them) and returns how many it wrote,
+// or -1 to abort. offset can go back to 0 when the request has to be sent again on a new connection.
+typedef int (*http_body_producer_t)(char *buffer, size_t size, size_t offset, void *context);
+
+// A client whose connection stays open between requests (keep-alive). If the server closed it in the meantime, the
+// next request reconnects. The fields are private.
+// Every session has its own buffers, so sessions can be used from different tasks at the same time.
+typedef struct {
+    esp_http_client_handle_t client;
+    char *body_buf;             // HTTP_BODY_BUFFER_SIZE bytes the request and response bodies go through
+    char *raw_buf;              // compressed response bytes before inflating, in the same allocation
+    const char *url;            // used for requests that don't give one
+    int timeout_ms;             // from http_session_set_timeout, 0 for the client's default
+    const wake_budget_t *budget;    // requests stop when it runs out, NULL for none
+    int64_t open_started_us;    // when the current request was sent, for the handshake time
+    int connections;            // TCP + TLS connections made so far
+    bool headers_received;      // the current response had at least one header
+    http_content_encoding_t content_encoding;   // of the current response
+    bool ends_with_close;       // the current response has no length and isn't chunked, the body ends at the close
+    telemetry_timing_t timing;  // phases of the current request
+    int64_t headers_us;         // when the response headers of the current request were in, 0 before that
+    uint32_t dns_us;            // lookup done in http_session_init, reported with the first request
+    http_validators_t received; // validators from the headers of the current response
+#ifdef CONFIG_HTTP_DNS_CACHE
+    char host[DNS_CACHE_HOST_MAX_LEN];  // host name of url while connecting to its cached address, else empty
+    char address_url[HTTP_URL_MAX_LEN]; // url with the host name replaced by the cached address
+    char common_name[DNS_CACHE_HOST_MAX_LEN];   // the name client checks every certificate against, else empty
+#endif
+} http_session_t;
+
+// Sets up a session for url. Its requests fail with ESP_ERR_TIMEOUT once budget has run out, and no wait (the
+// DNS lookup, the connect, each read or write) goes beyond it. budget may be NULL.
+esp_err_t http_session_init(http_session_t *session, const char *url, const wake_budget_t *budget);
+
+// closes the connection and frees the client, it is fine to call it more than once
+void http_session_deinit(http_session_t *session);
+
+// How long the following requests wait for the connection and each read or write, instead of the client's
+// default of 5 s. It is not a limit on the whole request, the session's budget is.
+esp_err_t http_session_set_timeout(http_session_t *session, int timeout_ms);
+
+// GET url (NULL for the session's url). validators works like for http_send_request.
+esp_err_t http_session_get(http_session_t *session, const char *url, http_validators_t *validators,
+        http_body_consumer_t consumer, void *context);
+
+// POST length bytes from producer to url (NULL for the session's url), the response body goes to consumer.
+// Redirects aren't followed for a POST.
+esp_err_t http_session_post(http_session_t *session, const char *url, const char *content_type, size_t length,
+        http_body_producer_t producer, http_body_consumer_t consumer, void *context);
+
+// One GET to CONFIG_DATABASE_URL on a session of its own.
+// If validators is not NULL, the request sends If-None-Match/If-Modified-Since from it. When the server answers
+// 304 (Not Modified), not_modified is set and the consumer isn't called. Otherwise the etag and last_modified of
+// the new response are stored in it once the whole body has been consumed.
+esp_err_t http_send_request(http_validators_t *validators, http_body_consumer_t consumer, void *context);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Streaming inflate for compressed HTTP response bodies (Content-Encoding gzip or deflate), on top of the
+// tinfl decompressor in ROM. Deflate can refer back up to 32 KB, so that much window is allocated while
+// a compressed body is being read, together with the decompressor state.
+
+typedef enum {
+    HTTP_ENCODING_IDENTITY,
+    HTTP_ENCODING_GZIP,
+    HTTP_ENCODING_DEFLATE,  // zlib wrapped, or raw deflate from servers that get it wrong
+} http_content_encoding_t;
+
+typedef struct http_inflate http_inflate_t;
+
+// returns NULL if there isn't enough memory
+http_inflate_t *http_inflate_create(http_content_encoding_t encoding);
+
+void http_inflate_delete(http_inflate_t *inflate);
+
+// Inflates from in into out. in_length and out_length give the sizes and receive how much was used. input_end
+// says that no more input follows in. done is set once the whole stream (with the gzip trailer) has been
+// inflated and handed out. Returns ESP_FAIL for corrupt or truncated data.
+esp_err_t http_inflate_run(http_inflate_t *inflate, const char *in, size_t *in_length, bool input_end,
+        char *out, size_t *out_length, bool *done);
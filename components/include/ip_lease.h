@@ -0,0 +1,21 @@
+#pragma once
+
+#include "esp_err.h"
+#include "esp_netif.h"
+
+// The station's IPv4 settings without a DHCP exchange on every wake. With CONFIG_WIFI_LEASE_CACHE the last
+// DHCP lease is kept in RTC slow memory and put straight onto the interface on the next wakes, until the time
+// the client would have to renew it (T1): up to then the server keeps the address for us. With
+// CONFIG_WIFI_STATIC_IP the configured address is used instead, and DHCP never runs.
+
+#define IP_LEASE_SSID_MAX_LEN   33
+
+// Stops the DHCP client and puts the cached lease (or the static address) onto netif, call it once the station
+// is associated. ESP_ERR_NOT_FOUND if there is no valid lease for ssid, DHCP is left running then.
+esp_err_t ip_lease_apply(esp_netif_t *netif, const char *ssid);
+
+// remembers the lease netif just got from DHCP. Does nothing if the address didn't come from DHCP
+void ip_lease_save(esp_netif_t *netif, const char *ssid);
+
+// forgets the cached lease, e.g. because the network didn't work with it
+void ip_lease_invalidate(void);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Runtime for the parsers and serializers generated by tools/json_bindgen.py.
+// The reader works directly on the input text and never allocates, the writer fills a caller supplied buffer.
+
+typedef struct {
+    const char *json;
+    size_t length;
+    size_t offset;
+    bool failed;    // set as soon as any read runs into malformed input
+} json_bind_reader_t;
+
+typedef struct {
+    char *buffer;
+    size_t size;
+    size_t length;
+    bool overflow;  // set if the output did not fit, length keeps counting
+} json_bind_writer_t;
+
+void json_bind_reader_init(json_bind_reader_t *reader, const char *json, size_t length);
+
+// consumes the '{' of an object
+bool json_bind_begin_object(json_bind_reader_t *reader);
+
+// reads the next key of an object (and the ':' after it). Returns false at the closing '}' or on malformed input.
+// first is true for the first member of the object. The key points into the input and is not unescaped,
+// so keys with escape sequences never match a schema key and are skipped.
+bool json_bind_next_key(json_bind_reader_t *reader, bool first, const char **key, size_t *key_length);
+
+// compares a key from json_bind_next_key with a schema key of the same length, ignoring ASCII case like
+// cJSON_GetObjectItem does
+bool json_bind_key_equals(const char *key, const char *name, size_t length);
+
+// consumes the '}' of an object, false if anything before failed
+bool json_bind_end_object(json_bind_reader_t *reader);
+
+// true if only whitespace (or a terminating '\0') follows
+bool json_bind_end_document(json_bind_reader_t *reader);
+
+bool json_bind_read_bool(json_bind_reader_t *reader, bool *value);
+
+// only accepts integers that fit into an int, not 7.0 or 1e3
+bool json_bind_read_int(json_bind_reader_t *reader, int *value);
+
+bool json_bind_read_double(json_bind_reader_t *reader, double *value);
+
+// unescapes the string into value, fails if it doesn't fit into size bytes (including the '\0')
+bool json_bind_read_string(json_bind_reader_t *reader, char *value, size_t size);
+
+// skips a value of a key that isn't in the schema. Nested containers are only checked for balanced brackets.
+bool json_bind_skip_value(json_bind_reader_t *reader);
+
+void json_bind_writer_init(json_bind_writer_t *writer, char *buffer, size_t size);
+
+void json_bind_write_raw(json_bind_writer_t *writer, const char *text, size_t length);
+
+void json_bind_write_bool(json_bind_writer_t *writer, bool value);
+
+void json_bind_write_int(json_bind_writer_t *writer, int value);
+
+void json_bind_write_double(json_bind_writer_t *writer, double value);
+
+void json_bind_write_string(json_bind_writer_t *writer, const char *value);
+
+// terminates the output. Returns ESP_ERR_INVALID_SIZE if it didn't fit, *length is then the size that would have been needed.
+esp_err_t json_bind_writer_finish(json_bind_writer_t *writer, size_t *length);
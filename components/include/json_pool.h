@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// Slab allocator for cJSON, for long-lived trees that are edited a lot (create/replace/delete).
+// cJSON nodes and short strings come from fixed-size blocks with a free list per size class, so
+// edits neither fragment the heap nor go through the heap allocator. Everything else (long strings,
+// print buffers, or a class that ran out of blocks) falls back to malloc/free.
+//
+// The cJSON hooks have no context argument, so one pool at a time is installed with json_pool_install().
+// Everything allocated while it is installed has to be freed while it is still installed, and from the
+// same task (the pool has no locking, like cJSON itself).
+
+#define JSON_POOL_STRING_CLASSES    3   // 16, 32 and 64 byte strings
+
+typedef struct {
+    size_t nodes;                                   // number of cJSON nodes
+    size_t strings[JSON_POOL_STRING_CLASSES];       // number of 16, 32 and 64 byte blocks for strings
+} json_pool_config_t;
+
+#define JSON_POOL_DEFAULT_CONFIG() {    \
+    .nodes = 256,                       \
+    .strings = { 128, 64, 32 },         \
+}
+
+typedef struct {
+    size_t in_use[JSON_POOL_STRING_CLASSES + 1];    // blocks in use, nodes first and then the string classes
+    size_t peak[JSON_POOL_STRING_CLASSES + 1];      // highest value of in_use
+    size_t fallbacks;                               // allocations that went to the heap
+} json_pool_stats_t;
+
+typedef struct {
+    size_t block_size;
+    size_t count;
+    size_t stats_index;     // index of this class in json_pool_stats_t
+    unsigned char *start;   // first block, the blocks of a class are contiguous
+    void *free_list;        // free blocks, each one starts with the pointer to the next
+} json_pool_class_t;
+
+typedef struct {
+    json_pool_class_t classes[JSON_POOL_STRING_CLASSES + 1];    // sorted by block size
+    unsigned char *memory;                                      // all blocks, allocated once
+    size_t memory_size;
+    json_pool_stats_t stats;
+} json_pool_t;
+
+// allocates the blocks for all classes in one piece
+esp_err_t json_pool_init(json_pool_t *pool, const json_pool_config_t *config);
+
+// frees the blocks, the pool must not be installed anymore
+void json_pool_deinit(json_pool_t *pool);
+
+// routes cJSON's allocations to pool (through cJSON_InitHooks), NULL goes back to malloc/free
+void json_pool_install(json_pool_t *pool);
+
+void json_pool_get_stats(const json_pool_t *pool, json_pool_stats_t *stats);
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// Push channel for settings updates while the device stays awake: an MQTT subscription to one topic. The broker
+// connection is kept up (and re-established) by the MQTT client task. Only the newest message is kept, an older
+// one that hasn't been received yet is replaced.
+
+#define PUSH_MESSAGE_MAX_LEN    1024
+
+typedef struct {
+    size_t length;
+    char data[PUSH_MESSAGE_MAX_LEN];
+} push_message_t;
+
+// connects to broker_uri (e.g. "mqtt://192.168.1.10") and subscribes to topic, needs a network connection
+esp_err_t push_start(const char *broker_uri, const char *topic);
+
+void push_stop(void);
+
+// waits up to timeout for the next message. Returns ESP_ERR_TIMEOUT if none came
+esp_err_t push_receive(push_message_t *message, TickType_t timeout);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Decides per wake whether to go online for the settings and the time, or to go back to sleep with the cached
+// settings. Most wakes come from the remote, often minutes after the last sync, and the settings rarely change.
+//
+// A sync is due once the sync interval has passed since the last one, after max_local_wakes wakes without one,
+// and whenever there is nothing to go on (no cached settings, no sync since power-on, clock never set). The
+// interval adapts between min_interval_s and max_interval_s: it doubles with every sync that finds the
+// settings unchanged and drops back to the minimum when they changed. The state is kept in RTC slow memory.
+
+typedef struct {
+    uint32_t min_interval_s;
+    uint32_t max_interval_s;
+    uint32_t max_local_wakes;
+} sync_policy_config_t;
+
+// call once per wake, before anything is brought up. settings_cached: there are settings to fall back on
+bool sync_policy_should_sync(const sync_policy_config_t *config, bool settings_cached);
+
+// a sync got the settings, config_hash identifies them. Call it after the clock was set, the interval is
+// measured on it
+void sync_policy_record_sync(const sync_policy_config_t *config, uint32_t config_hash);
+
+// the wake went without the network (by decision or because the sync failed)
+void sync_policy_record_local(void);
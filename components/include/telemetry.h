@@ -0,0 +1,77 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "wake_budget.h"
+
+// Wake-cycle telemetry. Kept in RTC slow memory, so it survives deep sleep (but not a power cycle).
+
+typedef struct {
+    uint32_t wake_count;
+    uint32_t last_handshake_ms;         // TCP connect + TLS handshake of the last connection this wake
+    // every new connection, a full TLS handshake each
+    uint32_t handshakes;
+    uint32_t handshake_ms_total;
+    // whole HTTP requests (headers and body), on a new connection and on a kept-alive one
+    uint32_t new_connection_requests;
+    uint32_t new_connection_request_ms_total;
+    uint32_t reused_connection_requests;
+    uint32_t reused_connection_request_ms_total;
+    // Wi-Fi, from esp_wifi_start to the IP address: to the access point cached from the last wake (no scan, no
+    // PMK derivation), and with a full scan
+    uint32_t last_wifi_connect_ms;
+    uint32_t cached_ap_connects;
+    uint32_t cached_ap_connect_ms_total;
+    uint32_t scan_connects;
+    uint32_t scan_connect_ms_total;
+    // how the network budget of the last wake that recorded one was spent, see wake_budget.h
+    uint32_t budget_ms;
+    uint32_t stage_ms[WAKE_STAGE_COUNT];
+    uint8_t stage_results[WAKE_STAGE_COUNT];    // wake_stage_result_t
+    uint32_t budget_exhausted_wakes;            // wakes in which a stage ran out of time
+} wake_telemetry_t;
+
+#define TELEMETRY_TIMING_SAMPLES    16  // most recent requests kept
+
+// Where the time of one HTTP request went, in microseconds. esp_http_client does the TCP connect and the TLS
+// handshake in one call, so they are measured together.
+typedef struct {
+    uint32_t wake;              // wake_count of the wake the request was made in
+    uint16_t status;            // HTTP status, 0 if the request failed before one came
+    bool connection_reused;     // sent on a kept-alive connection
+    uint32_t dns_us;            // own lookup (see dns_cache), about 0 from the cache. Without it lwIP resolves in connect_us
+    uint32_t connect_us;        // TCP connect and TLS handshake, 0 on a kept-alive connection
+    uint32_t send_us;           // writing the request line, headers and body
+    uint32_t first_byte_us;     // from the request sent to the response headers
+    uint32_t body_us;           // from the response headers to the last byte of the body
+    uint32_t body_length;       // bytes received, before inflating
+} telemetry_timing_t;
+
+// call once at the start of every wake
+void telemetry_wake_start(void);
+
+void telemetry_record_handshake(uint32_t duration_ms);
+
+void telemetry_record_request(uint32_t duration_ms, bool connection_reused);
+
+void telemetry_record_wifi_connect(uint32_t duration_ms, bool cached_ap);
+
+// keeps the outcome of the wake's budget, call it once the last stage is done
+void telemetry_record_budget(const wake_budget_t *budget);
+
+// adds a sample to the ring, replacing the oldest one when it is full
+void telemetry_record_timing(const telemetry_timing_t *timing);
+
+// copies up to max samples into timings, oldest first, and returns how many
+size_t telemetry_get_timings(telemetry_timing_t *timings, size_t max);
+
+// Writes the wake counters and the timing samples as JSON, for uploading. Returns ESP_ERR_INVALID_SIZE if it
+// doesn't fit into size bytes.
+esp_err_t telemetry_serialize(char *buffer, size_t size, size_t *length);
+
+// prints this wake's numbers and the averages over all wakes
+void telemetry_log(void);
+
+const wake_telemetry_t *telemetry_get(void);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// SNTP for the wake. It is set up once per boot before Wi-Fi connects, and wifi.c starts it the moment the
+// station gets an IP address, so the time request is on its way while the settings are fetched over HTTP.
+// Whoever needs the clock (the sleep time computation) waits for it with time_sync_wait.
+
+// sets up SNTP without sending anything yet. Calling it again does nothing
+esp_err_t time_sync_init(const char *server);
+
+// starts the requests, called from wifi.c's IP event handler. Does nothing before time_sync_init or once started
+void time_sync_start(void);
+
+// waits up to timeout for the first answer since time_sync_start. ESP_ERR_INVALID_STATE if it wasn't started
+esp_err_t time_sync_wait(TickType_t timeout);
+
+// ms from time_sync_start to the answer, or up to now if there is none yet. 0 if not started
+uint32_t time_sync_elapsed_ms(void);
+
+bool time_sync_done(void);
+
+void time_sync_deinit(void);
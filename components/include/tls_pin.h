@@ -0,0 +1,24 @@
+#pragma once
+
+#include "esp_err.h"
+
+// Pinned trust for the settings server (CONFIG_HTTP_TRUST_*), instead of searching the whole CA bundle.
+//
+// CONFIG_HTTP_TRUST_PINNED_CA: the server's chain is verified against one CA certificate, embedded from
+// CONFIG_HTTP_PINNED_CA_FILE (http.c passes it as cert_pem).
+// CONFIG_HTTP_TRUST_PINNED_SPKI: the server's certificate is accepted if the SHA-256 of its public key
+// (SubjectPublicKeyInfo, as in HPKP's pin-sha256) is CONFIG_HTTP_PINNED_SPKI_SHA256, and rejected otherwise.
+// No chain, name or validity dates are checked, so it also works before the clock is set.
+
+#if defined(CONFIG_HTTP_TRUST_PINNED_CA)
+#define TLS_TRUST_MODE  "pinned_ca"
+#elif defined(CONFIG_HTTP_TRUST_PINNED_SPKI)
+#define TLS_TRUST_MODE  "pinned_spki"
+#else
+#define TLS_TRUST_MODE  "bundle"
+#endif
+
+#ifdef CONFIG_HTTP_TRUST_PINNED_SPKI
+// For esp_http_client_config_t.crt_bundle_attach: makes mbedTLS check the pin instead of a CA chain
+esp_err_t tls_pin_spki_attach(void *conf);
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+// Time budget for the network part of a wake. Every stage (Wi-Fi, HTTP, SNTP) waits at most for what is left
+// of it instead of a fixed timeout of its own, so one bad access point or server can't keep the radio on.
+// Once it has run out, the wake goes on with what it has (the cached settings) and goes back to sleep.
+//
+// The functions take NULL for "no budget": no deadline, and backoffs only wait.
+
+typedef enum {
+    WAKE_STAGE_WIFI,
+    WAKE_STAGE_HTTP,
+    WAKE_STAGE_SNTP,
+    WAKE_STAGE_COUNT,
+} wake_stage_t;
+
+typedef enum {
+    WAKE_STAGE_SKIPPED,     // not started, e.g. HTTP without Wi-Fi
+    WAKE_STAGE_OK,
+    WAKE_STAGE_FAILED,      // gave up with time left (retries used up, bad response)
+    WAKE_STAGE_OUT_OF_TIME, // the budget ran out during it
+} wake_stage_result_t;
+
+typedef struct {
+    int64_t started_us;                             // esp_timer time of wake_budget_init
+    int64_t deadline_us;
+    uint32_t budget_ms;
+    int64_t stage_started_us;                       // of the stage in progress
+    uint32_t spent_ms[WAKE_STAGE_COUNT];
+    wake_stage_result_t results[WAKE_STAGE_COUNT];
+} wake_budget_t;
+
+void wake_budget_init(wake_budget_t *budget, uint32_t budget_ms);
+
+uint32_t wake_budget_remaining_ms(const wake_budget_t *budget);
+
+// what is left, for xEventGroupWaitBits and friends. portMAX_DELAY without a budget
+TickType_t wake_budget_remaining_ticks(const wake_budget_t *budget);
+
+// the smaller of timeout_ms and what is left
+uint32_t wake_budget_limit_ms(const wake_budget_t *budget, uint32_t timeout_ms);
+
+bool wake_budget_expired(const wake_budget_t *budget);
+
+void wake_budget_stage_begin(wake_budget_t *budget, wake_stage_t stage);
+
+// adds the time since wake_budget_stage_begin to the stage. A failure after the deadline counts as OUT_OF_TIME
+void wake_budget_stage_end(wake_budget_t *budget, wake_stage_t stage, wake_stage_result_t result);
+
+// the same for a stage that ran in the background alongside the others (SNTP), which measured its own time
+void wake_budget_stage_record(wake_budget_t *budget, wake_stage_t stage, uint32_t spent_ms, wake_stage_result_t result);
+
+// Waits before retry number attempt (0 for the first retry): base_ms doubled per attempt, at most max_ms, with
+// +-50% jitter so devices that lost the same access point don't all come back at once. Returns ESP_ERR_TIMEOUT
+// without waiting if the wait wouldn't leave any time for the retry.
+esp_err_t wake_budget_backoff(const wake_budget_t *budget, int attempt, uint32_t base_ms, uint32_t max_ms);
+
+// the same without waiting, for event handlers that arm a timer instead: writes the wait into delay_ms
+esp_err_t wake_budget_backoff_delay(const wake_budget_t *budget, int attempt, uint32_t base_ms, uint32_t max_ms,
+        uint32_t *delay_ms);
+
+const char *wake_budget_stage_name(wake_stage_t stage);
+
+const char *wake_budget_result_name(wake_stage_result_t result);
+
+// logs where the time went
+void wake_budget_log(const wake_budget_t *budget);
@@ -9,10 +9,25 @@
 #include "esp_attr.h"
 #include "esp_sleep.h"
 #include "esp_sntp.h"
+#include "wake_budget.h"
 
 esp_err_t wifi_initialize(void);
 
-esp_err_t wifi_connect(const char* wifi_ssid, const char* wifi_password);
+// Connects and waits for an IP address. The networks are the list in NVS (see wifi_profiles.h), or wifi_ssid and
+// wifi_password if there is none. They are tried in the order of their connect statistics, each a few times with
+// backoff, and with no statistics yet a short scan orders them by signal strength. Gives up with ESP_ERR_TIMEOUT
+// when budget (NULL for none) runs out, and ESP_FAIL when every network has failed.
+// After a deep sleep it first tries the access point of the last connection directly (BSSID, channel and PMK
+// kept in RTC memory), and falls back to the others if that doesn't work within a few seconds.
+esp_err_t wifi_connect(const char* wifi_ssid, const char* wifi_password, wake_budget_t *budget);
+
+// whether the address came from the lease cache or the static configuration (see ip_lease.h) instead of DHCP
+bool wifi_address_cached(void);
+
+// After the network didn't work with the cached lease: forgets it and waits for one from DHCP, at most for what
+// is left of budget. ESP_ERR_INVALID_STATE if the address came from DHCP already, ESP_ERR_NOT_SUPPORTED with
+// a static address.
+esp_err_t wifi_renew_address(wake_budget_t *budget);
 
 esp_err_t wifi_disconnect(void);
 
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// The access points the alarm may use, stored in NVS, and how well each of them has done, kept in RTC slow
+// memory (so the statistics start over after a power cycle, the list doesn't). wifi.c tries them in the order
+// wifi_profiles_rank gives.
+//
+// The list is in the NVS namespace "wifi_aps": "count" (u8) and the strings "ssid0", "pass0", "ssid1", ... up to
+// count - 1. Nothing in the firmware writes it yet, it is flashed from a CSV like tools/wifi_profiles.csv with
+// ESP-IDF's tools (nvs_partition_gen.py is in components/nvs_flash/nvs_partition_generator):
+//
+//     nvs_partition_gen.py generate tools/wifi_profiles.csv build/wifi_profiles.bin 0x6000
+//     parttool.py write_partition --partition-name=nvs --input build/wifi_profiles.bin
+//
+// 0x6000 is the size of the nvs partition in the default partition table. This replaces everything else in NVS
+// too (the PHY calibration is redone on the next boot).
+
+#define WIFI_PROFILES_MAX       4
+#define WIFI_PROFILE_SSID_LEN   33  // 32 and the '\0'
+#define WIFI_PROFILE_PASS_LEN   65  // a passphrase of up to 63 characters or the PSK as 64 hex digits, and the '\0'
+
+typedef struct {
+    char ssid[WIFI_PROFILE_SSID_LEN];
+    char password[WIFI_PROFILE_PASS_LEN];
+} wifi_profile_t;
+
+typedef struct {
+    char ssid[WIFI_PROFILE_SSID_LEN];   // empty for an unused entry
+    uint32_t attempts;
+    uint32_t successes;
+    uint32_t connect_ms_total;          // of the successful attempts, from their start to the IP address
+    int8_t last_rssi;                   // 0 if never seen
+} wifi_ap_stats_t;
+
+// Reads the list from NVS into profiles (room for WIFI_PROFILES_MAX). ESP_ERR_NOT_FOUND if none is stored.
+// Also drops the statistics of access points that are no longer in it.
+esp_err_t wifi_profiles_load(wifi_profile_t *profiles, size_t *count);
+
+// replaces the list in NVS, for a provisioning step
+esp_err_t wifi_profiles_store(const wifi_profile_t *profiles, size_t count);
+
+// the statistics of ssid, a new entry if it has none yet. NULL if the table is full
+wifi_ap_stats_t *wifi_profiles_stats(const char *ssid);
+
+// Writes the indexes of profiles into order, best first: by expected connect time (mean time divided by the
+// success rate), then the ones never tried, then the ones that never worked. Otherwise in list order.
+void wifi_profiles_rank(const wifi_profile_t *profiles, size_t count, uint8_t *order);
+
+// whether any of profiles has connected before, i.e. whether wifi_profiles_rank has anything to go on
+bool wifi_profiles_have_history(const wifi_profile_t *profiles, size_t count);
+
+void wifi_profiles_log(const wifi_profile_t *profiles, size_t count);
@@ -0,0 +1,124 @@
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "lwip/dhcp.h"
+#include "ip_lease.h"
+
+#define IP_LEASE_MAX_REUSE_S    86400   // even if the server renews less often, in case the network changed
+
+static const char *TAG = "ip_lease";
+
+RTC_SLOW_ATTR static struct {
+    char ssid[IP_LEASE_SSID_MAX_LEN];   // empty if nothing is cached
+    esp_netif_ip_info_t ip_info;
+    esp_netif_dns_info_t dns;
+    time_t expires;
+    uint32_t reuse_s;
+} lease;
+
+// ---------------- PRIVATE FUNCTIONS -------------
+#if defined(CONFIG_WIFI_STATIC_IP)
+static esp_err_t get_settings(const char *ssid, esp_netif_ip_info_t *ip_info, esp_netif_dns_info_t *dns) {
+    memset(dns, 0, sizeof(*dns));
+    ip_info->ip.addr = esp_ip4addr_aton(CONFIG_WIFI_STATIC_IP_ADDRESS);
+    ip_info->netmask.addr = esp_ip4addr_aton(CONFIG_WIFI_STATIC_IP_NETMASK);
+    ip_info->gw.addr = esp_ip4addr_aton(CONFIG_WIFI_STATIC_IP_GATEWAY);
+    dns->ip.type = ESP_IPADDR_TYPE_V4;
+    dns->ip.u_addr.ip4.addr = esp_ip4addr_aton(CONFIG_WIFI_STATIC_IP_DNS);
+    return ESP_OK;
+}
+#elif defined(CONFIG_WIFI_LEASE_CACHE)
+static esp_err_t get_settings(const char *ssid, esp_netif_ip_info_t *ip_info, esp_netif_dns_info_t *dns) {
+    time_t now = time(NULL);
+
+    if (lease.ssid[0] == '\0' || strcmp(lease.ssid, ssid) != 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    // the clock can jump when SNTP sets it, an expiry too far ahead means the lease is from before that
+    if (now >= lease.expires || lease.expires - now > lease.reuse_s) {
+        ESP_LOGI(TAG, "Cached lease expired");
+        return ESP_ERR_NOT_FOUND;
+    }
+    *ip_info = lease.ip_info;
+    *dns = lease.dns;
+    return ESP_OK;
+}
+#else
+static esp_err_t get_settings(const char *ssid, esp_netif_ip_info_t *ip_info, esp_netif_dns_info_t *dns) {
+    return ESP_ERR_NOT_FOUND;
+}
+#endif
+
+// ---------------- PUBLIC FUNCTIONS -------------
+esp_err_t ip_lease_apply(esp_netif_t *netif, const char *ssid) {
+    esp_netif_ip_info_t ip_info;
+    esp_netif_dns_info_t dns;
+
+    esp_err_t err = get_settings(ssid, &ip_info, &dns);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = esp_netif_dhcpc_stop(netif);
+    if (err != ESP_OK && err != ESP_ERR_ESP_NETIF_DHCP_ALREADY_STOPPED) {
+        ESP_LOGE(TAG, "Failed to stop DHCP: %s", esp_err_to_name(err));
+        return err;
+    }
+    // posts IP_EVENT_STA_GOT_IP like a DHCP lease would
+    err = esp_netif_set_ip_info(netif, &ip_info);
+    if (err == ESP_OK && dns.ip.u_addr.ip4.addr != 0) {
+        err = esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set the address: %s", esp_err_to_name(err));
+        esp_netif_dhcpc_start(netif);
+        return err;
+    }
+    ESP_LOGI(TAG, "Using %s address " IPSTR ", gateway " IPSTR,
+#ifdef CONFIG_WIFI_STATIC_IP
+            "the static",
+#else
+            "the cached",
+#endif
+            IP2STR(&ip_info.ip), IP2STR(&ip_info.gw));
+    return ESP_OK;
+}
+
+void ip_lease_save(esp_netif_t *netif, const char *ssid) {
+#ifdef CONFIG_WIFI_LEASE_CACHE
+    esp_netif_dhcp_status_t status;
+    esp_netif_ip_info_t ip_info;
+
+    if (esp_netif_dhcpc_get_status(netif, &status) != ESP_OK || status != ESP_NETIF_DHCP_STARTED ||
+            esp_netif_get_ip_info(netif, &ip_info) != ESP_OK || strlen(ssid) >= sizeof(lease.ssid)) {
+        return;
+    }
+    // esp_netif doesn't report the lease times, lwIP's DHCP client has them
+    struct dhcp *dhcp = netif_dhcp_data((struct netif *)esp_netif_get_netif_impl(netif));
+    if (dhcp == NULL) {
+        return;
+    }
+    uint32_t reuse_s = dhcp->offered_t1_renew ? dhcp->offered_t1_renew : dhcp->offered_t0_lease / 2;
+    if (reuse_s == 0) {
+        return;
+    }
+    if (reuse_s > IP_LEASE_MAX_REUSE_S) {
+        reuse_s = IP_LEASE_MAX_REUSE_S;
+    }
+
+    lease.ssid[0] = '\0';
+    lease.ip_info = ip_info;
+    if (esp_netif_get_dns_info(netif, ESP_NETIF_DNS_MAIN, &lease.dns) != ESP_OK) {
+        memset(&lease.dns, 0, sizeof(lease.dns));
+    }
+    lease.reuse_s = reuse_s;
+    lease.expires = time(NULL) + reuse_s;
+    strcpy(lease.ssid, ssid);
+    ESP_LOGI(TAG, "Keeping the lease of " IPSTR " for %"PRIu32" s", IP2STR(&ip_info.ip), reuse_s);
+#endif
+}
+
+void ip_lease_invalidate(void) {
+    lease.ssid[0] = '\0';
+}
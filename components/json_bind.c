@@ -0,0 +1,507 @@
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "json_bind.h"
+
+#define JSON_BIND_SKIP_DEPTH_LIMIT  32
+#define JSON_BIND_NUMBER_LENGTH     64
+
+// ---------------- PRIVATE FUNCTIONS -------------
+static bool fail(json_bind_reader_t *reader) {
+    reader->failed = true;
+    return false;
+}
+
+static inline bool at_end(const json_bind_reader_t *reader) {
+    return reader->offset >= reader->length || reader->json[reader->offset] == '\0';
+}
+
+static void skip_whitespace(json_bind_reader_t *reader) {
+    while (reader->offset < reader->length) {
+        char c = reader->json[reader->offset];
+        if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+            break;
+        }
+        reader->offset++;
+    }
+}
+
+// skips whitespace and consumes c if it comes next
+static bool consume(json_bind_reader_t *reader, char c) {
+    skip_whitespace(reader);
+    if (at_end(reader) || reader->json[reader->offset] != c) {
+        return false;
+    }
+    reader->offset++;
+    return true;
+}
+
+static bool consume_literal(json_bind_reader_t *reader, const char *literal, size_t length) {
+    if (reader->length - reader->offset < length || memcmp(reader->json + reader->offset, literal, length) != 0) {
+        return false;
+    }
+    reader->offset += length;
+    return true;
+}
+
+// finds the end of the string that starts at the current offset, which has to be a quote
+static bool scan_string(json_bind_reader_t *reader, size_t *start, size_t *end) {
+    size_t i;
+
+    if (at_end(reader) || reader->json[reader->offset] != '"') {
+        return false;
+    }
+    for (i = reader->offset + 1; i < reader->length; i++) {
+        if (reader->json[i] == '\\') {
+            i++;
+        }
+        else if (reader->json[i] == '"') {
+            *start = reader->offset + 1;
+            *end = i;
+            reader->offset = i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_hex4(const char *input, unsigned int *value) {
+    int i;
+
+    *value = 0;
+    for (i = 0; i < 4; i++) {
+        char c = input[i];
+        *value <<= 4;
+        if (c >= '0' && c <= '9') {
+            *value += (unsigned int)(c - '0');
+        }
+        else if (c >= 'a' && c <= 'f') {
+            *value += (unsigned int)(c - 'a' + 10);
+        }
+        else if (c >= 'A' && c <= 'F') {
+            *value += (unsigned int)(c - 'A' + 10);
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// appends the code point as UTF-8, false if it doesn't fit
+static bool append_utf8(char *value, size_t size, size_t *length, unsigned int code_point) {
+    unsigned char utf8[4];
+    size_t utf8_length;
+
+    if (code_point < 0x80) {
+        utf8[0] = (unsigned char)code_point;
+        utf8_length = 1;
+    }
+    else if (code_point < 0x800) {
+        utf8[0] = (unsigned char)(0xC0 | (code_point >> 6));
+        utf8[1] = (unsigned char)(0x80 | (code_point & 0x3F));
+        utf8_length = 2;
+    }
+    else if (code_point < 0x10000) {
+        utf8[0] = (unsigned char)(0xE0 | (code_point >> 12));
+        utf8[1] = (unsigned char)(0x80 | ((code_point >> 6) & 0x3F));
+        utf8[2] = (unsigned char)(0x80 | (code_point & 0x3F));
+        utf8_length = 3;
+    }
+    else {
+        utf8[0] = (unsigned char)(0xF0 | (code_point >> 18));
+        utf8[1] = (unsigned char)(0x80 | ((code_point >> 12) & 0x3F));
+        utf8[2] = (unsigned char)(0x80 | ((code_point >> 6) & 0x3F));
+        utf8[3] = (unsigned char)(0x80 | (code_point & 0x3F));
+        utf8_length = 4;
+    }
+
+    if (size - *length <= utf8_length) {
+        return false;   // keep space for the '\0'
+    }
+    memcpy(value + *length, utf8, utf8_length);
+    *length += utf8_length;
+    return true;
+}
+
+// copies the number at the current offset into buffer (NUL terminated) for strtod/strtol
+static bool copy_number(json_bind_reader_t *reader, char *buffer, size_t size) {
+    size_t length = 0;
+
+    skip_whitespace(reader);
+    while (reader->offset + length < reader->length) {
+        char c = reader->json[reader->offset + length];
+        if (!((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E')) {
+            break;
+        }
+        if (length + 1 >= size) {
+            return false;
+        }
+        buffer[length] = c;
+        length++;
+    }
+    buffer[length] = '\0';
+    return length > 0;
+}
+
+static void write_char(json_bind_writer_t *writer, char c) {
+    json_bind_write_raw(writer, &c, 1);
+}
+
+// ---------------- PUBLIC FUNCTIONS -------------
+void json_bind_reader_init(json_bind_reader_t *reader, const char *json, size_t length) {
+    reader->json = json;
+    reader->length = length;
+    reader->offset = 0;
+    reader->failed = false;
+}
+
+bool json_bind_begin_object(json_bind_reader_t *reader) {
+    return consume(reader, '{') || fail(reader);
+}
+
+bool json_bind_next_key(json_bind_reader_t *reader, bool first, const char **key, size_t *key_length) {
+    size_t start, end;
+
+    skip_whitespace(reader);
+    if (reader->failed || at_end(reader)) {
+        return fail(reader);
+    }
+    if (reader->json[reader->offset] == '}') {
+        return false;   // end of the object, consumed by json_bind_end_object
+    }
+    if (!first && !consume(reader, ',')) {
+        return fail(reader);
+    }
+
+    skip_whitespace(reader);
+    if (!scan_string(reader, &start, &end) || !consume(reader, ':')) {
+        return fail(reader);
+    }
+    *key = reader->json + start;
+    *key_length = end - start;
+    return true;
+}
+
+bool json_bind_key_equals(const char *key, const char *name, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        unsigned char a = (unsigned char)key[i], b = (unsigned char)name[i];
+        if (a != b && ((a | 0x20) != (b | 0x20) || (a | 0x20) < 'a' || (a | 0x20) > 'z')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool json_bind_end_object(json_bind_reader_t *reader) {
+    return !reader->failed && (consume(reader, '}') || fail(reader));
+}
+
+bool json_bind_end_document(json_bind_reader_t *reader) {
+    skip_whitespace(reader);
+    return !reader->failed && at_end(reader);
+}
+
+bool json_bind_read_bool(json_bind_reader_t *reader, bool *value) {
+    skip_whitespace(reader);
+    if (consume_literal(reader, "true", 4)) {
+        *value = true;
+        return true;
+    }
+    if (consume_literal(reader, "false", 5)) {
+        *value = false;
+        return true;
+    }
+    return fail(reader);
+}
+
+bool json_bind_read_int(json_bind_reader_t *reader, int *value) {
+    bool negative = false;
+    unsigned int limit = INT_MAX;
+    unsigned int result = 0;
+    size_t digits = 0;
+
+    skip_whitespace(reader);
+    if (!at_end(reader) && reader->json[reader->offset] == '-') {
+        negative = true;
+        limit = (unsigned int)INT_MAX + 1;
+        reader->offset++;
+    }
+    while (!at_end(reader) && reader->json[reader->offset] >= '0' && reader->json[reader->offset] <= '9') {
+        unsigned int digit = (unsigned int)(reader->json[reader->offset] - '0');
+        if (result > (limit - digit) / 10) {
+            return fail(reader);    // doesn't fit into an int
+        }
+        result = result * 10 + digit;
+        reader->offset++;
+        digits++;
+    }
+    if (digits == 0) {
+        return fail(reader);
+    }
+    // fractions and exponents make it a double
+    if (!at_end(reader) && (reader->json[reader->offset] == '.' || reader->json[reader->offset] == 'e' || reader->json[reader->offset] == 'E')) {
+        return fail(reader);
+    }
+
+    // INT_MIN can't be negated as an int, so subtract from -1 instead
+    *value = negative ? (result == 0 ? 0 : -(int)(result - 1) - 1) : (int)result;
+    return true;
+}
+
+bool json_bind_read_double(json_bind_reader_t *reader, double *value) {
+    char number[JSON_BIND_NUMBER_LENGTH];
+    char *end = NULL;
+
+    if (!copy_number(reader, number, sizeof(number))) {
+        return fail(reader);
+    }
+    *value = strtod(number, &end);
+    if (end == number) {
+        return fail(reader);
+    }
+    reader->offset += (size_t)(end - number);
+    return true;
+}
+
+bool json_bind_read_string(json_bind_reader_t *reader, char *value, size_t size) {
+    size_t start, end, i;
+    size_t length = 0;
+
+    skip_whitespace(reader);
+    if (size == 0 || !scan_string(reader, &start, &end)) {
+        return fail(reader);
+    }
+
+    for (i = start; i < end; i++) {
+        unsigned int code_point;
+        char c = reader->json[i];
+
+        if (c != '\\') {
+            if (length + 1 >= size) {
+                return fail(reader);
+            }
+            value[length++] = c;
+            continue;
+        }
+
+        i++;
+        switch (reader->json[i]) {
+            case '"':
+            case '\\':
+            case '/':
+                code_point = (unsigned char)reader->json[i];
+                break;
+            case 'b':
+                code_point = '\b';
+                break;
+            case 'f':
+                code_point = '\f';
+                break;
+            case 'n':
+                code_point = '\n';
+                break;
+            case 'r':
+                code_point = '\r';
+                break;
+            case 't':
+                code_point = '\t';
+                break;
+            case 'u':
+                if (end - i < 5 || !parse_hex4(reader->json + i + 1, &code_point)) {
+                    return fail(reader);
+                }
+                i += 4;
+                if (code_point >= 0xD800 && code_point <= 0xDBFF) {
+                    // high surrogate, has to be followed by \u and a low surrogate
+                    unsigned int low;
+                    if (end - i < 7 || reader->json[i + 1] != '\\' || reader->json[i + 2] != 'u' ||
+                        !parse_hex4(reader->json + i + 3, &low) || low < 0xDC00 || low > 0xDFFF) {
+                        return fail(reader);
+                    }
+                    code_point = 0x10000 + (((code_point & 0x3FF) << 10) | (low & 0x3FF));
+                    i += 6;
+                }
+                else if (code_point >= 0xDC00 && code_point <= 0xDFFF) {
+                    return fail(reader);
+                }
+                break;
+            default:
+                return fail(reader);
+        }
+        if (!append_utf8(value, size, &length, code_point)) {
+            return fail(reader);
+        }
+    }
+
+    value[length] = '\0';
+    return true;
+}
+
+bool json_bind_skip_value(json_bind_reader_t *reader) {
+    size_t start, end;
+    int depth = 0;
+
+    skip_whitespace(reader);
+    do {
+        if (reader->failed || at_end(reader)) {
+            return fail(reader);
+        }
+
+        switch (reader->json[reader->offset]) {
+            case '"':
+                if (!scan_string(reader, &start, &end)) {
+                    return fail(reader);
+                }
+                break;
+            case '{':
+            case '[':
+                if (++depth > JSON_BIND_SKIP_DEPTH_LIMIT) {
+                    return fail(reader);
+                }
+                reader->offset++;
+                break;
+            case '}':
+            case ']':
+                if (--depth < 0) {
+                    return fail(reader);
+                }
+                reader->offset++;
+                break;
+            case ',':
+            case ':':
+                if (depth == 0) {
+                    return fail(reader);
+                }
+                reader->offset++;
+                break;
+            default: {
+                // a number or literal, up to the next delimiter
+                size_t scalar_start = reader->offset;
+                while (!at_end(reader) && strchr(",:]} \t\r\n\"{[", reader->json[reader->offset]) == NULL) {
+                    reader->offset++;
+                }
+                if (reader->offset == scalar_start) {
+                    return fail(reader);
+                }
+                break;
+            }
+        }
+        skip_whitespace(reader);
+    } while (depth > 0);
+
+    return true;
+}
+
+void json_bind_writer_init(json_bind_writer_t *writer, char *buffer, size_t size) {
+    writer->buffer = buffer;
+    writer->size = size;
+    writer->length = 0;
+    writer->overflow = false;
+}
+
+void json_bind_write_raw(json_bind_writer_t *writer, const char *text, size_t length) {
+    // one byte is kept for the '\0' written by json_bind_writer_finish
+    if (!writer->overflow && writer->size - writer->length > length) {
+        memcpy(writer->buffer + writer->length, text, length);
+    }
+    else {
+        writer->overflow = true;
+    }
+    writer->length += length;
+}
+
+void json_bind_write_bool(json_bind_writer_t *writer, bool value) {
+    if (value) {
+        json_bind_write_raw(writer, "true", 4);
+    }
+    else {
+        json_bind_write_raw(writer, "false", 5);
+    }
+}
+
+void json_bind_write_int(json_bind_writer_t *writer, int value) {
+    char number[12];
+    int length = snprintf(number, sizeof(number), "%d", value);
+    json_bind_write_raw(writer, number, (size_t)length);
+}
+
+void json_bind_write_double(json_bind_writer_t *writer, double value) {
+    char number[32];
+    int length;
+
+    // JSON has no representation for these
+    if (isnan(value) || isinf(value)) {
+        json_bind_write_raw(writer, "null", 4);
+        return;
+    }
+
+    // shortest of the two precisions that survives the round trip, like cJSON
+    length = snprintf(number, sizeof(number), "%1.15g", value);
+    if (strtod(number, NULL) != value) {
+        length = snprintf(number, sizeof(number), "%1.17g", value);
+    }
+    json_bind_write_raw(writer, number, (size_t)length);
+}
+
+void json_bind_write_string(json_bind_writer_t *writer, const char *value) {
+    static const char hex_digits[] = "0123456789abcdef";
+    const char *run = value;
+
+    write_char(writer, '"');
+    for (; *value != '\0'; value++) {
+        unsigned char c = (unsigned char)*value;
+        char escape[6] = { '\\', 0, '0', '0', 0, 0 };
+        size_t escape_length = 2;
+
+        switch (c) {
+            case '"':
+            case '\\':
+                escape[1] = (char)c;
+                break;
+            case '\b':
+                escape[1] = 'b';
+                break;
+            case '\f':
+                escape[1] = 'f';
+                break;
+            case '\n':
+                escape[1] = 'n';
+                break;
+            case '\r':
+                escape[1] = 'r';
+                break;
+            case '\t':
+                escape[1] = 't';
+                break;
+            default:
+                if (c >= 0x20) {
+                    continue;
+                }
+                escape[1] = 'u';
+                escape[4] = hex_digits[c >> 4];
+                escape[5] = hex_digits[c & 0x0F];
+                escape_length = 6;
+                break;
+        }
+
+        json_bind_write_raw(writer, run, (size_t)(value - run));
+        json_bind_write_raw(writer, escape, escape_length);
+        run = value + 1;
+    }
+    json_bind_write_raw(writer, run, (size_t)(value - run));
+    write_char(writer, '"');
+}
+
+esp_err_t json_bind_writer_finish(json_bind_writer_t *writer, size_t *length) {
+    if (length != NULL) {
+        *length = writer->length;
+    }
+    if (writer->overflow || writer->size == 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    writer->buffer[writer->length] = '\0';
+    return ESP_OK;
+}
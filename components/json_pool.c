@@ -0,0 +1,146 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cJSON.h"
+#include "json_pool.h"
+
+// every block can hold the free list pointer and any type cJSON stores in it
+#define JSON_POOL_ALIGNMENT sizeof(double)
+#define ALIGN_UP(size)      (((size) + JSON_POOL_ALIGNMENT - 1) & ~(JSON_POOL_ALIGNMENT - 1))
+
+static const size_t string_block_sizes[JSON_POOL_STRING_CLASSES] = { 16, 32, 64 };
+
+static json_pool_t *active_pool = NULL;
+
+// ---------------- PRIVATE FUNCTIONS -------------
+static void *pool_malloc(size_t size) {
+    json_pool_t *pool = active_pool;
+    size_t i;
+
+    // the classes are sorted by size, so the first one that fits wastes the least
+    for (i = 0; i < JSON_POOL_STRING_CLASSES + 1; i++) {
+        json_pool_class_t *slab = &pool->classes[i];
+        if (size <= slab->block_size && slab->free_list != NULL) {
+            void *block = slab->free_list;
+            slab->free_list = *(void **)block;
+            if (++pool->stats.in_use[slab->stats_index] > pool->stats.peak[slab->stats_index]) {
+                pool->stats.peak[slab->stats_index] = pool->stats.in_use[slab->stats_index];
+            }
+            return block;
+        }
+    }
+
+    pool->stats.fallbacks++;
+    return malloc(size);
+}
+
+static void pool_free(void *pointer) {
+    json_pool_t *pool = active_pool;
+    unsigned char *block = pointer;
+    size_t i;
+
+    if (pointer == NULL) {
+        return;
+    }
+
+    if (block >= pool->memory && block < pool->memory + pool->memory_size) {
+        for (i = 0; i < JSON_POOL_STRING_CLASSES + 1; i++) {
+            json_pool_class_t *slab = &pool->classes[i];
+            if (block >= slab->start && block < slab->start + slab->block_size * slab->count) {
+                *(void **)block = slab->free_list;
+                slab->free_list = block;
+                pool->stats.in_use[slab->stats_index]--;
+                return;
+            }
+        }
+    }
+
+    free(pointer);
+}
+
+// ---------------- PUBLIC FUNCTIONS -------------
+esp_err_t json_pool_init(json_pool_t *pool, const json_pool_config_t *config) {
+    size_t counts[JSON_POOL_STRING_CLASSES + 1];
+    size_t sizes[JSON_POOL_STRING_CLASSES + 1];
+    size_t stats_indexes[JSON_POOL_STRING_CLASSES + 1];
+    size_t i, j, offset = 0;
+
+    if (pool == NULL || config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(pool, 0, sizeof(*pool));
+
+    counts[0] = config->nodes;
+    sizes[0] = ALIGN_UP(sizeof(cJSON));
+    stats_indexes[0] = 0;
+    for (i = 0; i < JSON_POOL_STRING_CLASSES; i++) {
+        counts[i + 1] = config->strings[i];
+        sizes[i + 1] = ALIGN_UP(string_block_sizes[i]);
+        stats_indexes[i + 1] = i + 1;
+    }
+
+    // keep the classes sorted by block size (cJSON nodes are 40 bytes on 32 bit targets, 64 on 64 bit hosts)
+    for (i = 1; i < JSON_POOL_STRING_CLASSES + 1; i++) {
+        for (j = i; j > 0 && sizes[j - 1] > sizes[j]; j--) {
+            size_t size = sizes[j];
+            size_t count = counts[j];
+            size_t stats_index = stats_indexes[j];
+            sizes[j] = sizes[j - 1];
+            counts[j] = counts[j - 1];
+            stats_indexes[j] = stats_indexes[j - 1];
+            sizes[j - 1] = size;
+            counts[j - 1] = count;
+            stats_indexes[j - 1] = stats_index;
+        }
+    }
+
+    for (i = 0; i < JSON_POOL_STRING_CLASSES + 1; i++) {
+        pool->memory_size += sizes[i] * counts[i];
+    }
+    if (pool->memory_size > 0) {
+        pool->memory = malloc(pool->memory_size);
+        if (pool->memory == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    for (i = 0; i < JSON_POOL_STRING_CLASSES + 1; i++) {
+        json_pool_class_t *slab = &pool->classes[i];
+        slab->block_size = sizes[i];
+        slab->count = counts[i];
+        slab->stats_index = stats_indexes[i];
+        slab->start = pool->memory + offset;
+        offset += sizes[i] * counts[i];
+
+        // thread the free list through the blocks, lowest address first
+        for (j = counts[i]; j > 0; j--) {
+            void *block = slab->start + (j - 1) * sizes[i];
+            *(void **)block = slab->free_list;
+            slab->free_list = block;
+        }
+    }
+
+    return ESP_OK;
+}
+
+void json_pool_deinit(json_pool_t *pool) {
+    if (pool == NULL) {
+        return;
+    }
+    free(pool->memory);
+    memset(pool, 0, sizeof(*pool));
+}
+
+void json_pool_install(json_pool_t *pool) {
+    cJSON_Hooks hooks = {
+        .malloc_fn = pool_malloc,
+        .free_fn = pool_free,
+    };
+
+    active_pool = pool;
+    cJSON_InitHooks(pool != NULL ? &hooks : NULL);
+}
+
+void json_pool_get_stats(const json_pool_t *pool, json_pool_stats_t *stats) {
+    *stats = pool->stats;
+}
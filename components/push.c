@@ -0,0 +1,102 @@
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/queue.h"
+#include "mqtt_client.h"
+#include "push.h"
+
+static const char *TAG = "push";
+
+static esp_mqtt_client_handle_t client = NULL;
+static QueueHandle_t messages = NULL;   // holds one message, the newest
+static const char *subscribed_topic;
+static push_message_t assembly;         // a message arriving in pieces, static to keep it off the MQTT task's stack
+
+// ---------------- PRIVATE FUNCTIONS -------------
+/**
+ * @brief Event handler for the MQTT client, runs in its task
+ */
+static void mqtt_event_cb(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    esp_mqtt_event_handle_t event = event_data;
+
+    switch ((esp_mqtt_event_id_t)event_id) {
+        case MQTT_EVENT_CONNECTED:
+            // also after a reconnect, the broker may not have kept the subscription.
+            // a retained message on the topic arrives right away, so the device starts with the current settings
+            ESP_LOGI(TAG, "Connected to the broker, subscribing to %s", subscribed_topic);
+            esp_mqtt_client_subscribe(client, subscribed_topic, 1);
+            break;
+        case MQTT_EVENT_DISCONNECTED:
+            ESP_LOGW(TAG, "Disconnected from the broker, the client reconnects by itself");
+            break;
+        case MQTT_EVENT_DATA:
+            // a long message comes in several events, put it back together
+            if (event->total_data_len > (int)sizeof(assembly.data)) {
+                if (event->current_data_offset == 0) {
+                    ESP_LOGE(TAG, "Message of %d bytes is too long, dropped", event->total_data_len);
+                }
+                break;
+            }
+            memcpy(assembly.data + event->current_data_offset, event->data, event->data_len);
+            if (event->current_data_offset + event->data_len == event->total_data_len) {
+                assembly.length = event->total_data_len;
+                xQueueOverwrite(messages, &assembly);
+            }
+            break;
+        case MQTT_EVENT_ERROR:
+            ESP_LOGE(TAG, "MQTT_EVENT_ERROR");
+            break;
+        default:
+            break;
+    }
+}
+
+// ---------------- PUBLIC FUNCTIONS -------------
+esp_err_t push_start(const char *broker_uri, const char *topic) {
+    esp_mqtt_client_config_t config = {
+        .broker.address.uri = broker_uri,
+    };
+
+    if (client != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    messages = xQueueCreate(1, sizeof(push_message_t));
+    if (messages == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    subscribed_topic = topic;
+
+    client = esp_mqtt_client_init(&config);
+    if (client == NULL) {
+        ESP_LOGE(TAG, "Failed to initialize MQTT client");
+        push_stop();
+        return ESP_FAIL;
+    }
+    esp_err_t err = esp_mqtt_client_register_event(client, ESP_EVENT_ANY_ID, mqtt_event_cb, NULL);
+    if (err == ESP_OK) {
+        err = esp_mqtt_client_start(client);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start MQTT client: %s", esp_err_to_name(err));
+        push_stop();
+    }
+    return err;
+}
+
+void push_stop(void) {
+    if (client != NULL) {
+        esp_mqtt_client_destroy(client);
+        client = NULL;
+    }
+    if (messages != NULL) {
+        vQueueDelete(messages);
+        messages = NULL;
+    }
+}
+
+esp_err_t push_receive(push_message_t *message, TickType_t timeout) {
+    if (messages == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return (xQueueReceive(messages, message, timeout) == pdPASS) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
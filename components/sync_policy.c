@@ -0,0 +1,71 @@
+#include <inttypes.h>
+#include <time.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "sync_policy.h"
+
+// anything earlier means the clock was never set (SNTP or a previous wake)
+#define SYNC_POLICY_VALID_TIME  1704067200  // 2024-01-01
+
+static const char *TAG = "sync_policy";
+
+RTC_SLOW_ATTR static struct {
+    bool valid;                 // false after power-on
+    time_t last_sync;
+    uint32_t config_hash;
+    uint32_t interval_s;        // current sync interval
+    uint32_t local_wakes;       // since the last sync
+    uint32_t syncs;
+    uint32_t changes;           // syncs that found different settings
+} state;
+
+// ---------------- PUBLIC FUNCTIONS -------------
+bool sync_policy_should_sync(const sync_policy_config_t *config, bool settings_cached) {
+    time_t now = time(NULL);
+
+    if (!state.valid || !settings_cached) {
+        ESP_LOGI(TAG, "Sync: no settings yet");
+        return true;
+    }
+    if (now < SYNC_POLICY_VALID_TIME || now < state.last_sync) {
+        ESP_LOGI(TAG, "Sync: the clock isn't set or went back");
+        return true;
+    }
+    if (state.local_wakes >= config->max_local_wakes) {
+        ESP_LOGI(TAG, "Sync: %"PRIu32" wakes without one", state.local_wakes);
+        return true;
+    }
+    uint32_t since_s = (uint32_t)(now - state.last_sync);
+    if (since_s >= state.interval_s) {
+        ESP_LOGI(TAG, "Sync: last one %"PRIu32" s ago, interval %"PRIu32" s", since_s, state.interval_s);
+        return true;
+    }
+    ESP_LOGI(TAG, "No sync: last one %"PRIu32" s ago, next after %"PRIu32" s or %"PRIu32" more wakes", since_s,
+            state.interval_s, config->max_local_wakes - state.local_wakes);
+    return false;
+}
+
+void sync_policy_record_sync(const sync_policy_config_t *config, uint32_t config_hash) {
+    bool changed = !state.valid || config_hash != state.config_hash;
+
+    if (changed || state.interval_s < config->min_interval_s) {
+        state.interval_s = config->min_interval_s;
+    }
+    else {
+        // settled settings are checked less and less often
+        state.interval_s = (state.interval_s > config->max_interval_s / 2) ? config->max_interval_s
+                : state.interval_s * 2;
+    }
+    state.syncs++;
+    state.changes += changed;
+    state.config_hash = config_hash;
+    state.last_sync = time(NULL);
+    state.local_wakes = 0;
+    state.valid = true;
+    ESP_LOGI(TAG, "Settings %s (%"PRIu32" changes in %"PRIu32" syncs), next sync in %"PRIu32" s",
+            changed ? "changed" : "unchanged", state.changes, state.syncs, state.interval_s);
+}
+
+void sync_policy_record_local(void) {
+    state.local_wakes++;
+}
@@ -0,0 +1,189 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "json_bind.h"
+#include "telemetry.h"
+#include "tls_pin.h"
+
+static const char *TAG = "telemetry";
+
+#define WRITE_LITERAL(writer, text) json_bind_write_raw((writer), (text), sizeof(text) - 1)
+
+RTC_SLOW_ATTR static wake_telemetry_t telemetry;
+
+RTC_SLOW_ATTR static struct {
+    telemetry_timing_t samples[TELEMETRY_TIMING_SAMPLES];
+    uint32_t next;      // where the next sample goes
+    uint32_t count;
+} timings;
+
+// ---------------- PRIVATE FUNCTIONS -------------
+static inline uint32_t average(uint32_t total, uint32_t count) {
+    return count ? total / count : 0;
+}
+
+// json_bind_write_int() takes an int, the counters can go beyond that
+static void write_uint(json_bind_writer_t *writer, uint32_t value) {
+    char number[11];
+    int length = snprintf(number, sizeof(number), "%"PRIu32, value);
+    json_bind_write_raw(writer, number, (size_t)length);
+}
+
+static void write_member(json_bind_writer_t *writer, const char *name, uint32_t value) {
+    WRITE_LITERAL(writer, ",\"");
+    json_bind_write_raw(writer, name, strlen(name));
+    WRITE_LITERAL(writer, "\":");
+    write_uint(writer, value);
+}
+
+// ---------------- PUBLIC FUNCTIONS -------------
+void telemetry_wake_start(void) {
+    telemetry.wake_count++;
+    telemetry.last_handshake_ms = 0;
+    telemetry.last_wifi_connect_ms = 0;
+}
+
+void telemetry_record_handshake(uint32_t duration_ms) {
+    telemetry.last_handshake_ms = duration_ms;
+    telemetry.handshakes++;
+    telemetry.handshake_ms_total += duration_ms;
+}
+
+void telemetry_record_request(uint32_t duration_ms, bool connection_reused) {
+    if (connection_reused) {
+        telemetry.reused_connection_requests++;
+        telemetry.reused_connection_request_ms_total += duration_ms;
+    }
+    else {
+        telemetry.new_connection_requests++;
+        telemetry.new_connection_request_ms_total += duration_ms;
+    }
+}
+
+void telemetry_record_wifi_connect(uint32_t duration_ms, bool cached_ap) {
+    telemetry.last_wifi_connect_ms = duration_ms;
+    if (cached_ap) {
+        telemetry.cached_ap_connects++;
+        telemetry.cached_ap_connect_ms_total += duration_ms;
+    }
+    else {
+        telemetry.scan_connects++;
+        telemetry.scan_connect_ms_total += duration_ms;
+    }
+}
+
+void telemetry_record_budget(const wake_budget_t *budget) {
+    bool exhausted = false;
+
+    telemetry.budget_ms = budget->budget_ms;
+    for (int stage = 0; stage < WAKE_STAGE_COUNT; stage++) {
+        telemetry.stage_ms[stage] = budget->spent_ms[stage];
+        telemetry.stage_results[stage] = (uint8_t)budget->results[stage];
+        exhausted |= (budget->results[stage] == WAKE_STAGE_OUT_OF_TIME);
+    }
+    if (exhausted) {
+        telemetry.budget_exhausted_wakes++;
+    }
+}
+
+void telemetry_record_timing(const telemetry_timing_t *timing) {
+    // the RTC copy is garbage after a power cycle, start over then
+    if (timings.next >= TELEMETRY_TIMING_SAMPLES || timings.count > TELEMETRY_TIMING_SAMPLES) {
+        timings.next = 0;
+        timings.count = 0;
+    }
+    timings.samples[timings.next] = *timing;
+    timings.samples[timings.next].wake = telemetry.wake_count;
+    timings.next = (timings.next + 1) % TELEMETRY_TIMING_SAMPLES;
+    if (timings.count < TELEMETRY_TIMING_SAMPLES) {
+        timings.count++;
+    }
+}
+
+size_t telemetry_get_timings(telemetry_timing_t *samples, size_t max) {
+    if (timings.next >= TELEMETRY_TIMING_SAMPLES || timings.count > TELEMETRY_TIMING_SAMPLES) {
+        return 0;
+    }
+    size_t count = (max < timings.count) ? max : timings.count;
+    // the oldest of the samples we copy
+    size_t index = (timings.next + TELEMETRY_TIMING_SAMPLES - count) % TELEMETRY_TIMING_SAMPLES;
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = timings.samples[index];
+        index = (index + 1) % TELEMETRY_TIMING_SAMPLES;
+    }
+    return count;
+}
+
+esp_err_t telemetry_serialize(char *buffer, size_t size, size_t *length) {
+    telemetry_timing_t samples[TELEMETRY_TIMING_SAMPLES];
+    size_t count = telemetry_get_timings(samples, TELEMETRY_TIMING_SAMPLES);
+    json_bind_writer_t writer;
+
+    json_bind_writer_init(&writer, buffer, size);
+    WRITE_LITERAL(&writer, "{\"wake\":");
+    write_uint(&writer, telemetry.wake_count);
+    // the handshake times depend on how the certificate is checked
+    WRITE_LITERAL(&writer, ",\"trust\":\"" TLS_TRUST_MODE "\"");
+    write_member(&writer, "handshakes", telemetry.handshakes);
+    write_member(&writer, "handshake_ms_total", telemetry.handshake_ms_total);
+    write_member(&writer, "cached_ap_connects", telemetry.cached_ap_connects);
+    write_member(&writer, "cached_ap_connect_ms_total", telemetry.cached_ap_connect_ms_total);
+    write_member(&writer, "scan_connects", telemetry.scan_connects);
+    write_member(&writer, "scan_connect_ms_total", telemetry.scan_connect_ms_total);
+    WRITE_LITERAL(&writer, ",\"budget\":{\"ms\":");
+    write_uint(&writer, telemetry.budget_ms);
+    write_member(&writer, "exhausted_wakes", telemetry.budget_exhausted_wakes);
+    for (int stage = 0; stage < WAKE_STAGE_COUNT; stage++) {
+        const char *name = wake_budget_stage_name(stage);
+        const char *result = wake_budget_result_name(telemetry.stage_results[stage]);
+        WRITE_LITERAL(&writer, ",\"");
+        json_bind_write_raw(&writer, name, strlen(name));
+        WRITE_LITERAL(&writer, "\":{\"ms\":");
+        write_uint(&writer, telemetry.stage_ms[stage]);
+        WRITE_LITERAL(&writer, ",\"result\":\"");
+        json_bind_write_raw(&writer, result, strlen(result));
+        WRITE_LITERAL(&writer, "\"}");
+    }
+    WRITE_LITERAL(&writer, "}");
+    WRITE_LITERAL(&writer, ",\"requests\":[");
+    for (size_t i = 0; i < count; i++) {
+        const telemetry_timing_t *sample = &samples[i];
+        if (i > 0) {
+            WRITE_LITERAL(&writer, ",");
+        }
+        WRITE_LITERAL(&writer, "{\"wake\":");
+        write_uint(&writer, sample->wake);
+        write_member(&writer, "status", sample->status);
+        WRITE_LITERAL(&writer, ",\"reused\":");
+        json_bind_write_bool(&writer, sample->connection_reused);
+        write_member(&writer, "dns_us", sample->dns_us);
+        write_member(&writer, "connect_us", sample->connect_us);
+        write_member(&writer, "send_us", sample->send_us);
+        write_member(&writer, "first_byte_us", sample->first_byte_us);
+        write_member(&writer, "body_us", sample->body_us);
+        write_member(&writer, "body_length", sample->body_length);
+        WRITE_LITERAL(&writer, "}");
+    }
+    WRITE_LITERAL(&writer, "]}");
+    return json_bind_writer_finish(&writer, length);
+}
+
+void telemetry_log(void) {
+    ESP_LOGI(TAG, "Wi-Fi connect %"PRIu32" ms; to the cached AP: %"PRIu32", avg %"PRIu32" ms; with a scan: %"PRIu32", avg %"PRIu32" ms",
+            telemetry.last_wifi_connect_ms,
+            telemetry.cached_ap_connects, average(telemetry.cached_ap_connect_ms_total, telemetry.cached_ap_connects),
+            telemetry.scan_connects, average(telemetry.scan_connect_ms_total, telemetry.scan_connects));
+    ESP_LOGI(TAG, "wake %"PRIu32": last connect + TLS handshake %"PRIu32" ms", telemetry.wake_count, telemetry.last_handshake_ms);
+    ESP_LOGI(TAG, "%s handshakes: %"PRIu32", avg %"PRIu32" ms", TLS_TRUST_MODE, telemetry.handshakes,
+            average(telemetry.handshake_ms_total, telemetry.handshakes));
+    ESP_LOGI(TAG, "requests on a new connection: %"PRIu32", avg %"PRIu32" ms; on a kept-alive one: %"PRIu32", avg %"PRIu32" ms",
+            telemetry.new_connection_requests, average(telemetry.new_connection_request_ms_total, telemetry.new_connection_requests),
+            telemetry.reused_connection_requests, average(telemetry.reused_connection_request_ms_total, telemetry.reused_connection_requests));
+    ESP_LOGI(TAG, "network budget ran out in %"PRIu32" of %"PRIu32" wakes", telemetry.budget_exhausted_wakes, telemetry.wake_count);
+}
+
+const wake_telemetry_t *telemetry_get(void) {
+    return &telemetry;
+}
@@ -0,0 +1,82 @@
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_netif_sntp.h"
+#include "esp_timer.h"
+#include "time_sync.h"
+
+static const char *TAG = "time_sync";
+
+static bool initialized = false;
+static bool started = false;
+static int64_t started_us;
+static volatile int64_t synced_us = 0;     // set from the lwIP thread
+
+// ---------------- PRIVATE FUNCTIONS -------------
+static void on_sync(struct timeval *tv) {
+    if (synced_us == 0) {
+        synced_us = esp_timer_get_time();
+        ESP_LOGI(TAG, "Time set %"PRIu32" ms after the IP address", time_sync_elapsed_ms());
+    }
+}
+
+// ---------------- PUBLIC FUNCTIONS -------------
+esp_err_t time_sync_init(const char *server) {
+    if (initialized) {
+        return ESP_OK;
+    }
+    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(server);
+    config.start = false;   // there is no IP address yet, time_sync_start sends the first request
+    config.sync_cb = on_sync;
+
+    esp_err_t err = esp_netif_sntp_init(&config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set up SNTP: %s", esp_err_to_name(err));
+        return err;
+    }
+    initialized = true;
+    return ESP_OK;
+}
+
+void time_sync_start(void) {
+    if (!initialized || started) {
+        return;
+    }
+    started_us = esp_timer_get_time();
+    esp_err_t err = esp_netif_sntp_start();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start SNTP: %s", esp_err_to_name(err));
+        return;
+    }
+    started = true;
+}
+
+esp_err_t time_sync_wait(TickType_t timeout) {
+    if (!started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (synced_us != 0) {
+        return ESP_OK;
+    }
+    return esp_netif_sntp_sync_wait(timeout);
+}
+
+uint32_t time_sync_elapsed_ms(void) {
+    if (!started) {
+        return 0;
+    }
+    int64_t until_us = (synced_us != 0) ? synced_us : esp_timer_get_time();
+    return (uint32_t)((until_us - started_us) / 1000);
+}
+
+bool time_sync_done(void) {
+    return synced_us != 0;
+}
+
+void time_sync_deinit(void) {
+    if (initialized) {
+        esp_netif_sntp_deinit();
+    }
+    initialized = false;
+    started = false;
+    synced_us = 0;
+}
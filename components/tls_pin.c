@@ -0,0 +1,79 @@
+#include "sdkconfig.h"
+
+#ifdef CONFIG_HTTP_TRUST_PINNED_SPKI
+#include <stdbool.h>
+#include <string.h>
+#include "esp_log.h"
+#include "mbedtls/base64.h"
+#include "mbedtls/pk.h"
+#include "mbedtls/sha256.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/x509_crt.h"
+#include "tls_pin.h"
+
+#define SPKI_HASH_LEN       32
+#define SPKI_DER_MAX_LEN    600     // an RSA 4096 key is about 550 bytes, EC keys much less
+
+static const char *TAG = "tls_pin";
+
+// mbedTLS only calls the verify callback if there is a CA chain, this empty one is never used to verify
+// anything (esp_crt_bundle does the same)
+static mbedtls_x509_crt dummy_ca;
+
+static unsigned char pinned_hash[SPKI_HASH_LEN];
+static bool pin_decoded = false;
+
+// ---------------- PRIVATE FUNCTIONS -------------
+/**
+ * @brief mbedTLS verify callback, called for every certificate of the chain from the top down to the server's
+ * own at depth 0. Only that one matters, and only its key
+ */
+static int spki_verify(void *context, mbedtls_x509_crt *crt, int depth, uint32_t *flags) {
+    unsigned char der[SPKI_DER_MAX_LEN];
+    unsigned char hash[SPKI_HASH_LEN];
+
+    if (depth > 0) {
+        *flags = 0;
+        return 0;
+    }
+
+    // mbedtls_pk_write_pubkey_der() writes at the end of the buffer
+    int length = mbedtls_pk_write_pubkey_der(&crt->pk, der, sizeof(der));
+    if (length <= 0) {
+        ESP_LOGE(TAG, "Can't encode the server's public key: -0x%x", -length);
+        *flags |= MBEDTLS_X509_BADCERT_OTHER;
+        return 0;
+    }
+    mbedtls_sha256(der + sizeof(der) - length, length, hash, 0);
+    if (memcmp(hash, pinned_hash, sizeof(hash)) != 0) {
+        ESP_LOGE(TAG, "The server's public key doesn't match the pin");
+        *flags |= MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+        return 0;
+    }
+
+    // the key is the one we trust, whoever signed it and whatever name and dates it carries
+    *flags = 0;
+    return 0;
+}
+
+// ---------------- PUBLIC FUNCTIONS -------------
+esp_err_t tls_pin_spki_attach(void *conf) {
+    mbedtls_ssl_config *ssl_conf = conf;
+
+    if (!pin_decoded) {
+        size_t length = 0;
+        int ret = mbedtls_base64_decode(pinned_hash, sizeof(pinned_hash), &length,
+                (const unsigned char *)CONFIG_HTTP_PINNED_SPKI_SHA256, strlen(CONFIG_HTTP_PINNED_SPKI_SHA256));
+        if (ret != 0 || length != SPKI_HASH_LEN) {
+            ESP_LOGE(TAG, "CONFIG_HTTP_PINNED_SPKI_SHA256 isn't a base64 SHA-256 hash");
+            return ESP_ERR_INVALID_ARG;
+        }
+        pin_decoded = true;
+    }
+
+    mbedtls_ssl_conf_ca_chain(ssl_conf, &dummy_ca, NULL);
+    mbedtls_ssl_conf_authmode(ssl_conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_verify(ssl_conf, spki_verify, NULL);
+    return ESP_OK;
+}
+#endif
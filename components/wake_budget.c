@@ -0,0 +1,122 @@
+#include <inttypes.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "wake_budget.h"
+
+// a retry needs at least this much after its backoff to be worth starting
+#define WAKE_BUDGET_MIN_RETRY_MS    500
+
+static const char *TAG = "wake_budget";
+
+static const char *stage_names[WAKE_STAGE_COUNT] = { "wifi", "http", "sntp" };
+static const char *result_names[] = { "skipped", "ok", "failed", "out_of_time" };
+
+// ---------------- PUBLIC FUNCTIONS -------------
+void wake_budget_init(wake_budget_t *budget, uint32_t budget_ms) {
+    memset(budget, 0, sizeof(*budget));
+    budget->started_us = esp_timer_get_time();
+    budget->deadline_us = budget->started_us + (int64_t)budget_ms * 1000;
+    budget->budget_ms = budget_ms;
+}
+
+uint32_t wake_budget_remaining_ms(const wake_budget_t *budget) {
+    if (budget == NULL) {
+        return UINT32_MAX;
+    }
+    int64_t remaining_us = budget->deadline_us - esp_timer_get_time();
+    return (remaining_us > 0) ? (uint32_t)(remaining_us / 1000) : 0;
+}
+
+TickType_t wake_budget_remaining_ticks(const wake_budget_t *budget) {
+    if (budget == NULL) {
+        return portMAX_DELAY;
+    }
+    return pdMS_TO_TICKS(wake_budget_remaining_ms(budget));
+}
+
+uint32_t wake_budget_limit_ms(const wake_budget_t *budget, uint32_t timeout_ms) {
+    uint32_t remaining_ms = wake_budget_remaining_ms(budget);
+    return (remaining_ms < timeout_ms) ? remaining_ms : timeout_ms;
+}
+
+bool wake_budget_expired(const wake_budget_t *budget) {
+    return budget != NULL && esp_timer_get_time() >= budget->deadline_us;
+}
+
+void wake_budget_stage_begin(wake_budget_t *budget, wake_stage_t stage) {
+    if (budget != NULL) {
+        budget->stage_started_us = esp_timer_get_time();
+    }
+}
+
+void wake_budget_stage_end(wake_budget_t *budget, wake_stage_t stage, wake_stage_result_t result) {
+    if (budget == NULL) {
+        return;
+    }
+    wake_budget_stage_record(budget, stage, (uint32_t)((esp_timer_get_time() - budget->stage_started_us) / 1000),
+            result);
+}
+
+void wake_budget_stage_record(wake_budget_t *budget, wake_stage_t stage, uint32_t spent_ms, wake_stage_result_t result) {
+    if (budget == NULL) {
+        return;
+    }
+    budget->spent_ms[stage] += spent_ms;
+    if (result == WAKE_STAGE_FAILED && wake_budget_expired(budget)) {
+        result = WAKE_STAGE_OUT_OF_TIME;
+    }
+    budget->results[stage] = result;
+}
+
+esp_err_t wake_budget_backoff_delay(const wake_budget_t *budget, int attempt, uint32_t base_ms, uint32_t max_ms,
+        uint32_t *delay_ms) {
+    uint32_t wait_ms = base_ms;
+
+    for (int i = 0; i < attempt && wait_ms < max_ms; i++) {
+        wait_ms *= 2;
+    }
+    if (wait_ms > max_ms) {
+        wait_ms = max_ms;
+    }
+    // anywhere from half to one and a half times the wait
+    wait_ms = wait_ms / 2 + esp_random() % (wait_ms + 1);
+
+    if (budget != NULL && wake_budget_remaining_ms(budget) < wait_ms + WAKE_BUDGET_MIN_RETRY_MS) {
+        return ESP_ERR_TIMEOUT;
+    }
+    *delay_ms = wait_ms;
+    return ESP_OK;
+}
+
+esp_err_t wake_budget_backoff(const wake_budget_t *budget, int attempt, uint32_t base_ms, uint32_t max_ms) {
+    uint32_t wait_ms;
+
+    esp_err_t err = wake_budget_backoff_delay(budget, attempt, base_ms, max_ms, &wait_ms);
+    if (err != ESP_OK) {
+        return err;
+    }
+    ESP_LOGI(TAG, "Retrying in %"PRIu32" ms", wait_ms);
+    vTaskDelay(pdMS_TO_TICKS(wait_ms));
+    return ESP_OK;
+}
+
+const char *wake_budget_stage_name(wake_stage_t stage) {
+    return (stage < WAKE_STAGE_COUNT) ? stage_names[stage] : "none";
+}
+
+const char *wake_budget_result_name(wake_stage_result_t result) {
+    return (result <= WAKE_STAGE_OUT_OF_TIME) ? result_names[result] : "unknown";
+}
+
+void wake_budget_log(const wake_budget_t *budget) {
+    uint32_t used_ms = (uint32_t)((esp_timer_get_time() - budget->started_us) / 1000);
+
+    ESP_LOGI(TAG, "%"PRIu32" of %"PRIu32" ms used", used_ms, budget->budget_ms);
+    for (int stage = 0; stage < WAKE_STAGE_COUNT; stage++) {
+        ESP_LOGI(TAG, "  %-4s %6"PRIu32" ms, %s", stage_names[stage], budget->spent_ms[stage],
+                wake_budget_result_name(budget->results[stage]));
+    }
+}
@@ -1,23 +1,400 @@
 #include "wifi.h"
 #include "esp_wifi.h"
 #include "esp_mac.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
+#include "ip_lease.h"
+#include "mbedtls/md.h"
+#include "mbedtls/pkcs5.h"
+#include "telemetry.h"
+#include "time_sync.h"
+#include "wifi_profiles.h"
 
 static const char *TAG = "my_wifi";
 
+// retry_timer going off, posted to the default event loop so it is handled in the same task as the Wi-Fi events
+ESP_EVENT_DEFINE_BASE(WIFI_RETRY_EVENT);
+
 #define WIFI_AUTHMODE WIFI_AUTH_WPA2_PSK
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT BIT1
 
-static const int WIFI_RETRY_ATTEMPT = 3;
-static int wifi_retry_count = 0;
+static const int WIFI_RETRY_ATTEMPT = 3;   // with a single access point
+#define WIFI_ATTEMPTS_PER_AP 2      // with more, before moving on to the next one
+#define WIFI_RETRY_BASE_MS  500     // first backoff, doubled for every retry after it
+#define WIFI_RETRY_MAX_MS   4000
+#define WIFI_SCAN_CHANNEL_MS    100 // active scan time per channel, so a scan of all of them stays bounded
+#define WIFI_SCAN_MAX_RECORDS   20
+
+#define WIFI_FAST_CONNECT_TIMEOUT_MS    3000    // to the cached access point, before falling back to a scan
+#define WIFI_PMK_LEN                    32
+#define WIFI_PMK_ITERATIONS             4096    // WPA2-PSK: PBKDF2-HMAC-SHA1(passphrase, SSID)
+
+// The access point of the last successful connection, so the next wake can go straight to it: with the BSSID
+// and channel there is no scan, and with the PMK (passed as 64 hex digits instead of the passphrase) the
+// supplicant doesn't derive it again. Only deep sleep keeps RTC memory, any other boot starts without it.
+RTC_SLOW_ATTR static struct {
+    bool valid;
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+    wifi_auth_mode_t authmode;
+    bool pmk_valid;
+    uint8_t pmk[WIFI_PMK_LEN];
+} cached_ap;
+
+static const char *connected_password = NULL;  // for derive_cached_pmk
+
+static char connecting_ssid[IP_LEASE_SSID_MAX_LEN];
+static bool address_cached = false;     // the address came from ip_lease, not from a DHCP exchange
 
 static esp_netif_t *tutorial_netif = NULL;
 static esp_event_handler_instance_t ip_event_handler;
 static esp_event_handler_instance_t wifi_event_handler;
+static esp_event_handler_instance_t retry_event_handler;
 
 static EventGroupHandle_t s_wifi_event_group = NULL;
 
+typedef enum {
+    CONNECT_IDLE,       // not connecting: before wifi_connect, after wifi_disconnect
+    CONNECT_SCANNING,   // bounded scan for the listed access points
+    CONNECT_ATTEMPT,    // waiting for the access point and the IP address
+    CONNECT_BACKOFF,    // waiting to try again, retry_timer runs
+    CONNECT_DONE,       // connected, a lost connection is re-established right away
+    CONNECT_FAILED,     // gave up, result says why
+} connect_state_t;
+
+// The connection being made, moved along by the event handlers and retry_timer: every failed attempt either
+// schedules a retry of the same access point, moves on to the next one or ends in CONNECT_FAILED. wifi_connect
+// sets it up and waits for WIFI_CONNECTED_BIT or WIFI_FAIL_BIT.
+static struct {
+    connect_state_t state;
+    esp_err_t result;                   // once CONNECT_FAILED
+    wake_budget_t *budget;
+    wifi_profile_t profiles[WIFI_PROFILES_MAX];
+    size_t count;
+    uint8_t order[WIFI_PROFILES_MAX];   // indexes into profiles, in the order they are tried
+    size_t candidates;                  // entries of order in use
+    size_t candidate;                   // the one being tried
+    int attempt;                        // of that one
+    int attempts_per_ap;
+    bool scanned;                       // once per wifi_connect
+    bool fast;                          // this attempt goes to the cached access point, see cached_ap
+    struct {
+        bool found;
+        uint8_t bssid[6];
+        uint8_t channel;
+        int8_t rssi;
+    } seen[WIFI_PROFILES_MAX];          // by the scan, per profile
+    int64_t candidate_started_us;       // first attempt of the current access point
+    int64_t timer_due_us;               // when retry_timer was last set to go off
+} conn;
+
+// backoff between attempts, and the time limit of an attempt on the cached access point
+static esp_timer_handle_t retry_timer = NULL;
+
+static wifi_ap_record_t scan_records[WIFI_SCAN_MAX_RECORDS];   // too big for the event task's stack
+
+/**
+ * @brief the PMK can stand in for the passphrase with the WPA/WPA2 personal modes, WPA3's SAE needs the passphrase
+ */
+static bool authmode_uses_pmk(wifi_auth_mode_t authmode) {
+    return authmode == WIFI_AUTH_WPA_PSK || authmode == WIFI_AUTH_WPA2_PSK || authmode == WIFI_AUTH_WPA_WPA2_PSK;
+}
+
+/**
+ * @brief points wifi_config at the cached access point, if there is one for wifi_ssid. Returns whether it did
+ */
+static bool use_cached_ap(wifi_config_t *wifi_config, const char *wifi_ssid) {
+    if (!cached_ap.valid || strncmp(cached_ap.ssid, wifi_ssid, sizeof(cached_ap.ssid)) != 0) {
+        return false;
+    }
+    wifi_config->sta.bssid_set = true;
+    memcpy(wifi_config->sta.bssid, cached_ap.bssid, sizeof(cached_ap.bssid));
+    wifi_config->sta.channel = cached_ap.channel;
+    if (cached_ap.pmk_valid && authmode_uses_pmk(cached_ap.authmode)) {
+        // exactly 64 characters, without a terminator, is how the driver takes a PSK
+        for (int i = 0; i < WIFI_PMK_LEN; i++) {
+            static const char hex[] = "0123456789abcdef";
+            wifi_config->sta.password[2 * i] = hex[cached_ap.pmk[i] >> 4];
+            wifi_config->sta.password[2 * i + 1] = hex[cached_ap.pmk[i] & 0x0f];
+        }
+    }
+    ESP_LOGI(TAG, "Connecting to the cached access point " MACSTR " on channel %d%s", MAC2STR(cached_ap.bssid),
+            cached_ap.channel, cached_ap.pmk_valid ? " with its PMK" : "");
+    return true;
+}
+
+/**
+ * @brief remembers the access point just connected to for the next wake. Its PMK is derived later by
+ * derive_cached_pmk, the supplicant's copy isn't accessible
+ */
+static void save_cached_ap(const char *wifi_ssid, const wifi_ap_record_t *ap) {
+    // the PMK only depends on the network name and the passphrase
+    bool pmk_valid = cached_ap.valid && cached_ap.pmk_valid &&
+            strncmp(cached_ap.ssid, wifi_ssid, sizeof(cached_ap.ssid)) == 0;
+
+    strncpy(cached_ap.ssid, wifi_ssid, sizeof(cached_ap.ssid) - 1);
+    cached_ap.ssid[sizeof(cached_ap.ssid) - 1] = '\0';
+    memcpy(cached_ap.bssid, ap->bssid, sizeof(cached_ap.bssid));
+    cached_ap.channel = ap->primary;
+    cached_ap.authmode = ap->authmode;
+    cached_ap.pmk_valid = pmk_valid;
+    cached_ap.valid = true;
+}
+
+/**
+ * @brief derives the PMK of the cached access point if it doesn't have one yet. It takes a while, so this is
+ * done in wifi_deinitialize instead of right after connecting
+ */
+static void derive_cached_pmk(const char *wifi_password) {
+    size_t password_length = strlen(wifi_password);
+
+    if (!cached_ap.valid || cached_ap.pmk_valid || !authmode_uses_pmk(cached_ap.authmode) ||
+            password_length < 8 || password_length > 63) {
+        return;
+    }
+    int64_t started_us = esp_timer_get_time();
+    int ret = mbedtls_pkcs5_pbkdf2_hmac_ext(MBEDTLS_MD_SHA1, (const unsigned char *)wifi_password, password_length,
+            (const unsigned char *)cached_ap.ssid, strlen(cached_ap.ssid), WIFI_PMK_ITERATIONS, WIFI_PMK_LEN,
+            cached_ap.pmk);
+    cached_ap.pmk_valid = (ret == 0);
+    ESP_LOGI(TAG, "Derived the PMK for the next wake in %d ms", (int)((esp_timer_get_time() - started_us) / 1000));
+}
+
+static const wifi_profile_t *current_profile(void) {
+    return &conn.profiles[conn.order[conn.candidate]];
+}
+
+static void finish_connect(esp_err_t result) {
+    conn.state = CONNECT_FAILED;
+    conn.result = result;
+    if (s_wifi_event_group != NULL) {
+        xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+    }
+}
+
+/**
+ * @brief configures the station for the current candidate: the cached access point if it is that network, the
+ * access point the scan found for it otherwise, and whichever answers to the name if neither
+ */
+static void configure_attempt(void) {
+    const wifi_profile_t *profile = current_profile();
+    const size_t index = conn.order[conn.candidate];
+    wifi_config_t wifi_config = {
+        .sta = {
+            .threshold.authmode = WIFI_AUTHMODE,
+        },
+    };
+
+    // copying the ssid and password of the profile into the memory of the wifi_config struct
+    strncpy((char*)wifi_config.sta.ssid, profile->ssid, sizeof(wifi_config.sta.ssid));
+    strncpy((char*)wifi_config.sta.password, profile->password, sizeof(wifi_config.sta.password));
+    strncpy(connecting_ssid, profile->ssid, sizeof(connecting_ssid) - 1);
+
+    conn.fast = use_cached_ap(&wifi_config, profile->ssid);
+    if (!conn.fast && conn.seen[index].found) {
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, conn.seen[index].bssid, sizeof(wifi_config.sta.bssid));
+        wifi_config.sta.channel = conn.seen[index].channel;
+    }
+    ESP_LOGI(TAG, "Connecting to Wi-Fi network %s, attempt %d", profile->ssid, conn.attempt + 1);
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+}
+
+static void start_retry_timer(uint32_t delay_ms) {
+    conn.timer_due_us = esp_timer_get_time() + (int64_t)delay_ms * 1000;
+    esp_timer_start_once(retry_timer, delay_ms * 1000ULL);
+}
+
+static void begin_attempt(void) {
+    conn.state = CONNECT_ATTEMPT;
+    if (conn.fast) {
+        start_retry_timer(WIFI_FAST_CONNECT_TIMEOUT_MS);
+    }
+    esp_wifi_connect();
+}
+
+static void start_candidate(size_t candidate) {
+    conn.candidate = candidate;
+    conn.attempt = 0;
+    conn.candidate_started_us = esp_timer_get_time();
+    configure_attempt();
+    begin_attempt();
+}
+
+/**
+ * @brief active scan of all channels, WIFI_SCAN_CHANNEL_MS each. Goes on in the WIFI_EVENT_SCAN_DONE handler
+ */
+static void start_scan(void) {
+    wifi_scan_config_t scan_config = {
+        .show_hidden = false,
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+        .scan_time.active = {
+            .min = 0,
+            .max = WIFI_SCAN_CHANNEL_MS,
+        },
+    };
+
+    ESP_LOGI(TAG, "Scanning for the %d known networks", (int)conn.count);
+    conn.state = CONNECT_SCANNING;
+    conn.scanned = true;
+    esp_err_t err = esp_wifi_scan_start(&scan_config, false);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start the scan: %s", esp_err_to_name(err));
+        finish_connect(ESP_FAIL);
+    }
+}
+
+/**
+ * @brief orders the candidates by the signal the scan saw them with, strongest first. If it saw none of them
+ * (hidden networks don't answer a scan without their name), all are tried blind in the order of their history
+ */
+static void rank_by_scan(const wifi_ap_record_t *records, uint16_t record_count) {
+    memset(conn.seen, 0, sizeof(conn.seen));
+    conn.candidates = 0;
+
+    for (size_t i = 0; i < conn.count; i++) {
+        for (uint16_t r = 0; r < record_count; r++) {
+            if (strncmp((const char *)records[r].ssid, conn.profiles[i].ssid, WIFI_PROFILE_SSID_LEN) != 0 ||
+                    (conn.seen[i].found && records[r].rssi <= conn.seen[i].rssi)) {
+                continue;
+            }
+            conn.seen[i].found = true;
+            conn.seen[i].rssi = records[r].rssi;
+            conn.seen[i].channel = records[r].primary;
+            memcpy(conn.seen[i].bssid, records[r].bssid, sizeof(conn.seen[i].bssid));
+        }
+        if (!conn.seen[i].found) {
+            continue;
+        }
+        wifi_ap_stats_t *stats = wifi_profiles_stats(conn.profiles[i].ssid);
+        if (stats != NULL) {
+            stats->last_rssi = conn.seen[i].rssi;
+        }
+        // insertion by signal
+        size_t j = conn.candidates++;
+        for (; j > 0 && conn.seen[conn.order[j - 1]].rssi < conn.seen[i].rssi; j--) {
+            conn.order[j] = conn.order[j - 1];
+        }
+        conn.order[j] = (uint8_t)i;
+    }
+
+    if (conn.candidates == 0) {
+        ESP_LOGW(TAG, "The scan found none of the known networks");
+        wifi_profiles_rank(conn.profiles, conn.count, conn.order);
+        conn.candidates = conn.count;
+    }
+}
+
+/**
+ * @brief the current attempt ended without a connection: retry after a backoff, go on to the next access point,
+ * scan once if that could help, or give up
+ */
+static void attempt_failed(void) {
+    const wifi_profile_t *profile = current_profile();
+    wifi_ap_stats_t *stats = wifi_profiles_stats(profile->ssid);
+    uint32_t delay_ms;
+
+    esp_timer_stop(retry_timer);
+    if (stats != NULL) {
+        stats->attempts++;
+    }
+    if (wake_budget_expired(conn.budget)) {
+        ESP_LOGE(TAG, "No connection within the wake's budget");
+        finish_connect(ESP_ERR_TIMEOUT);
+        return;
+    }
+
+    if (conn.fast) {
+        // the access point moved to another channel, went away or doesn't take the PMK any more: forget it and
+        // try the network again right away, without using up a retry
+        ESP_LOGW(TAG, "Cached access point not reachable");
+        cached_ap.valid = false;
+        configure_attempt();
+        begin_attempt();
+        return;
+    }
+    if (++conn.attempt < conn.attempts_per_ap) {
+        if (wake_budget_backoff_delay(conn.budget, conn.attempt - 1, WIFI_RETRY_BASE_MS, WIFI_RETRY_MAX_MS,
+                &delay_ms) != ESP_OK) {
+            ESP_LOGE(TAG, "No time left to connect to %s again", profile->ssid);
+            finish_connect(ESP_ERR_TIMEOUT);
+            return;
+        }
+        ESP_LOGI(TAG, "Retrying to connect to %s in %"PRIu32" ms", profile->ssid, delay_ms);
+        conn.state = CONNECT_BACKOFF;
+        start_retry_timer(delay_ms);
+        return;
+    }
+
+    ESP_LOGW(TAG, "Failed to connect to Wi-Fi network: %s", profile->ssid);
+    if (conn.candidate + 1 < conn.candidates) {
+        start_candidate(conn.candidate + 1);
+    }
+    else if (!conn.scanned && conn.count > 1) {
+        start_scan();
+    }
+    else {
+        finish_connect(ESP_FAIL);
+    }
+}
+
+/**
+ * @brief there is an IP address, from DHCP or from ip_lease
+ */
+static void connection_up(void) {
+    wifi_ap_record_t ap;
+
+    if (conn.state == CONNECT_ATTEMPT) {
+        esp_timer_stop(retry_timer);
+        wifi_ap_stats_t *stats = wifi_profiles_stats(current_profile()->ssid);
+        if (stats != NULL) {
+            stats->attempts++;
+            stats->successes++;
+            stats->connect_ms_total += (uint32_t)((esp_timer_get_time() - conn.candidate_started_us) / 1000);
+        }
+        if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK) {
+            if (stats != NULL) {
+                stats->last_rssi = ap.rssi;
+            }
+            save_cached_ap(current_profile()->ssid, &ap);
+        }
+        conn.state = CONNECT_DONE;
+    }
+    // SNTP runs alongside whatever the connection is needed for next
+    time_sync_start();
+    if (s_wifi_event_group != NULL) {
+        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+    }
+}
+
+/**
+ * @brief runs in the esp_timer task, where touching conn would race with the event handlers. The event loop
+ * hands it to retry_event_cb. If the post fails, wifi_connect still stops waiting at the end of the budget
+ */
+static void retry_timer_cb(void *arg) {
+    if (esp_event_post(WIFI_RETRY_EVENT, 0, NULL, 0, 0) != ESP_OK) {
+        ESP_LOGE(TAG, "Event queue full, retry timer lost");
+    }
+}
+
+static void retry_event_cb(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    // posted before the timer was stopped and set again, the new one hasn't gone off yet
+    if (esp_timer_get_time() < conn.timer_due_us) {
+        return;
+    }
+    if (conn.state == CONNECT_BACKOFF) {
+        begin_attempt();
+    }
+    else if (conn.state == CONNECT_ATTEMPT && conn.fast) {
+        ESP_LOGW(TAG, "No connection to the cached access point within %d ms", WIFI_FAST_CONNECT_TIMEOUT_MS);
+        // the disconnect event moves on
+        esp_wifi_disconnect();
+    }
+}
+
 static void ip_event_cb(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
     ESP_LOGI(TAG, "Handling IP event, event code 0x%" PRIx32, event_id);
@@ -26,8 +403,8 @@ static void ip_event_cb(void *arg, esp_event_base_t event_base, int32_t event_id
     case (IP_EVENT_STA_GOT_IP):
         ip_event_got_ip_t *event_ip = (ip_event_got_ip_t *)event_data;
         ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event_ip->ip_info.ip));
-        wifi_retry_count = 0;
-        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        ip_lease_save(tutorial_netif, connecting_ssid);
+        connection_up();
         break;
     case (IP_EVENT_STA_LOST_IP):
         ESP_LOGI(TAG, "Lost IP");
@@ -35,8 +412,7 @@ static void ip_event_cb(void *arg, esp_event_base_t event_base, int32_t event_id
     case (IP_EVENT_GOT_IP6):
         ip_event_got_ip6_t *event_ip6 = (ip_event_got_ip6_t *)event_data;
         ESP_LOGI(TAG, "Got IPv6: " IPV6STR, IPV62STR(event_ip6->ip6_info.ip));
-        wifi_retry_count = 0;
-        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        connection_up();
         break;
     default:
         ESP_LOGI(TAG, "IP event not handled");
@@ -55,26 +431,44 @@ static void wifi_event_cb(void *arg, esp_event_base_t event_base, int32_t event_
         break;
     case (WIFI_EVENT_SCAN_DONE):
         ESP_LOGI(TAG, "Wi-Fi scan done");
+        if (conn.state == CONNECT_SCANNING) {
+            uint16_t record_count = WIFI_SCAN_MAX_RECORDS;
+            if (esp_wifi_scan_get_ap_records(&record_count, scan_records) != ESP_OK) {
+                record_count = 0;
+            }
+            rank_by_scan(scan_records, record_count);
+            start_candidate(0);
+        }
         break;
     case (WIFI_EVENT_STA_START):
         ESP_LOGI(TAG, "Wi-Fi started, connecting to AP...");
-        esp_wifi_connect();
+        if (conn.state == CONNECT_SCANNING) {
+            start_scan();
+        }
+        else if (conn.state == CONNECT_ATTEMPT) {
+            begin_attempt();
+        }
         break;
     case (WIFI_EVENT_STA_STOP):
         ESP_LOGI(TAG, "Wi-Fi stopped");
         break;
     case (WIFI_EVENT_STA_CONNECTED):
         ESP_LOGI(TAG, "Wi-Fi connected");
+        // the default handler has just started DHCP, skip it if the address is known
+        if (ip_lease_apply(tutorial_netif, connecting_ssid) == ESP_OK) {
+            address_cached = true;
+            // there is no reason to wait for the IP event esp_netif posts for it
+            connection_up();
+        }
         break;
     case (WIFI_EVENT_STA_DISCONNECTED):
         ESP_LOGI(TAG, "Wi-Fi disconnected");
-        if (wifi_retry_count < WIFI_RETRY_ATTEMPT) {
-            ESP_LOGI(TAG, "Retrying to connect to Wi-Fi network...");
+        if (conn.state == CONNECT_DONE) {
+            ESP_LOGI(TAG, "Reconnecting to Wi-Fi network...");
             esp_wifi_connect();
-            wifi_retry_count++;
-        } else {
-            ESP_LOGI(TAG, "Failed to connect to Wi-Fi network");
-            xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+        }
+        else if (conn.state == CONNECT_ATTEMPT) {
+            attempt_failed();
         }
         break;
     case (WIFI_EVENT_STA_AUTHMODE_CHANGE):
@@ -119,6 +513,12 @@ esp_err_t wifi_initialize(void)
         return ESP_FAIL;
     }
 
+    const esp_timer_create_args_t timer_args = {
+        .callback = retry_timer_cb,
+        .name = "wifi_retry",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &retry_timer));
+
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
 
@@ -132,49 +532,111 @@ esp_err_t wifi_initialize(void)
                                                         &ip_event_cb,
                                                         NULL,
                                                         &ip_event_handler));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_RETRY_EVENT,
+                                                        ESP_EVENT_ANY_ID,
+                                                        &retry_event_cb,
+                                                        NULL,
+                                                        &retry_event_handler));
     return ret;
 }
 
-esp_err_t wifi_connect(const char* wifi_ssid, const char* wifi_password)
+esp_err_t wifi_connect(const char* wifi_ssid, const char* wifi_password, wake_budget_t *budget)
 {
-    wifi_config_t wifi_config = {
-        .sta = {
-            .threshold.authmode = WIFI_AUTHMODE,
-        },
-    };
-
-    // copying the wifi_ssid and wifi_password parameters into the memory of the wifi_config struct
-    strncpy((char*)wifi_config.sta.ssid, wifi_ssid, sizeof(wifi_config.sta.ssid));
-    strncpy((char*)wifi_config.sta.password, wifi_password, sizeof(wifi_config.sta.password));
+    memset(&conn, 0, sizeof(conn));
+    conn.budget = budget;
+    conn.timer_due_us = INT64_MAX;  // a retry event still queued from an earlier wifi_connect is dropped
+    if (wifi_profiles_load(conn.profiles, &conn.count) != ESP_OK) {
+        // no list in NVS, just the network from the configuration. Cutting the password off would only fail later
+        if (strlen(wifi_ssid) >= sizeof(conn.profiles[0].ssid) ||
+                strlen(wifi_password) >= sizeof(conn.profiles[0].password)) {
+            ESP_LOGE(TAG, "Wi-Fi network name or password too long");
+            return ESP_ERR_INVALID_ARG;
+        }
+        strcpy(conn.profiles[0].ssid, wifi_ssid);
+        strcpy(conn.profiles[0].password, wifi_password);
+        conn.count = 1;
+    }
+    wifi_profiles_rank(conn.profiles, conn.count, conn.order);
+    conn.candidates = conn.count;
+    conn.attempts_per_ap = (conn.count == 1) ? 1 + WIFI_RETRY_ATTEMPT : WIFI_ATTEMPTS_PER_AP;
 
     ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_NONE)); // default is WIFI_PS_MIN_MODEM
     ESP_ERROR_CHECK(esp_wifi_set_storage(WIFI_STORAGE_RAM)); // default is WIFI_STORAGE_FLASH
-
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
 
-    ESP_LOGI(TAG, "Connecting to Wi-Fi network: %s", wifi_config.sta.ssid);
-    ESP_ERROR_CHECK(esp_wifi_start());
+    // with several networks and nothing known about them, one scan finds out which are there and how strong
+    if (conn.count > 1 && !cached_ap.valid && !wifi_profiles_have_history(conn.profiles, conn.count)) {
+        conn.state = CONNECT_SCANNING;
+    }
+    else {
+        conn.candidate_started_us = esp_timer_get_time();
+        configure_attempt();
+        conn.state = CONNECT_ATTEMPT;
+    }
+    xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
+
+    int64_t started_us = esp_timer_get_time();
+    ESP_ERROR_CHECK(esp_wifi_start());  // the STA_START handler takes it from here
 
     EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-        pdFALSE, pdFALSE, portMAX_DELAY);
+        pdTRUE, pdFALSE, wake_budget_remaining_ticks(budget));
+    wifi_profiles_log(conn.profiles, conn.count);
 
     if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI(TAG, "Connected to Wi-Fi network: %s", wifi_config.sta.ssid);
+        const wifi_profile_t *profile = current_profile();
+        uint32_t connect_ms = (uint32_t)((esp_timer_get_time() - started_us) / 1000);
+        ESP_LOGI(TAG, "Connected to Wi-Fi network %s in %"PRIu32" ms (%s)", profile->ssid, connect_ms,
+                conn.fast ? "cached access point" : (conn.scanned ? "after a scan" : "scan by the driver"));
+        telemetry_record_wifi_connect(connect_ms, conn.fast);
+        connected_password = profile->password;
         return ESP_OK;
-    } else if (bits & WIFI_FAIL_BIT) {
-        ESP_LOGE(TAG, "Failed to connect to Wi-Fi network: %s", wifi_config.sta.ssid);
-        return ESP_FAIL;
     }
+    if (bits & WIFI_FAIL_BIT) {
+        return conn.result;
+    }
+    ESP_LOGE(TAG, "No connection to %s within the wake's budget", current_profile()->ssid);
+    esp_timer_stop(retry_timer);
+    conn.state = CONNECT_FAILED;
+    esp_wifi_scan_stop();
+    esp_wifi_disconnect();
+    return ESP_ERR_TIMEOUT;
+}
+
+esp_err_t wifi_renew_address(wake_budget_t *budget)
+{
+    if (!address_cached) {
+        return ESP_ERR_INVALID_STATE;
+    }
+#ifdef CONFIG_WIFI_STATIC_IP
+    return ESP_ERR_NOT_SUPPORTED;
+#else
+    ESP_LOGW(TAG, "Dropping the cached address, asking DHCP");
+    ip_lease_invalidate();
+    address_cached = false;
+    xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT);
+    esp_err_t err = esp_netif_dhcpc_start(tutorial_netif);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start DHCP: %s", esp_err_to_name(err));
+        return err;
+    }
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT, pdTRUE, pdFALSE,
+            wake_budget_remaining_ticks(budget));
+    return (bits & WIFI_CONNECTED_BIT) ? ESP_OK : ESP_ERR_TIMEOUT;
+#endif
+}
 
-    ESP_LOGE(TAG, "Unexpected Wi-Fi error");
-    return ESP_FAIL;
+bool wifi_address_cached(void)
+{
+    return address_cached;
 }
 
 esp_err_t wifi_disconnect(void)
 {
+    conn.state = CONNECT_IDLE;
+    esp_timer_stop(retry_timer);
     if (s_wifi_event_group) {
         vEventGroupDelete(s_wifi_event_group);
+        s_wifi_event_group = NULL;
     }
 
     return esp_wifi_disconnect();
@@ -187,13 +649,21 @@ esp_err_t wifi_deinitialize(void)
         ESP_LOGE(TAG, "Wi-Fi stack not initialized");
         return ret;
     }
+    // with the radio off
+    if (connected_password != NULL) {
+        derive_cached_pmk(connected_password);
+        connected_password = NULL;
+    }
 
     ESP_ERROR_CHECK(esp_wifi_deinit());
+    esp_timer_delete(retry_timer);
+    retry_timer = NULL;
     ESP_ERROR_CHECK(esp_wifi_clear_default_wifi_driver_and_handlers(tutorial_netif));
     esp_netif_destroy(tutorial_netif);
 
     ESP_ERROR_CHECK(esp_event_handler_instance_unregister(IP_EVENT, ESP_EVENT_ANY_ID, ip_event_handler));
     ESP_ERROR_CHECK(esp_event_handler_instance_unregister(WIFI_EVENT, ESP_EVENT_ANY_ID, wifi_event_handler));
+    ESP_ERROR_CHECK(esp_event_handler_instance_unregister(WIFI_RETRY_EVENT, ESP_EVENT_ANY_ID, retry_event_handler));
 
     return ESP_OK;
 }
@@ -0,0 +1,177 @@
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "wifi_profiles.h"
+
+#define WIFI_PROFILES_NAMESPACE "wifi_aps"
+
+static const char *TAG = "wifi_profiles";
+
+RTC_SLOW_ATTR static wifi_ap_stats_t stats[WIFI_PROFILES_MAX];
+
+// ---------------- PRIVATE FUNCTIONS -------------
+static wifi_ap_stats_t *find_stats(const char *ssid) {
+    for (size_t i = 0; i < WIFI_PROFILES_MAX; i++) {
+        if (stats[i].ssid[0] != '\0' && strncmp(stats[i].ssid, ssid, sizeof(stats[i].ssid)) == 0) {
+            return &stats[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief forgets the statistics of access points that aren't in profiles, so there is room for the ones that are
+ */
+static void prune_stats(const wifi_profile_t *profiles, size_t count) {
+    for (size_t i = 0; i < WIFI_PROFILES_MAX; i++) {
+        bool listed = false;
+        for (size_t j = 0; j < count && !listed; j++) {
+            listed = strncmp(stats[i].ssid, profiles[j].ssid, sizeof(stats[i].ssid)) == 0;
+        }
+        if (!listed) {
+            memset(&stats[i], 0, sizeof(stats[i]));
+        }
+    }
+}
+
+/**
+ * @brief what connecting to ssid is expected to take, for sorting: mean time over the success rate
+ */
+static uint64_t expected_cost(const char *ssid) {
+    const wifi_ap_stats_t *entry = find_stats(ssid);
+
+    if (entry == NULL || entry->attempts == 0) {
+        return UINT64_MAX - 1;
+    }
+    if (entry->successes == 0) {
+        return UINT64_MAX;
+    }
+    return (uint64_t)entry->connect_ms_total * entry->attempts / entry->successes / entry->successes;
+}
+
+// ---------------- PUBLIC FUNCTIONS -------------
+esp_err_t wifi_profiles_load(wifi_profile_t *profiles, size_t *count) {
+    nvs_handle_t handle;
+    uint8_t stored = 0;
+    char key[16];
+
+    *count = 0;
+    esp_err_t err = nvs_open(WIFI_PROFILES_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return (err == ESP_ERR_NVS_NOT_FOUND) ? ESP_ERR_NOT_FOUND : err;
+    }
+    err = nvs_get_u8(handle, "count", &stored);
+    for (uint8_t i = 0; err == ESP_OK && i < stored && *count < WIFI_PROFILES_MAX; i++) {
+        wifi_profile_t *profile = &profiles[*count];
+        size_t length = sizeof(profile->ssid);
+        snprintf(key, sizeof(key), "ssid%u", i);
+        err = nvs_get_str(handle, key, profile->ssid, &length);
+        if (err == ESP_OK) {
+            length = sizeof(profile->password);
+            snprintf(key, sizeof(key), "pass%u", i);
+            err = nvs_get_str(handle, key, profile->password, &length);
+        }
+        if (err == ESP_OK) {
+            (*count)++;
+        }
+    }
+    nvs_close(handle);
+
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGE(TAG, "Failed to read the access point list: %s", esp_err_to_name(err));
+        return err;
+    }
+    if (*count == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    prune_stats(profiles, *count);
+    return ESP_OK;
+}
+
+esp_err_t wifi_profiles_store(const wifi_profile_t *profiles, size_t count) {
+    nvs_handle_t handle;
+    char key[16];
+
+    if (count > WIFI_PROFILES_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = nvs_open(WIFI_PROFILES_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_erase_all(handle);
+    for (size_t i = 0; err == ESP_OK && i < count; i++) {
+        snprintf(key, sizeof(key), "ssid%u", (unsigned)i);
+        err = nvs_set_str(handle, key, profiles[i].ssid);
+        if (err == ESP_OK) {
+            snprintf(key, sizeof(key), "pass%u", (unsigned)i);
+            err = nvs_set_str(handle, key, profiles[i].password);
+        }
+    }
+    if (err == ESP_OK) {
+        err = nvs_set_u8(handle, "count", (uint8_t)count);
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+wifi_ap_stats_t *wifi_profiles_stats(const char *ssid) {
+    wifi_ap_stats_t *entry = find_stats(ssid);
+
+    for (size_t i = 0; entry == NULL && i < WIFI_PROFILES_MAX; i++) {
+        if (stats[i].ssid[0] == '\0') {
+            entry = &stats[i];
+            memset(entry, 0, sizeof(*entry));
+            strncpy(entry->ssid, ssid, sizeof(entry->ssid) - 1);
+        }
+    }
+    return entry;
+}
+
+void wifi_profiles_rank(const wifi_profile_t *profiles, size_t count, uint8_t *order) {
+    uint64_t costs[WIFI_PROFILES_MAX];
+    size_t i, j;
+
+    for (i = 0; i < count; i++) {
+        order[i] = (uint8_t)i;
+        costs[i] = expected_cost(profiles[i].ssid);
+    }
+    // insertion sort, it keeps the list order between equals
+    for (i = 1; i < count; i++) {
+        for (j = i; j > 0 && costs[order[j - 1]] > costs[order[j]]; j--) {
+            uint8_t index = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = index;
+        }
+    }
+}
+
+bool wifi_profiles_have_history(const wifi_profile_t *profiles, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const wifi_ap_stats_t *entry = find_stats(profiles[i].ssid);
+        if (entry != NULL && entry->successes > 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void wifi_profiles_log(const wifi_profile_t *profiles, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const wifi_ap_stats_t *entry = find_stats(profiles[i].ssid);
+        if (entry == NULL || entry->attempts == 0) {
+            ESP_LOGI(TAG, "  %-32s not tried", profiles[i].ssid);
+            continue;
+        }
+        ESP_LOGI(TAG, "  %-32s %"PRIu32"/%"PRIu32" ok, avg %"PRIu32" ms, rssi %d", profiles[i].ssid,
+                entry->successes, entry->attempts,
+                entry->successes ? entry->connect_ms_total / entry->successes : 0, entry->last_rssi);
+    }
+}
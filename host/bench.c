@@ -0,0 +1,306 @@
+// Runs components/http.c on the host against a (mock) settings server and reports latency, per-phase timing,
+// throughput and memory. See tools/run_host_bench.sh for the scenarios.
+//
+//     http_bench [-n requests] [-c] [-s] [-r] [-p url] [-b ms] [-v] [url]
+//
+//  -n  number of requests (default 20)
+//  -c  conditional: send the validators of the previous response, like a wake with cached settings
+//  -s  a new session for every request, like one request per wake (default: one kept-alive session)
+//  -r  raw: count the body instead of parsing it as the alarm settings (for bodies over HTTP_BODY_BUFFER_SIZE)
+//  -p  after every request, POST a small document to this URL on the same session, like main's telemetry upload
+//  -b  give every request (and its POST) a wake budget of this many ms, like main does for a whole wake
+//  -v  log http.c's info messages, twice for debug
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include "alarm_config.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "http.h"
+#include "telemetry.h"
+
+#define BENCH_DEFAULT_URL       "http://127.0.0.1:8080/config"
+#define BENCH_DEFAULT_REQUESTS  20
+
+static const char *TAG = "bench";
+
+// heap used by the components and the shim (the binary is linked with --wrap for these), OpenSSL's own
+// allocations go through the unwrapped malloc and only show up in the max RSS
+static size_t heap_in_use;
+static size_t heap_peak;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *pointer, size_t size);
+void __real_free(void *pointer);
+
+typedef struct {
+    bool raw;
+    size_t body_bytes;
+    esp_err_t result;
+} bench_body_t;
+
+typedef struct {
+    double *values;
+    size_t count;
+} bench_series_t;
+
+static void heap_add(void *pointer) {
+    if (pointer != NULL) {
+        heap_in_use += malloc_usable_size(pointer);
+        if (heap_in_use > heap_peak) {
+            heap_peak = heap_in_use;
+        }
+    }
+}
+
+void *__wrap_malloc(size_t size) {
+    void *pointer = __real_malloc(size);
+    heap_add(pointer);
+    return pointer;
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    void *pointer = __real_calloc(count, size);
+    heap_add(pointer);
+    return pointer;
+}
+
+void *__wrap_realloc(void *pointer, size_t size) {
+    size_t old_size = (pointer != NULL) ? malloc_usable_size(pointer) : 0;
+    void *resized = __real_realloc(pointer, size);
+    if (resized != NULL || size == 0) {
+        heap_in_use -= old_size;
+        heap_add(resized);
+    }
+    return resized;
+}
+
+void __wrap_free(void *pointer) {
+    if (pointer != NULL) {
+        heap_in_use -= malloc_usable_size(pointer);
+    }
+    __real_free(pointer);
+}
+
+/**
+ * @brief the same as main's web_data_consumer: waits for the whole body and parses it as the alarm settings
+ */
+static int bench_consumer(const char *data, size_t length, bool last, void *context) {
+    bench_body_t *body = context;
+    alarm_config_t config;
+
+    if (body->raw) {
+        body->body_bytes += length;
+        return (int)length;
+    }
+    if (!last) {
+        return 0;
+    }
+    body->body_bytes += length;
+    body->result = alarm_config_parse(data, length, &config);
+    if (body->result != ESP_OK) {
+        ESP_LOGE(TAG, "Bad alarm settings: %s", esp_err_to_name(body->result));
+        return -1;
+    }
+    return (int)length;
+}
+
+static int bench_producer(char *buffer, size_t size, size_t offset, void *context) {
+    const char *document = context;
+    size_t length = strlen(document) - offset;
+
+    length = (length < size) ? length : size;
+    memcpy(buffer, document + offset, length);
+    return (int)length;
+}
+
+static int bench_discard(const char *data, size_t length, bool last, void *context) {
+    return (int)length;
+}
+
+static void series_add(bench_series_t *series, double value) {
+    series->values[series->count++] = value;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double series_percentile(bench_series_t *series, double percentile) {
+    if (series->count == 0) {
+        return 0;
+    }
+    qsort(series->values, series->count, sizeof(double), compare_doubles);
+    size_t index = (size_t)(percentile / 100.0 * (series->count - 1) + 0.5);
+    return series->values[index];
+}
+
+static void print_series(const char *name, bench_series_t *series) {
+    printf("%-12s min %8.2f  p50 %8.2f  p99 %8.2f  max %8.2f ms\n", name, series_percentile(series, 0),
+            series_percentile(series, 50), series_percentile(series, 99), series_percentile(series, 100));
+}
+
+/**
+ * @brief esp_err_to_name, with the status of the last request for HTTP_ERR_STATUS. text has room for 32 bytes
+ */
+static const char *error_name(esp_err_t err, char *text) {
+    telemetry_timing_t timing;
+
+    if (err != HTTP_ERR_STATUS || telemetry_get_timings(&timing, 1) != 1) {
+        return esp_err_to_name(err);
+    }
+    snprintf(text, 32, "status %u", (unsigned)timing.status);
+    return text;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-n requests] [-c] [-s] [-r] [-p url] [-b ms] [-v] [url]\n", program);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int requests = BENCH_DEFAULT_REQUESTS;
+    bool conditional = false, fresh_sessions = false, raw = false;
+    const char *url = BENCH_DEFAULT_URL;
+    const char *post_url = NULL;
+    int budget_ms = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "n:csrp:b:v")) != -1) {
+        switch (option) {
+            case 'n':
+                requests = atoi(optarg);
+                break;
+            case 'c':
+                conditional = true;
+                break;
+            case 's':
+                fresh_sessions = true;
+                break;
+            case 'r':
+                raw = true;
+                break;
+            case 'p':
+                post_url = optarg;
+                break;
+            case 'b':
+                budget_ms = atoi(optarg);
+                break;
+            case 'v':
+                esp_log_host_level = (esp_log_host_level < 3) ? 3 : esp_log_host_level + 1;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind < argc) {
+        url = argv[optind];
+    }
+    if (requests <= 0 || budget_ms < 0) {
+        usage(argv[0]);
+    }
+    // a server closing the connection mid-write is an error to report, not a reason to die
+    signal(SIGPIPE, SIG_IGN);
+
+    bench_series_t series[6];
+    const char *series_names[6] = { "total", "dns", "connect", "send", "first byte", "body" };
+    for (size_t i = 0; i < 6; i++) {
+        series[i].values = calloc(requests, sizeof(double));
+        series[i].count = 0;
+        if (series[i].values == NULL) {
+            return 1;
+        }
+    }
+
+    http_session_t session;
+    wake_budget_t budget;
+    http_validators_t validators = { 0 };
+    bool session_open = false;
+    int failed = 0, not_modified = 0, connections = 0;
+    size_t body_bytes = 0, wire_bytes = 0;
+    char error_text[32];
+    int64_t started_us = esp_timer_get_time();
+
+    for (int i = 0; i < requests; i++) {
+        bench_body_t body = { .raw = raw, .result = ESP_OK };
+
+        // the session keeps the pointer, so a kept-alive one sees the new deadline
+        wake_budget_init(&budget, (uint32_t)budget_ms);
+        if (!session_open) {
+            if (http_session_init(&session, url, (budget_ms > 0) ? &budget : NULL) != ESP_OK) {
+                return 1;
+            }
+            session_open = true;
+        }
+
+        int64_t request_started_us = esp_timer_get_time();
+        esp_err_t err = http_session_get(&session, NULL, conditional ? &validators : NULL, bench_consumer, &body);
+        double request_ms = (esp_timer_get_time() - request_started_us) / 1000.0;
+
+        telemetry_timing_t timing;
+        if (telemetry_get_timings(&timing, 1) == 1) {
+            series_add(&series[1], timing.dns_us / 1000.0);
+            series_add(&series[2], timing.connect_us / 1000.0);
+            series_add(&series[3], timing.send_us / 1000.0);
+            series_add(&series[4], timing.first_byte_us / 1000.0);
+            series_add(&series[5], timing.body_us / 1000.0);
+            wire_bytes += timing.body_length;
+        }
+        if (err != ESP_OK || body.result != ESP_OK) {
+            ESP_LOGE(TAG, "Request %d failed: %s", i + 1, error_name(err != ESP_OK ? err : body.result, error_text));
+            failed++;
+        }
+        else {
+            series_add(&series[0], request_ms);
+            body_bytes += body.body_bytes;
+            not_modified += (conditional && validators.not_modified);
+        }
+
+        if (post_url != NULL && err == ESP_OK) {
+            static char document[] = "{\"bench\":true}";
+            err = http_session_post(&session, post_url, "application/json", strlen(document), bench_producer,
+                    bench_discard, document);
+            if (err != ESP_OK) {
+                ESP_LOGE(TAG, "POST %d failed: %s", i + 1, error_name(err, error_text));
+                failed++;
+            }
+        }
+
+        if (fresh_sessions || err != ESP_OK) {
+            connections += session.connections;
+            http_session_deinit(&session);
+            session_open = false;
+        }
+    }
+    if (session_open) {
+        connections += session.connections;
+        http_session_deinit(&session);
+    }
+    double elapsed_s = (esp_timer_get_time() - started_us) / 1e6;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    printf("url          %s\n", url);
+    printf("requests     %d ok, %d failed, %d not modified, %d connections\n", requests - failed, failed,
+            not_modified, connections);
+    for (size_t i = 0; i < 6; i++) {
+        print_series(series_names[i], &series[i]);
+    }
+    printf("body         %zu bytes (%zu on the wire) in %.3f s, %.1f KB/s, %.1f requests/s\n", body_bytes, wire_bytes,
+            elapsed_s, body_bytes / 1024.0 / elapsed_s, (requests - failed) / elapsed_s);
+    printf("heap         peak %zu bytes, max rss %ld KB\n", heap_peak, usage.ru_maxrss);
+
+    for (size_t i = 0; i < 6; i++) {
+        free(series[i].values);
+    }
+    return failed > 0;
+}
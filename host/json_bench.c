@@ -0,0 +1,632 @@
+// Benchmarks of the cJSON extensions and the JSON helpers in components/, on the host. The numbers only mean
+// something with optimization:
+//
+//     cmake -S host -B build/host -DCMAKE_BUILD_TYPE=Release && cmake --build build/host
+//     build/host/json_bench [-r runs] [scenario...]
+//
+// Without scenarios all of them run. Every time is the best of the runs (default 5). Scenarios that only use
+// cJSON's original API can also be built against an older cJSON.c for a before/after comparison, as
+// json_bench_baseline (see CMakeLists.txt).
+
+#include <getopt.h>
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "cJSON.h"
+#ifndef JSON_BENCH_BASELINE
+#include "alarm_config.h"
+#include "json_pool.h"
+#include "ndjson_shard.h"
+#endif
+
+typedef struct {
+    const char *name;
+    const char *description;
+    void (*run)(void);
+} bench_scenario_t;
+
+typedef void (*bench_body_t)(void *context);
+
+static int bench_runs = 5;
+
+// cJSON's heap, through the hooks
+static size_t heap_in_use;
+static size_t heap_peak;
+
+static void *counting_malloc(size_t size) {
+    void *pointer = malloc(size);
+    if (pointer != NULL) {
+        heap_in_use += malloc_usable_size(pointer);
+        if (heap_in_use > heap_peak) {
+            heap_peak = heap_in_use;
+        }
+    }
+    return pointer;
+}
+
+static void counting_free(void *pointer) {
+    if (pointer != NULL) {
+        heap_in_use -= malloc_usable_size(pointer);
+    }
+    free(pointer);
+}
+
+static int64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief runs body iterations times per run, and returns the time of one iteration in the fastest run, in ns
+ */
+static double bench_best_ns(bench_body_t body, void *context, int iterations) {
+    double best = 0;
+
+    for (int run = 0; run < bench_runs; run++) {
+        int64_t started = now_ns();
+        for (int i = 0; i < iterations; i++) {
+            body(context);
+        }
+        double per_iteration = (double)(now_ns() - started) / iterations;
+        if (run == 0 || per_iteration < best) {
+            best = per_iteration;
+        }
+    }
+    return best;
+}
+
+// keeps the compiler from dropping results nobody looks at
+static volatile size_t bench_sink;
+
+#ifndef JSON_BENCH_BASELINE
+// ---------------- PACKED ARRAYS -------------
+#define PACKED_SERIES_LENGTH 10000
+
+typedef struct {
+    bool packed;
+    bool doubles;
+    const int *ints;
+    const double *doubles_values;
+    const char *text;
+    size_t text_length;
+} packed_context_t;
+
+static cJSON *packed_create(const packed_context_t *context) {
+    if (context->doubles) {
+        return context->packed ? cJSON_CreatePackedDoubleArray(context->doubles_values, PACKED_SERIES_LENGTH)
+                : cJSON_CreateDoubleArray(context->doubles_values, PACKED_SERIES_LENGTH);
+    }
+    return context->packed ? cJSON_CreatePackedIntArray(context->ints, PACKED_SERIES_LENGTH)
+            : cJSON_CreateIntArray(context->ints, PACKED_SERIES_LENGTH);
+}
+
+static void packed_create_print(void *context) {
+    cJSON *series = packed_create(context);
+    char *printed = cJSON_PrintUnformatted(series);
+    bench_sink += strlen(printed);
+    cJSON_free(printed);
+    cJSON_Delete(series);
+}
+
+static void packed_parse(void *context) {
+    const packed_context_t *packed = context;
+    int hints = packed->packed ? (packed->doubles ? cJSON_PackedDouble : cJSON_PackedInt) : 0;
+    cJSON *series = cJSON_ParseWithLengthHints(packed->text, packed->text_length, hints);
+    bench_sink += (size_t)cJSON_GetArraySize(series);
+    cJSON_Delete(series);
+}
+
+static void bench_packed(void) {
+    int *ints = malloc(PACKED_SERIES_LENGTH * sizeof(int));
+    double *doubles = malloc(PACKED_SERIES_LENGTH * sizeof(double));
+
+    // like the telemetry series: free heap samples and wake latencies in ms
+    srand(1);
+    for (int i = 0; i < PACKED_SERIES_LENGTH; i++) {
+        ints[i] = 150000 + rand() % 20000;
+        doubles[i] = (rand() % 100000) / 100.0;
+    }
+
+    printf("%d-element series, create + print, parse back:\n", PACKED_SERIES_LENGTH);
+    for (int kind = 0; kind < 4; kind++) {
+        packed_context_t context = {
+            .packed = (kind & 1) != 0,
+            .doubles = (kind & 2) != 0,
+            .ints = ints,
+            .doubles_values = doubles,
+        };
+
+        heap_in_use = 0;
+        cJSON *series = packed_create(&context);
+        size_t memory = heap_in_use;
+        char *text = cJSON_PrintUnformatted(series);
+        cJSON_Delete(series);
+        context.text = text;
+        context.text_length = strlen(text);
+
+        double create_print_ns = bench_best_ns(packed_create_print, &context, 20);
+        double parse_ns = bench_best_ns(packed_parse, &context, 20);
+        printf("  %-6s %-17s memory %7zu bytes  create + print %8.1f us  parse %8.1f us\n",
+                context.doubles ? "double" : "int", context.packed ? "packed" : "one node each", memory,
+                create_print_ns / 1000, parse_ns / 1000);
+        cJSON_free(text);
+    }
+
+    free(ints);
+    free(doubles);
+}
+
+// ---------------- UTF-8 VALIDATION -------------
+#define UTF8_LOG_ENTRIES 60000
+
+typedef struct {
+    const char *content;
+    size_t length;
+    int hints;
+} utf8_context_t;
+
+static void utf8_parse(void *context) {
+    const utf8_context_t *log = context;
+    cJSON *entries = cJSON_ParseWithLengthHints(log->content, log->length, log->hints);
+    bench_sink += (size_t)cJSON_GetArraySize(entries);
+    cJSON_Delete(entries);
+}
+
+static void bench_utf8(void) {
+    static const char *const messages[] = {
+        "wifi connected to home-network, got ip 192.168.1.42",
+        "config fetched in 412 ms, alarm unchanged",
+        "sntp sync failed, retrying with the fallback server",
+        "Wecker gestellt f\xC3\xBCr 06:45, Helligkeit 80 %",
+        "r\xC3\xA9veil \xC3\xA0 07:00 \xE2\x80\x94 lumi\xC3\xA8re douce \xE2\x98\x80",
+    };
+    size_t capacity = UTF8_LOG_ENTRIES * 160, length = 0;
+    char *content = malloc(capacity);
+
+    // the device log as the config server keeps it: mostly ASCII, every fifth message in another language
+    srand(4);
+    content[length++] = '[';
+    for (int i = 0; i < UTF8_LOG_ENTRIES; i++) {
+        length += (size_t)snprintf(content + length, capacity - length, "%s{\"t\":%d,\"level\":\"info\",\"msg\":\"%s\"}",
+                i > 0 ? "," : "", 1700000000 + i * 60, messages[rand() % 5]);
+    }
+    content[length++] = ']';
+    double megabytes = length / 1e6;
+
+    printf("log array of %d entries, %.1f MB:\n", UTF8_LOG_ENTRIES, megabytes);
+    utf8_context_t plain = { content, length, 0 };
+    utf8_context_t validated = { content, length, cJSON_ValidateUTF8 };
+    // alternated, so both see the same noise from the machine
+    double plain_ns = 0, validated_ns = 0;
+    int runs = bench_runs;
+    bench_runs = 1;
+    for (int run = 0; run < runs; run++) {
+        double ns = bench_best_ns(utf8_parse, &plain, 1);
+        plain_ns = (run == 0 || ns < plain_ns) ? ns : plain_ns;
+        ns = bench_best_ns(utf8_parse, &validated, 1);
+        validated_ns = (run == 0 || ns < validated_ns) ? ns : validated_ns;
+    }
+    bench_runs = runs;
+    printf("  without hint         %7.1f MB/s\n", megabytes / (plain_ns / 1e9));
+    printf("  cJSON_ValidateUTF8   %7.1f MB/s  (%+.1f %% time)\n", megabytes / (validated_ns / 1e9),
+            (validated_ns / plain_ns - 1) * 100);
+
+    free(content);
+}
+
+// ---------------- GENERATED BINDINGS -------------
+// the website's alarm document, with the members it has for the web page
+static const char bind_document[] = "{\"alarm\":{\"enabled\":true,\"hour\":6,\"minute\":45,\"label\":\"weekdays\","
+        "\"updated\":\"2026-10-18T21:04:11Z\"},\"timezone\":\"CET-1CEST,M3.5.0,M10.5.0/3\",\"version\":12}";
+
+static void bind_parse_generated(void *context) {
+    alarm_config_t config;
+    if (alarm_config_parse(bind_document, sizeof(bind_document) - 1, &config) == ESP_OK) {
+        bench_sink += (size_t)(config.hour + config.minute + config.enabled);
+    }
+}
+
+// what process_web_data() did before the generated parser
+static void bind_parse_cjson(void *context) {
+    cJSON *json = cJSON_ParseWithLength(bind_document, sizeof(bind_document) - 1);
+    cJSON *alarm = cJSON_GetObjectItem(json, "alarm");
+    cJSON *enabled = cJSON_GetObjectItem(alarm, "enabled");
+    cJSON *hour = cJSON_GetObjectItem(alarm, "hour");
+    cJSON *minute = cJSON_GetObjectItem(alarm, "minute");
+    bench_sink += (size_t)(hour->valueint + minute->valueint + cJSON_IsTrue(enabled));
+    cJSON_Delete(json);
+}
+
+static void bind_serialize_generated(void *context) {
+    char buffer[64];
+    size_t length;
+    if (alarm_config_serialize(context, buffer, sizeof(buffer), &length) == ESP_OK) {
+        bench_sink += length;
+    }
+}
+
+static void bind_serialize_cjson(void *context) {
+    const alarm_config_t *config = context;
+    cJSON *json = cJSON_CreateObject();
+    cJSON *alarm = cJSON_AddObjectToObject(json, "alarm");
+    cJSON_AddBoolToObject(alarm, "enabled", config->enabled);
+    cJSON_AddNumberToObject(alarm, "hour", config->hour);
+    cJSON_AddNumberToObject(alarm, "minute", config->minute);
+    char *printed = cJSON_PrintUnformatted(json);
+    bench_sink += strlen(printed);
+    cJSON_free(printed);
+    cJSON_Delete(json);
+}
+
+static void bench_bind(void) {
+    alarm_config_t config = { .enabled = true, .hour = 6, .minute = 45 };
+
+    // plain malloc like on the device, the counting hooks would slow down only the cJSON side
+    cJSON_InitHooks(NULL);
+    printf("alarm settings, %zu bytes:\n", sizeof(bind_document) - 1);
+    printf("  parse      alarm_config_parse %7.0f ns  cJSON + GetObjectItem %7.0f ns\n",
+            bench_best_ns(bind_parse_generated, NULL, 100000), bench_best_ns(bind_parse_cjson, NULL, 100000));
+    printf("  serialize  alarm_config_serialize %3.0f ns  cJSON + PrintUnformatted %4.0f ns\n",
+            bench_best_ns(bind_serialize_generated, &config, 100000), bench_best_ns(bind_serialize_cjson, &config, 100000));
+}
+
+// ---------------- NDJSON STREAMS -------------
+#define STREAM_RECORDS 50000
+
+typedef struct {
+    const char *content;
+    size_t length;
+    int threads;
+} stream_context_t;
+
+static void stream_parse_all(void *context) {
+    const stream_context_t *log = context;
+    cJSON_Stream stream;
+    cJSON *record;
+
+    cJSON_InitStream(&stream, log->content, log->length, true);
+    while ((record = cJSON_ParseStreamNext(&stream, NULL, NULL)) != NULL) {
+        bench_sink += (size_t)cJSON_GetArraySize(record);
+        cJSON_Delete(record);
+    }
+}
+
+static void stream_count_record(const cJSON *record, size_t start, size_t end, void *context) {
+    (void)record;
+    (void)context;
+    bench_sink += end - start;
+}
+
+static void stream_parse_sharded(void *context) {
+    const stream_context_t *log = context;
+    ndjson_shard_result_t result;
+    ndjson_parse_sharded(log->content, log->length, log->threads, 0, stream_count_record, NULL, &result);
+}
+
+static void bench_stream(void) {
+    static const int thread_counts[] = { 1, 2, 4, 8 };
+    size_t capacity = STREAM_RECORDS * 160, length = 0;
+    char *content = malloc(capacity);
+
+    // a recorded wake log: one object per wake, with a few stages and samples
+    srand(2);
+    for (int i = 0; i < STREAM_RECORDS; i++) {
+        length += (size_t)snprintf(content + length, capacity - length,
+                "{\"wake\":%d,\"reason\":\"timer\",\"stages\":{\"wifi\":%d,\"http\":%d,\"sntp\":%d},"
+                "\"rssi\":[%d,%d,%d],\"ok\":true}\n", i, 300 + rand() % 900, 80 + rand() % 400, rand() % 200,
+                -50 - rand() % 30, -50 - rand() % 30, -50 - rand() % 30);
+    }
+    stream_context_t log = { content, length, 1 };
+    double megabytes = length / 1e6;
+
+    // plain malloc to compare the pool with, and the counting hooks aren't thread safe
+    cJSON_InitHooks(NULL);
+
+    printf("%d records, %.1f MB:\n", STREAM_RECORDS, megabytes);
+    double ns = bench_best_ns(stream_parse_all, &log, 1);
+    printf("  cJSON_Stream, malloc         %7.1f MB/s\n", megabytes / (ns / 1e9));
+
+    json_pool_config_t config = JSON_POOL_DEFAULT_CONFIG();
+    json_pool_t pool;
+    if (json_pool_init(&pool, &config) == ESP_OK) {
+        json_pool_stats_t stats;
+        json_pool_install(&pool);
+        ns = bench_best_ns(stream_parse_all, &log, 1);
+        json_pool_get_stats(&pool, &stats);
+        json_pool_install(NULL);
+        json_pool_deinit(&pool);
+        printf("  cJSON_Stream, json_pool      %7.1f MB/s  (%zu nodes at most, %zu heap fallbacks)\n",
+                megabytes / (ns / 1e9), stats.peak[0], stats.fallbacks);
+    }
+
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        log.threads = thread_counts[t];
+        ns = bench_best_ns(stream_parse_sharded, &log, 1);
+        printf("  sharded, %d thread%s           %7.1f MB/s\n", log.threads, log.threads > 1 ? "s" : " ",
+                megabytes / (ns / 1e9));
+    }
+    printf("  (%ld cores online)\n", sysconf(_SC_NPROCESSORS_ONLN));
+
+    free(content);
+}
+
+// ---------------- LARGE DOCUMENTS -------------
+#define TAPE_RECORDS 100000
+
+typedef enum {
+    LARGE_PARSE,
+    LARGE_LAZY,
+    LARGE_TAPE,
+} large_parser_t;
+
+typedef struct {
+    const char *content;
+    size_t length;
+    large_parser_t parser;
+} large_context_t;
+
+static void large_parse(void *context) {
+    const large_context_t *large = context;
+
+    if (large->parser == LARGE_TAPE) {
+        cJSON_Tape *tape = cJSON_TapeParse(large->content, large->length);
+        bench_sink += (tape != NULL) ? tape->count : 0;
+        cJSON_TapeDelete(tape);
+    }
+    else if (large->parser == LARGE_LAZY) {
+        cJSON_Lazy *document = cJSON_LazyParse(large->content, large->length);
+        bench_sink += (document != NULL) ? document->count : 0;
+        cJSON_LazyDelete(document);
+    }
+    else {
+        cJSON *document = cJSON_ParseWithLength(large->content, large->length);
+        bench_sink += (size_t)cJSON_GetArraySize(document);
+        cJSON_Delete(document);
+    }
+}
+
+static void large_measure(const char *label, const char *content, size_t length) {
+    static const char *const parsers[] = { "cJSON_ParseWithLength", "cJSON_LazyParse (no values)", "cJSON_TapeParse" };
+    double megabytes = length / 1e6;
+
+    printf("%s, %.1f MB:\n", label, megabytes);
+    for (int parser = LARGE_PARSE; parser <= LARGE_TAPE; parser++) {
+        large_context_t large = { content, length, (large_parser_t)parser };
+        double ns = bench_best_ns(large_parse, &large, 1);
+        printf("  %-28s %7.1f MB/s\n", parsers[parser], megabytes / (ns / 1e9));
+    }
+}
+
+static void bench_tape(void) {
+    size_t capacity = TAPE_RECORDS * 200, length = 0;
+    char *content = malloc(capacity);
+
+    // plain malloc like a host tool would use, the counting hooks cost time of their own
+    cJSON_InitHooks(NULL);
+
+    // months of recorded wakes in one array, mostly numbers
+    srand(6);
+    length += (size_t)snprintf(content + length, capacity - length, "[");
+    for (int i = 0; i < TAPE_RECORDS; i++) {
+        length += (size_t)snprintf(content + length, capacity - length,
+                "%s{\"wake\":%d,\"reason\":\"timer\",\"stages\":{\"wifi\":%d,\"http\":%d,\"sntp\":%d},"
+                "\"rssi\":[%d,%d,%d],\"battery\":%d.%02d,\"ok\":true}", i > 0 ? "," : "", i, 300 + rand() % 900,
+                80 + rand() % 400, rand() % 200, -50 - rand() % 30, -50 - rand() % 30, -50 - rand() % 30,
+                3 + rand() % 2, rand() % 100);
+    }
+    length += (size_t)snprintf(content + length, capacity - length, "]");
+    large_measure("wake records", content, length);
+
+    // the device log, mostly strings and some of them escaped
+    length = 0;
+    length += (size_t)snprintf(content + length, capacity - length, "[");
+    for (int i = 0; i < TAPE_RECORDS; i++) {
+        length += (size_t)snprintf(content + length, capacity - length,
+                "%s{\"device\":\"light-alarm-kitchen\",\"level\":\"%s\",\"tag\":\"http\",\"message\":\"%s\","
+                "\"url\":\"https://config.example.com/alarm/%d?etag=%08x\"}", i > 0 ? "," : "", (i % 7) ? "info" : "warn",
+                (i % 5) ? "settings fetched, the alarm stays at the same time" : "retrying after \\\"timeout\\\"\\n",
+                i, (unsigned)rand());
+    }
+    length += (size_t)snprintf(content + length, capacity - length, "]");
+    large_measure("log records", content, length);
+
+    free(content);
+}
+#endif
+
+// ---------------- KEY LOOKUP -------------
+typedef struct {
+    const cJSON *object;
+    char (*queries)[32];
+    int count;
+    bool case_sensitive;
+} lookup_context_t;
+
+static void lookup_all(void *context) {
+    const lookup_context_t *lookup = context;
+    for (int i = 0; i < lookup->count; i++) {
+        const cJSON *item = lookup->case_sensitive ? cJSON_GetObjectItemCaseSensitive(lookup->object, lookup->queries[i])
+                : cJSON_GetObjectItem(lookup->object, lookup->queries[i]);
+        bench_sink += (size_t)item->valueint;
+    }
+}
+
+static void bench_lookup(void) {
+    static const int sizes[] = { 10, 50, 100, 500 };
+
+    printf("looking up every key of an object, per lookup:\n");
+    for (size_t size = 0; size < sizeof(sizes) / sizeof(sizes[0]); size++) {
+        int count = sizes[size];
+        char (*keys)[32] = malloc((size_t)count * sizeof(*keys));
+        char (*folded)[32] = malloc((size_t)count * sizeof(*folded));
+        cJSON *object = cJSON_CreateObject();
+
+        // keys with a long common prefix, like the members of a settings or telemetry document
+        for (int i = 0; i < count; i++) {
+            snprintf(keys[i], sizeof(keys[i]), "SensorReading%04dRaw", i);
+            for (size_t c = 0; c <= strlen(keys[i]); c++) {
+                folded[i][c] = (char)((keys[i][c] >= 'A' && keys[i][c] <= 'Z') ? keys[i][c] + 32 : keys[i][c]);
+            }
+            cJSON_AddNumberToObject(object, keys[i], i);
+        }
+
+        lookup_context_t insensitive = { object, folded, count, false };
+        lookup_context_t sensitive = { object, keys, count, true };
+        int iterations = 20000 / count + 1;
+        double insensitive_ns = bench_best_ns(lookup_all, &insensitive, iterations) / count;
+        double sensitive_ns = bench_best_ns(lookup_all, &sensitive, iterations) / count;
+        printf("  %3d keys  case insensitive %8.1f ns  case sensitive %8.1f ns\n", count, insensitive_ns, sensitive_ns);
+
+        cJSON_Delete(object);
+        free(keys);
+        free(folded);
+    }
+}
+
+// ---------------- PRINTING -------------
+#define PRINT_RECORDS 20000
+#define PRINT_REPORTS 500
+#define PRINT_REPORT_LENGTH 8192
+
+typedef struct {
+    cJSON *document;
+    bool formatted;
+    char *buffer;
+    int buffer_size;
+} print_context_t;
+
+// into a buffer that is already there, growing the output buffer would take more time than the printing
+static void print_document(void *context) {
+    const print_context_t *print = context;
+    bench_sink += (size_t)cJSON_PrintPreallocated(print->document, print->buffer, print->buffer_size, print->formatted);
+}
+
+static void print_measure(const char *label, cJSON *document) {
+    char *printed = cJSON_Print(document);
+    int buffer_size = (int)strlen(printed) + 1;
+    cJSON_free(printed);
+    char *buffer = malloc((size_t)buffer_size);
+    memset(buffer, 0, (size_t)buffer_size);
+
+    printf("%s, %.1f MB formatted:\n", label, buffer_size / 1e6);
+    for (int formatted = 0; formatted < 2; formatted++) {
+        print_context_t print = { document, formatted != 0, buffer, buffer_size };
+        double ns = bench_best_ns(print_document, &print, 3);
+        printf("  %-12s %8.2f ms\n", formatted ? "formatted" : "unformatted", ns / 1e6);
+    }
+
+    free(buffer);
+    cJSON_Delete(document);
+}
+
+static void bench_print(void) {
+    static const char *const notes[] = {
+        "plain ASCII without anything to escape, like most names and messages",
+        "path \"C:\\\\alarm\\\\config.json\" quoted",
+        "two lines\nwith a\ttab",
+        "control \x01\x02 bytes and caf\xC3\xA9",
+    };
+    char label[64];
+
+    // log records with string values and keys, some of them with escapes; numbers are left out, their
+    // printing through sprintf would hide the strings
+    cJSON *document = cJSON_CreateArray();
+    srand(5);
+    for (int i = 0; i < PRINT_RECORDS; i++) {
+        cJSON *record = cJSON_CreateObject();
+        cJSON *wifi = cJSON_CreateObject();
+        cJSON_AddStringToObject(record, "device", "light-alarm-kitchen");
+        cJSON_AddStringToObject(record, "note", notes[rand() % 4]);
+        cJSON_AddStringToObject(record, (i % 3 == 0) ? "user \"agent\"" : "user_agent", "esp-idf/5.1 \"light-alarm\"");
+        cJSON_AddStringToObject(wifi, "ssid", "home-network");
+        cJSON_AddStringToObject(wifi, "state", (i % 2 == 0) ? "connected" : "reconnecting\n");
+        cJSON_AddItemToObject(record, "wifi", wifi);
+        cJSON_AddItemToArray(document, record);
+    }
+    snprintf(label, sizeof(label), "%d log records", PRINT_RECORDS);
+    print_measure(label, document);
+
+    // crash reports: long multi-line strings with a quote now and then
+    char *report = malloc(PRINT_REPORT_LENGTH + 1);
+    for (int i = 0; i < PRINT_REPORT_LENGTH; i++) {
+        report[i] = (i % 80 == 79) ? '\n' : (i % 997 == 0) ? '\"' : (char)('a' + i % 26);
+    }
+    report[PRINT_REPORT_LENGTH] = '\0';
+    document = cJSON_CreateArray();
+    for (int i = 0; i < PRINT_REPORTS; i++) {
+        cJSON *record = cJSON_CreateObject();
+        cJSON_AddStringToObject(record, "device", "light-alarm-kitchen");
+        cJSON_AddStringToObject(record, "backtrace", report);
+        cJSON_AddItemToArray(document, record);
+    }
+    free(report);
+    snprintf(label, sizeof(label), "%d reports of %d KB", PRINT_REPORTS, PRINT_REPORT_LENGTH / 1024);
+    print_measure(label, document);
+}
+
+static const bench_scenario_t scenarios[] = {
+#ifndef JSON_BENCH_BASELINE
+    { "packed", "packed numeric arrays against one node per element", bench_packed },
+    { "stream", "NDJSON with cJSON_Stream, json_pool and sharded on threads", bench_stream },
+    { "utf8", "parse time with and without cJSON_ValidateUTF8", bench_utf8 },
+    { "bind", "generated alarm_config parser and serializer against the cJSON path", bench_bind },
+    { "tape", "documents of 10 MB and more, tree against cJSON_LazyParse and cJSON_TapeParse", bench_tape },
+#endif
+    { "lookup", "cJSON_GetObjectItem on objects of 10 to 500 keys", bench_lookup },
+    { "print", "printing records with escaped strings and keys", bench_print },
+};
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-r runs] [scenario...]\nscenarios:\n", program);
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        fprintf(stderr, "  %-10s %s\n", scenarios[i].name, scenarios[i].description);
+    }
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    cJSON_Hooks hooks = { counting_malloc, counting_free };
+    int option;
+
+    while ((option = getopt(argc, argv, "r:")) != -1) {
+        switch (option) {
+            case 'r':
+                bench_runs = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (bench_runs <= 0) {
+        usage(argv[0]);
+    }
+    for (int arg = optind; arg < argc; arg++) {
+        bool known = false;
+        for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+            known |= strcmp(argv[arg], scenarios[i].name) == 0;
+        }
+        if (!known) {
+            usage(argv[0]);
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        bool selected = (optind >= argc);
+        for (int arg = optind; arg < argc && !selected; arg++) {
+            selected = strcmp(argv[arg], scenarios[i].name) == 0;
+        }
+        if (selected) {
+            cJSON_InitHooks(&hooks);
+            printf("==== %s\n", scenarios[i].name);
+            scenarios[i].run();
+            printf("\n");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,275 @@
+// Soak test of json_pool against the heap, on the host. A device state object gets the same random edits
+// (add, replace and delete members, short and long strings, nested objects and arrays) once with cJSON on
+// malloc and once on a json_pool, and the two trees have to end up the same. Then it shows:
+//
+//  - allocation latency: the malloc/free calls of the run are recorded and replayed on both allocators
+//  - fragmentation: what the heap holds for the live tree at the end, against the pool's fixed size
+//
+//     json_soak [-n edits] [-s seed] [-r runs]
+//
+// ctest runs it with fewer edits as a test; the numbers only mean something in a release build.
+
+#include <getopt.h>
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "cJSON.h"
+#include "json_pool.h"
+
+#define SOAK_KEYS       64
+#define SOAK_LONG_TEXT  200
+
+typedef struct {
+    int32_t id;     // of the allocation
+    uint32_t size;  // 0 for a free
+} soak_call_t;
+
+static int soak_edits = 100000;
+static unsigned int soak_seed = 1;
+static int soak_runs = 5;
+
+// the recorded calls, with ids so the replay can free the right pointer
+static soak_call_t *calls;
+static size_t call_count, call_capacity;
+static int32_t next_id;
+static size_t live_bytes, live_bytes_peak;
+
+static uint32_t random_state;
+
+// ---------------- PRIVATE FUNCTIONS -------------
+static uint32_t next_random(void) {
+    // xorshift32, the same sequence for both runs
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state;
+}
+
+static void record(int32_t id, size_t size) {
+    if (call_count == call_capacity) {
+        call_capacity = call_capacity ? call_capacity * 2 : 1 << 16;
+        calls = realloc(calls, call_capacity * sizeof(*calls));
+    }
+    calls[call_count++] = (soak_call_t) { id, (uint32_t)size };
+}
+
+// recording hooks on top of malloc. The id is stored in front of the block.
+static void *recording_malloc(size_t size) {
+    size_t *block = malloc(size + sizeof(size_t) * 2);
+    if (block == NULL) {
+        return NULL;
+    }
+    block[0] = (size_t)next_id;
+    block[1] = size;
+    record(next_id++, size);
+    live_bytes += size;
+    if (live_bytes > live_bytes_peak) {
+        live_bytes_peak = live_bytes;
+    }
+    return block + 2;
+}
+
+static void recording_free(void *pointer) {
+    if (pointer == NULL) {
+        return;
+    }
+    size_t *block = (size_t *)pointer - 2;
+    record((int32_t)block[0], 0);
+    live_bytes -= block[1];
+    free(block);
+}
+
+static void random_text(char *text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        text[i] = (char)('a' + next_random() % 26);
+    }
+    text[length] = '\0';
+}
+
+// one random edit of the device state
+static void edit(cJSON *state) {
+    char key[16], text[SOAK_LONG_TEXT + 1];
+    cJSON *value;
+
+    snprintf(key, sizeof(key), "k%02u", (unsigned)(next_random() % SOAK_KEYS));
+    switch (next_random() % 8) {
+        case 0:
+            cJSON_DeleteItemFromObject(state, key);
+            return;
+        case 1:
+        case 2:
+            value = cJSON_CreateNumber(next_random() % 100000);
+            break;
+        case 3:
+        case 4:
+            random_text(text, 1 + next_random() % 60);
+            value = cJSON_CreateString(text);
+            break;
+        case 5:
+            random_text(text, 100 + next_random() % 100);
+            value = cJSON_CreateString(text);
+            break;
+        case 6:
+            value = cJSON_CreateObject();
+            cJSON_AddNumberToObject(value, "rssi", -40 - (int)(next_random() % 50));
+            cJSON_AddStringToObject(value, "ssid", "home-network");
+            cJSON_AddBoolToObject(value, "ok", next_random() & 1);
+            break;
+        default: {
+            int samples[8];
+            for (int i = 0; i < 8; i++) {
+                samples[i] = (int)(next_random() % 1000);
+            }
+            value = cJSON_CreateIntArray(samples, 1 + (int)(next_random() % 8));
+            break;
+        }
+    }
+    if (cJSON_GetObjectItemCaseSensitive(state, key) != NULL) {
+        cJSON_ReplaceItemInObjectCaseSensitive(state, key, value);
+    }
+    else {
+        cJSON_AddItemToObject(state, key, value);
+    }
+}
+
+static cJSON *run_edits(void) {
+    cJSON *state = cJSON_CreateObject();
+    random_state = soak_seed;
+    for (int i = 0; i < soak_edits; i++) {
+        edit(state);
+    }
+    return state;
+}
+
+static int64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * @brief replays the recorded calls through cJSON_malloc/cJSON_free (so through the installed hooks), and
+ * returns the time per call of the fastest run in ns. The recording ends with the cJSON_Delete of the tree,
+ * so every run frees all it allocated.
+ */
+static double replay_best_ns(void **pointers) {
+    double best = 0;
+
+    for (int run = 0; run < soak_runs; run++) {
+        int64_t started = now_ns();
+        for (size_t i = 0; i < call_count; i++) {
+            if (calls[i].size != 0) {
+                pointers[calls[i].id] = cJSON_malloc(calls[i].size);
+            }
+            else {
+                cJSON_free(pointers[calls[i].id]);
+            }
+        }
+        double per_call = (double)(now_ns() - started) / call_count;
+        if (run == 0 || per_call < best) {
+            best = per_call;
+        }
+    }
+    return best;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-n edits] [-s seed] [-r runs]\n", program);
+    exit(2);
+}
+
+// ---------------- MAIN -------------
+int main(int argc, char **argv) {
+    int option;
+
+    while ((option = getopt(argc, argv, "n:s:r:")) != -1) {
+        switch (option) {
+            case 'n':
+                soak_edits = atoi(optarg);
+                break;
+            case 's':
+                soak_seed = (unsigned int)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                soak_runs = atoi(optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (soak_edits <= 0 || soak_seed == 0 || soak_runs <= 0) {
+        usage(argv[0]);
+    }
+
+    // the heap: a fresh process, so what malloc holds is mostly the tree and what its edits left behind
+    struct mallinfo2 before = mallinfo2();
+    cJSON *heap_state = run_edits();
+    struct mallinfo2 after = mallinfo2();
+    char *heap_text = cJSON_PrintUnformatted(heap_state);
+
+    // the same edits on a pool sized for them; strings over 64 bytes always go to the heap
+    json_pool_config_t config = { .nodes = 256, .strings = { 256, 128, 64 } };
+    json_pool_stats_t stats;
+    json_pool_t pool;
+    if (json_pool_init(&pool, &config) != ESP_OK) {
+        fprintf(stderr, "json_pool_init failed\n");
+        return 1;
+    }
+    json_pool_install(&pool);
+    cJSON *pool_state = run_edits();
+    char *pool_text = cJSON_PrintUnformatted(pool_state);
+    bool same = strcmp(pool_text, heap_text) == 0;
+    cJSON_free(pool_text);
+    json_pool_get_stats(&pool, &stats);
+    cJSON_Delete(pool_state);
+    json_pool_stats_t freed;
+    json_pool_get_stats(&pool, &freed);
+    json_pool_install(NULL);
+    bool returned = true;
+    for (size_t i = 0; i < JSON_POOL_STRING_CLASSES + 1; i++) {
+        returned &= freed.in_use[i] == 0;
+    }
+
+    // record the allocations of the same run for the replay
+    cJSON_Hooks recording = { recording_malloc, recording_free };
+    cJSON_InitHooks(&recording);
+    cJSON *recorded_state = run_edits();
+    size_t tree_bytes = live_bytes;
+    cJSON_Delete(recorded_state);
+    cJSON_InitHooks(NULL);
+
+    void **pointers = calloc((size_t)next_id, sizeof(void *));
+    double heap_ns = replay_best_ns(pointers);
+    json_pool_install(&pool);
+    double pool_ns = replay_best_ns(pointers);
+    json_pool_install(NULL);
+
+    printf("%d edits of a %d key device state (seed %u):\n", soak_edits, SOAK_KEYS, soak_seed);
+    printf("  allocation latency over %zu malloc/free calls: malloc %.1f ns, json_pool %.1f ns per call\n",
+            call_count, heap_ns, pool_ns);
+    printf("  live tree %zu bytes (peak %zu)\n", tree_bytes, live_bytes_peak);
+    // free memory below the top of the heap is in holes between live blocks, it can't be given back
+    printf("  malloc:    %zu bytes in use for the tree, %zu bytes in holes, heap grew by %zu bytes\n",
+            after.uordblks - before.uordblks, (after.fordblks - after.keepcost) - (before.fordblks - before.keepcost),
+            after.arena - before.arena);
+    printf("  json_pool: %zu bytes fixed, peak blocks %zu nodes / %zu+%zu+%zu strings, %zu heap fallbacks\n",
+            pool.memory_size, stats.peak[0], stats.peak[1], stats.peak[2], stats.peak[3], stats.fallbacks);
+
+    cJSON_free(heap_text);
+    cJSON_Delete(heap_state);
+    json_pool_deinit(&pool);
+    free(pointers);
+    free(calls);
+
+    if (!same) {
+        fprintf(stderr, "the tree built in the pool differs from the one on the heap\n");
+    }
+    if (!returned) {
+        fprintf(stderr, "blocks still in use after cJSON_Delete\n");
+    }
+    return (same && returned) ? 0 : 1;
+}
@@ -0,0 +1,1047 @@
+// Unit tests of the cJSON extensions and the JSON helpers in components/, run by ctest (see CMakeLists.txt).
+//
+//     json_test [test...]
+//
+// Without arguments every test runs. cJSON allocates through counting hooks, so a test that leaves anything
+// allocated fails too.
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "alarm_config.h"
+#include "bind_test.h"
+#include "cJSON.h"
+#include "json_pool.h"
+#include "ndjson_shard.h"
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+} json_test_t;
+
+static bool test_failed;
+static size_t live_allocations;
+
+// the first failed check ends the test, what it allocated is leaked and not counted against it
+#define CHECK(condition) do {                                                           \
+        if (!(condition)) {                                                             \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failed = true;                                                         \
+            return;                                                                     \
+        }                                                                               \
+    } while (0)
+
+#define CHECK_PRINTS(item, expected) do {                                               \
+        char *printed_ = cJSON_PrintUnformatted(item);                                  \
+        bool equal_ = printed_ != NULL && strcmp(printed_, expected) == 0;              \
+        if (!equal_) {                                                                  \
+            fprintf(stderr, "%s:%d: printed %s, expected %s\n", __FILE__, __LINE__,     \
+                    printed_ != NULL ? printed_ : "(null)", expected);                  \
+        }                                                                               \
+        cJSON_free(printed_);                                                           \
+        CHECK(equal_);                                                                  \
+    } while (0)
+
+static void *counting_malloc(size_t size) {
+    void *pointer = malloc(size);
+    live_allocations += (pointer != NULL);
+    return pointer;
+}
+
+static void counting_free(void *pointer) {
+    live_allocations -= (pointer != NULL);
+    free(pointer);
+}
+
+static void install_counting_hooks(void) {
+    cJSON_Hooks hooks = { counting_malloc, counting_free };
+    cJSON_InitHooks(&hooks);
+}
+
+static cJSON *parse(const char *text, int hints) {
+    return cJSON_ParseWithLengthHints(text, strlen(text), hints);
+}
+
+// ---------------- PACKED ARRAYS -------------
+static void test_packed_create(void) {
+    const int ints[] = { 1, -2, INT_MAX, INT_MIN };
+    const float floats[] = { 0.1f, 1.5f, -3.0f };
+    const double doubles[] = { 0.5, -3, 1e300 };
+
+    cJSON *packed = cJSON_CreatePackedIntArray(ints, 4);
+    CHECK(packed != NULL);
+    CHECK(cJSON_IsArray(packed) && cJSON_IsPackedArray(packed));
+    CHECK(cJSON_GetArraySize(packed) == 4);
+    CHECK(cJSON_GetArrayItem(packed, 0) == NULL);
+    CHECK(packed->child == NULL);
+    CHECK(memcmp(cJSON_GetPackedArrayData(packed), ints, sizeof(ints)) == 0);
+    CHECK_PRINTS(packed, "[1,-2,2147483647,-2147483648]");
+    char *formatted = cJSON_Print(packed);
+    CHECK(formatted != NULL && strcmp(formatted, "[1, -2, 2147483647, -2147483648]") == 0);
+    cJSON_free(formatted);
+    // nothing can be added to it
+    cJSON *number = cJSON_CreateNumber(1);
+    CHECK(!cJSON_AddItemToArray(packed, number));
+    cJSON_Delete(number);
+    cJSON_Delete(packed);
+
+    packed = cJSON_CreatePackedFloatArray(floats, 3);
+    CHECK(packed != NULL && (packed->type & cJSON_PackedFloat));
+    CHECK_PRINTS(packed, "[0.1,1.5,-3]");
+    cJSON_Delete(packed);
+
+    packed = cJSON_CreatePackedDoubleArray(doubles, 3);
+    CHECK(packed != NULL && (packed->type & cJSON_PackedDouble));
+    CHECK(((const double *)cJSON_GetPackedArrayData(packed))[2] == 1e300);
+    CHECK_PRINTS(packed, "[0.5,-3,1e+300]");
+    cJSON_Delete(packed);
+
+    packed = cJSON_CreatePackedIntArray(ints, 0);
+    CHECK(packed != NULL && cJSON_GetArraySize(packed) == 0);
+    CHECK_PRINTS(packed, "[]");
+    cJSON_Delete(packed);
+
+    CHECK(cJSON_CreatePackedIntArray(NULL, 1) == NULL);
+    CHECK(cJSON_CreatePackedDoubleArray(doubles, -1) == NULL);
+    CHECK(cJSON_GetPackedArrayData(NULL) == NULL);
+    cJSON *regular = cJSON_CreateIntArray(ints, 2);
+    CHECK(!cJSON_IsPackedArray(regular) && cJSON_GetPackedArrayData(regular) == NULL);
+    cJSON_Delete(regular);
+}
+
+static void test_packed_parse(void) {
+    cJSON *root = parse("{\"heap\":[153000, 152872,-1],\"latency\":[1.5,2],\"mixed\":[1,\"a\"],\"empty\":[],"
+            "\"nested\":[[1],[2,3]]}", cJSON_PackedInt);
+    CHECK(root != NULL);
+
+    cJSON *heap = cJSON_GetObjectItem(root, "heap");
+    CHECK(cJSON_IsPackedArray(heap) && (heap->type & cJSON_PackedInt) && cJSON_GetArraySize(heap) == 3);
+    const int *heap_values = cJSON_GetPackedArrayData(heap);
+    CHECK(heap_values[0] == 153000 && heap_values[1] == 152872 && heap_values[2] == -1);
+    // not integral, mixed and empty arrays stay regular
+    cJSON *latency = cJSON_GetObjectItem(root, "latency");
+    CHECK(!cJSON_IsPackedArray(latency) && cJSON_GetArraySize(latency) == 2);
+    CHECK(cJSON_GetArrayItem(latency, 0)->valuedouble == 1.5);
+    CHECK(!cJSON_IsPackedArray(cJSON_GetObjectItem(root, "mixed")));
+    CHECK(!cJSON_IsPackedArray(cJSON_GetObjectItem(root, "empty")));
+    // arrays of arrays aren't, their elements are
+    cJSON *nested = cJSON_GetObjectItem(root, "nested");
+    CHECK(!cJSON_IsPackedArray(nested) && cJSON_IsPackedArray(cJSON_GetArrayItem(nested, 1)));
+    CHECK_PRINTS(root, "{\"heap\":[153000,152872,-1],\"latency\":[1.5,2],\"mixed\":[1,\"a\"],\"empty\":[],"
+            "\"nested\":[[1],[2,3]]}");
+    cJSON_Delete(root);
+
+    root = parse("[1.5, 2, -0.25]", cJSON_PackedDouble);
+    CHECK(root != NULL && (root->type & cJSON_PackedDouble) && cJSON_GetArraySize(root) == 3);
+    CHECK(((const double *)cJSON_GetPackedArrayData(root))[2] == -0.25);
+    cJSON_Delete(root);
+
+    root = parse("[0.1, 3]", cJSON_PackedFloat);
+    CHECK(root != NULL && (root->type & cJSON_PackedFloat));
+    CHECK(((const float *)cJSON_GetPackedArrayData(root))[0] == 0.1f);
+    cJSON_Delete(root);
+
+    // malformed input is still an error, and more than the 16 elements of the first block
+    CHECK(parse("[1, 2,]", cJSON_PackedInt) == NULL);
+    CHECK(parse("[1 2]", cJSON_PackedInt) == NULL);
+    root = parse("[0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19]", cJSON_PackedInt);
+    CHECK(root != NULL && cJSON_GetArraySize(root) == 20 && ((const int *)cJSON_GetPackedArrayData(root))[19] == 19);
+    cJSON_Delete(root);
+}
+
+static void test_packed_duplicate_compare(void) {
+    const int ints[] = { 3, 1, 4, 1, 5 };
+    cJSON *packed = cJSON_CreatePackedIntArray(ints, 5);
+    cJSON *regular = cJSON_CreateIntArray(ints, 5);
+    cJSON *copy = cJSON_Duplicate(packed, true);
+
+    CHECK(packed != NULL && regular != NULL && copy != NULL);
+    CHECK(cJSON_IsPackedArray(copy) && cJSON_GetPackedArrayData(copy) != cJSON_GetPackedArrayData(packed));
+    CHECK(cJSON_Compare(packed, copy, true));
+    // packed and regular arrays with the same numbers are equal, in both directions
+    CHECK(cJSON_Compare(packed, regular, true) && cJSON_Compare(regular, packed, false));
+    ((int *)cJSON_GetPackedArrayData(copy))[4] = 9;
+    CHECK(!cJSON_Compare(packed, copy, true));
+    cJSON *shorter = cJSON_CreatePackedIntArray(ints, 4);
+    CHECK(!cJSON_Compare(packed, shorter, true));
+
+    cJSON_Delete(shorter);
+    cJSON_Delete(copy);
+    cJSON_Delete(regular);
+    cJSON_Delete(packed);
+}
+
+// ---------------- CASE INSENSITIVE KEYS -------------
+static void test_case_insensitive_lookup(void) {
+    // longer than the keys that are folded once per lookup, to go through the other path as well
+    char long_key[101], long_query[101];
+    memset(long_key, 'K', sizeof(long_key) - 1);
+    memset(long_query, 'k', sizeof(long_query) - 1);
+    long_key[sizeof(long_key) - 1] = long_query[sizeof(long_query) - 1] = '\0';
+
+    cJSON *root = parse("{\"Hour\":7,\"hours\":8,\"h\":9,\"\xc3\x89t\xc3\xa9\":1,\"@[\":2,\"\":3}", 0);
+    CHECK(root != NULL);
+    CHECK(cJSON_AddNumberToObject(root, long_key, 4) != NULL);
+
+    CHECK(cJSON_GetObjectItem(root, "hour")->valueint == 7);
+    CHECK(cJSON_GetObjectItem(root, "HOUR")->valueint == 7);
+    CHECK(cJSON_GetObjectItem(root, "Hours")->valueint == 8);
+    CHECK(cJSON_GetObjectItem(root, "H")->valueint == 9);
+    CHECK(cJSON_GetObjectItem(root, "hou") == NULL);
+    CHECK(cJSON_GetObjectItem(root, "hourss") == NULL);
+    CHECK(cJSON_GetObjectItem(root, "")->valueint == 3);
+    // only ASCII letters fold, the characters next to them in the table and UTF-8 bytes don't
+    CHECK(cJSON_GetObjectItem(root, "\xc3\x89T\xc3\xa9")->valueint == 1);
+    CHECK(cJSON_GetObjectItem(root, "\xc3\xa9t\xc3\xa9") == NULL);
+    CHECK(cJSON_GetObjectItem(root, "@[")->valueint == 2);
+    CHECK(cJSON_GetObjectItem(root, "`{") == NULL);
+    CHECK(cJSON_GetObjectItem(root, long_query)->valueint == 4);
+    long_query[50] = 'x';
+    CHECK(cJSON_GetObjectItem(root, long_query) == NULL);
+    CHECK(cJSON_HasObjectItem(root, "hOuR"));
+    CHECK(cJSON_GetObjectItemCaseSensitive(root, "hour") == NULL);
+    CHECK(cJSON_GetObjectItem(root, NULL) == NULL && cJSON_GetObjectItem(NULL, "hour") == NULL);
+    cJSON_Delete(root);
+}
+
+static void test_case_insensitive_by_name(void) {
+    cJSON *a = parse("{\"Alarm\":{\"Hour\":7,\"Minute\":30},\"enabled\":true}", 0);
+    cJSON *b = parse("{\"ENABLED\":true,\"alarm\":{\"minute\":30,\"hour\":7}}", 0);
+    CHECK(a != NULL && b != NULL);
+
+    CHECK(cJSON_Compare(a, b, false));
+    CHECK(!cJSON_Compare(a, b, true));
+
+    cJSON *alarm = cJSON_GetObjectItem(a, "alarm");
+    CHECK(cJSON_ReplaceItemInObject(alarm, "HOUR", cJSON_CreateNumber(8)));
+    // the replacement keeps the name it is looked up with
+    CHECK(cJSON_GetObjectItemCaseSensitive(alarm, "HOUR")->valueint == 8);
+    CHECK(!cJSON_Compare(a, b, false));
+    cJSON *zero = cJSON_CreateNumber(0);
+    CHECK(!cJSON_ReplaceItemInObjectCaseSensitive(alarm, "minute", zero));
+    cJSON_Delete(zero);
+
+    cJSON *minute = cJSON_DetachItemFromObject(alarm, "mInUtE");
+    CHECK(minute != NULL && minute->valueint == 30);
+    cJSON_Delete(minute);
+    CHECK(cJSON_DetachItemFromObjectCaseSensitive(alarm, "hour") == NULL);
+    cJSON_DeleteItemFromObject(a, "ENABLED");
+    CHECK(cJSON_GetObjectItem(a, "enabled") == NULL);
+    CHECK_PRINTS(a, "{\"Alarm\":{\"HOUR\":8}}");
+
+    cJSON_Delete(a);
+    cJSON_Delete(b);
+}
+
+// ---------------- NDJSON STREAMS -------------
+static void test_stream_records(void) {
+    static const char log[] = "{\"event\":\"wake\"}\n\n  [1, 2] \r\n{\"broken\":\n\"last\"";
+    cJSON_Stream stream;
+    size_t start = 0, end = 0;
+
+    cJSON_InitStream(&stream, log, strlen(log), true);
+    cJSON *record = cJSON_ParseStreamNext(&stream, &start, &end);
+    CHECK(record != NULL && stream.status == cJSON_StreamOk);
+    CHECK(start == 0 && end == 16);
+    CHECK(strcmp(cJSON_GetObjectItem(record, "event")->valuestring, "wake") == 0);
+    cJSON_Delete(record);
+
+    // blank lines are skipped, the range ends with the document
+    record = cJSON_ParseStreamNext(&stream, &start, &end);
+    CHECK(record != NULL && cJSON_GetArraySize(record) == 2);
+    CHECK(strncmp(log + start, "[1, 2]", end - start) == 0 && end - start == 6);
+    cJSON_Delete(record);
+
+    // a bad record is reported, the stream goes on with the next one
+    CHECK(cJSON_ParseStreamNext(&stream, &start, &end) == NULL);
+    CHECK(stream.status == cJSON_StreamError);
+    CHECK(stream.error_offset >= (size_t)(strstr(log, "{\"broken") - log) && stream.error_offset < strlen(log));
+    // the last record doesn't need a newline once the input is final
+    record = cJSON_ParseStreamNext(&stream, &start, &end);
+    CHECK(record != NULL && cJSON_IsString(record) && end == strlen(log));
+    cJSON_Delete(record);
+    CHECK(cJSON_ParseStreamNext(&stream, NULL, NULL) == NULL && stream.status == cJSON_StreamEnd);
+
+    // the parser state outlives a record: two documents on one line are an error, not two records
+    cJSON_InitStream(&stream, "1 2\n3\n", 6, true);
+    CHECK(cJSON_ParseStreamNext(&stream, NULL, NULL) == NULL && stream.status == cJSON_StreamError);
+    record = cJSON_ParseStreamNext(&stream, NULL, NULL);
+    CHECK(record != NULL && record->valueint == 3);
+    cJSON_Delete(record);
+}
+
+static void test_stream_chunks(void) {
+    static const char first[] = "{\"rssi\":[-61,-63]}\n{\"rssi\":";
+    static const char second_rest[] = "[-70]}\n";
+    char chunk[64];
+    cJSON_Stream stream;
+
+    cJSON_InitStream(&stream, first, strlen(first), false);
+    stream.hints = cJSON_PackedInt;
+    cJSON *record = cJSON_ParseStreamNext(&stream, NULL, NULL);
+    CHECK(record != NULL && cJSON_IsPackedArray(cJSON_GetObjectItem(record, "rssi")));
+    cJSON_Delete(record);
+    CHECK(cJSON_ParseStreamNext(&stream, NULL, NULL) == NULL && stream.status == cJSON_StreamNeedMore);
+
+    // the next chunk starts with what is left of this one, the hints stay
+    size_t rest = strlen(first) - stream.offset;
+    memcpy(chunk, first + stream.offset, rest);
+    memcpy(chunk + rest, second_rest, strlen(second_rest));
+    cJSON_FeedStream(&stream, chunk, rest + strlen(second_rest), false);
+    record = cJSON_ParseStreamNext(&stream, NULL, NULL);
+    CHECK(record != NULL);
+    cJSON *rssi = cJSON_GetObjectItem(record, "rssi");
+    CHECK(cJSON_IsPackedArray(rssi) && ((const int *)cJSON_GetPackedArrayData(rssi))[0] == -70);
+    cJSON_Delete(record);
+    CHECK(cJSON_ParseStreamNext(&stream, NULL, NULL) == NULL && stream.status == cJSON_StreamNeedMore);
+    cJSON_FeedStream(&stream, "", 0, true);
+    CHECK(cJSON_ParseStreamNext(&stream, NULL, NULL) == NULL && stream.status == cJSON_StreamEnd);
+}
+
+static void test_stream_pool_reuse(void) {
+    json_pool_config_t config = JSON_POOL_DEFAULT_CONFIG();
+    json_pool_stats_t stats;
+    json_pool_t pool;
+    char log[4096];
+    size_t length = 0;
+    cJSON_Stream stream;
+    int records = 0;
+
+    for (int i = 0; i < 50; i++) {
+        length += (size_t)snprintf(log + length, sizeof(log) - length, "{\"wake\":%d,\"stage\":\"http\",\"ms\":%d}\n",
+                i, 100 + i);
+    }
+    CHECK(json_pool_init(&pool, &config) == ESP_OK);
+    json_pool_install(&pool);
+    cJSON_InitStream(&stream, log, length, true);
+    cJSON *record;
+    while ((record = cJSON_ParseStreamNext(&stream, NULL, NULL)) != NULL) {
+        records += (cJSON_GetObjectItem(record, "wake")->valueint == records);
+        cJSON_Delete(record);
+    }
+    json_pool_get_stats(&pool, &stats);
+    json_pool_install(NULL);
+    json_pool_deinit(&pool);
+    install_counting_hooks();
+
+    // every record reused the blocks of the one before it
+    CHECK(records == 50 && stream.status == cJSON_StreamEnd);
+    CHECK(stats.fallbacks == 0 && stats.peak[0] == 4 && stats.in_use[0] == 0);
+}
+
+// ---------------- JSON POOL -------------
+static bool in_pool(const json_pool_t *pool, const void *pointer) {
+    const unsigned char *block = pointer;
+    return block >= pool->memory && block < pool->memory + pool->memory_size;
+}
+
+static void test_pool_classes(void) {
+    json_pool_config_t config = { .nodes = 1, .strings = { 2, 1, 1 } };
+    json_pool_stats_t used, freed;
+    json_pool_t pool;
+
+    CHECK(json_pool_init(&pool, &config) == ESP_OK);
+    json_pool_install(&pool);
+
+    // the smallest class that fits, the next bigger one once it is used up, then the heap. The node comes
+    // first, on 64 bit hosts its blocks are 64 bytes like the biggest string class.
+    cJSON *node = cJSON_CreateNull();
+    void *short1 = cJSON_malloc(10), *short2 = cJSON_malloc(16), *short3 = cJSON_malloc(1);
+    void *longer = cJSON_malloc(64), *too_long = cJSON_malloc(65), *no_room = cJSON_malloc(33);
+    json_pool_get_stats(&pool, &used);
+    bool placed = in_pool(&pool, node) && in_pool(&pool, short1) && in_pool(&pool, short2) && in_pool(&pool, short3)
+            && in_pool(&pool, longer) && !in_pool(&pool, too_long) && !in_pool(&pool, no_room);
+
+    // freed blocks are handed out again, last in first out
+    cJSON_free(short2);
+    void *again = cJSON_malloc(12);
+    bool reused = again == short2;
+
+    cJSON_Delete(node);
+    cJSON_free(short1);
+    cJSON_free(again);
+    cJSON_free(short3);
+    cJSON_free(longer);
+    cJSON_free(too_long);
+    cJSON_free(no_room);
+    json_pool_get_stats(&pool, &freed);
+    json_pool_install(NULL);
+    json_pool_deinit(&pool);
+    install_counting_hooks();
+
+    CHECK(placed && reused);
+    CHECK(used.in_use[0] == 1 && used.in_use[1] == 2 && used.in_use[2] == 1 && used.in_use[3] == 1);
+    CHECK(used.fallbacks == 2);
+    CHECK(freed.in_use[0] == 0 && freed.in_use[1] == 0 && freed.in_use[2] == 0 && freed.in_use[3] == 0);
+    CHECK(freed.peak[0] == 1 && freed.peak[1] == 2 && freed.peak[2] == 1 && freed.peak[3] == 1);
+}
+
+// a tree built in the pool is the same as one from the heap, and gives all blocks back when deleted
+static void test_pool_tree(void) {
+    const char *text = "{\"device\":\"light-alarm\",\"alarm\":{\"enabled\":true,\"hour\":6,\"minute\":45},"
+            "\"samples\":[1,2,3,4],\"note\":\"a note that is longer than the biggest string block of the pool\"}";
+    json_pool_config_t config = JSON_POOL_DEFAULT_CONFIG();
+    json_pool_stats_t used, freed;
+    json_pool_t pool;
+
+    cJSON *expected = cJSON_Parse(text);
+    CHECK(expected != NULL);
+    char *expected_text = cJSON_PrintUnformatted(expected);
+    cJSON_Delete(expected);
+    CHECK(expected_text != NULL);
+
+    CHECK(json_pool_init(&pool, &config) == ESP_OK);
+    json_pool_install(&pool);
+    cJSON *root = cJSON_Parse(text);
+    cJSON_ReplaceItemInObject(cJSON_GetObjectItem(root, "alarm"), "hour", cJSON_CreateNumber(7));
+    cJSON_ReplaceItemInObject(cJSON_GetObjectItem(root, "alarm"), "hour", cJSON_CreateNumber(6));
+    char *printed = cJSON_PrintUnformatted(root);
+    bool equal = printed != NULL && strcmp(printed, expected_text) == 0;
+    cJSON_free(printed);
+    json_pool_get_stats(&pool, &used);
+    cJSON_Delete(root);
+    json_pool_get_stats(&pool, &freed);
+    json_pool_install(NULL);
+    json_pool_deinit(&pool);
+    install_counting_hooks();
+    cJSON_free(expected_text);
+
+    CHECK(equal);
+    // 12 nodes, the 7 keys and the short string in 16 byte blocks
+    CHECK(used.in_use[0] == 12 && used.in_use[1] == 8 && used.in_use[2] == 0 && used.in_use[3] == 0);
+    // the long string, and the print buffer with the copy it is trimmed to
+    CHECK(freed.fallbacks == 3);
+    CHECK(freed.in_use[0] == 0 && freed.in_use[1] == 0 && freed.in_use[2] == 0 && freed.in_use[3] == 0);
+}
+
+static void test_pool_init(void) {
+    json_pool_config_t config = { 0 };
+    json_pool_stats_t stats;
+    json_pool_t pool;
+
+    CHECK(json_pool_init(NULL, &config) == ESP_ERR_INVALID_ARG);
+    CHECK(json_pool_init(&pool, NULL) == ESP_ERR_INVALID_ARG);
+
+    // an empty pool works, everything goes to the heap
+    CHECK(json_pool_init(&pool, &config) == ESP_OK);
+    json_pool_install(&pool);
+    cJSON *node = cJSON_CreateString("x");
+    cJSON_Delete(node);
+    json_pool_get_stats(&pool, &stats);
+    json_pool_install(NULL);
+    json_pool_deinit(&pool);
+    install_counting_hooks();
+    CHECK(node != NULL && stats.fallbacks == 2 && pool.memory == NULL);
+}
+
+// ---------------- LAZY PARSING -------------
+static cJSON_Lazy *lazy_parse(const char *text) {
+    return cJSON_LazyParse(text, strlen(text));
+}
+
+static void test_lazy_navigation(void) {
+    const char *text = " {\"alarm\":{\"hour\":6,\"minute\":45,\"enabled\":true},\"days\":[1,[2,[3]],{\"x\":null},-2.5e1],"
+            "\"empty\":[],\"none\":{},\"off\":false} ";
+    cJSON_Lazy *document = lazy_parse(text);
+    cJSON_Cursor root, alarm, item, next;
+    double number;
+    cJSON_bool flag;
+
+    CHECK(document != NULL);
+    CHECK(cJSON_LazyRoot(document, &root) && cJSON_CursorType(&root) == cJSON_Object);
+
+    CHECK(cJSON_CursorGetObjectItem(&root, "alarm", &alarm) && cJSON_CursorType(&alarm) == cJSON_Object);
+    CHECK(cJSON_CursorGetObjectItem(&alarm, "minute", &item) && cJSON_CursorGetNumber(&item, &number) && number == 45);
+    CHECK(cJSON_CursorGetObjectItem(&alarm, "enabled", &item) && cJSON_CursorGetBool(&item, &flag) && flag);
+    CHECK(cJSON_CursorGetObjectItem(&root, "off", &item) && cJSON_CursorGetBool(&item, &flag) && !flag);
+    // case sensitive, and keys inside nested objects aren't members
+    CHECK(!cJSON_CursorGetObjectItem(&root, "Alarm", &item));
+    CHECK(!cJSON_CursorGetObjectItem(&root, "hour", &item));
+    // getters of the wrong type
+    CHECK(!cJSON_CursorGetNumber(&alarm, &number) && !cJSON_CursorGetBool(&alarm, &flag));
+    CHECK(!cJSON_CursorGetObjectItem(&item, "x", &next));
+
+    // the elements of days, the nested arrays are stepped over
+    CHECK(cJSON_CursorGetObjectItem(&root, "days", &item) && cJSON_CursorType(&item) == cJSON_Array);
+    static const int types[] = { cJSON_Number, cJSON_Array, cJSON_Object, cJSON_Number };
+    int count = 0;
+    bool more = cJSON_CursorChild(&item, &next);
+    while (more && count < 4) {
+        CHECK(cJSON_CursorType(&next) == types[count]);
+        count++;
+        more = cJSON_CursorNext(&next, &next);
+    }
+    CHECK(count == 4 && !more);
+    CHECK(cJSON_CursorGetNumber(&next, &number) && number == -25);
+
+    CHECK(cJSON_CursorGetObjectItem(&root, "empty", &item) && !cJSON_CursorChild(&item, &next));
+    CHECK(cJSON_CursorGetObjectItem(&root, "none", &item) && !cJSON_CursorChild(&item, &next));
+
+    // a cursor turned into a regular item is the same as that part of a full parse
+    cJSON *full = cJSON_Parse(text);
+    CHECK(full != NULL);
+    CHECK(cJSON_CursorGetObjectItem(&root, "days", &item));
+    cJSON *days = cJSON_CursorToItem(&item);
+    bool equal = cJSON_Compare(days, cJSON_GetObjectItem(full, "days"), true);
+    cJSON_Delete(days);
+    cJSON *whole = cJSON_CursorToItem(&root);
+    equal = equal && cJSON_Compare(whole, full, true);
+    cJSON_Delete(whole);
+    cJSON_Delete(full);
+    cJSON_LazyDelete(document);
+    CHECK(equal);
+
+    // a document that is just a scalar
+    document = lazy_parse("42");
+    CHECK(document != NULL);
+    CHECK(cJSON_LazyRoot(document, &root) && cJSON_CursorGetNumber(&root, &number) && number == 42);
+    cJSON_LazyDelete(document);
+}
+
+static void test_lazy_strings(void) {
+    const char *text = "{\"plain\":\"light\",\"escaped\":\"a\\\"b\\\\c\\n\\u00e9\\ud83d\\udca1\",\"k\\u0065y\":1,"
+            "\"bad\":\"\\x\",\"empty\":\"\"}";
+    cJSON_Lazy *document = lazy_parse(text);
+    cJSON_Cursor root, item;
+    char buffer[32], small[4];
+    double number;
+
+    CHECK(document != NULL);
+    CHECK(cJSON_LazyRoot(document, &root));
+    CHECK(cJSON_CursorGetObjectItem(&root, "plain", &item) && cJSON_CursorGetString(&item, buffer, sizeof(buffer)));
+    CHECK(strcmp(buffer, "light") == 0);
+    CHECK(!cJSON_CursorGetString(&item, small, sizeof(small)));
+    CHECK(!cJSON_CursorGetString(&item, buffer, 0));
+
+    CHECK(cJSON_CursorGetObjectItem(&root, "escaped", &item) && cJSON_CursorGetString(&item, buffer, sizeof(buffer)));
+    CHECK(strcmp(buffer, "a\"b\\c\n\xC3\xA9\xF0\x9F\x92\xA1") == 0);
+    // a buffer that is too small for the raw string but fits the unescaped one
+    CHECK(cJSON_CursorGetString(&item, buffer, strlen(buffer) + 1));
+    CHECK(!cJSON_CursorGetString(&item, buffer, strlen(buffer)));
+
+    // escaped keys are compared unescaped
+    CHECK(cJSON_CursorGetObjectItem(&root, "key", &item) && cJSON_CursorGetNumber(&item, &number) && number == 1);
+    CHECK(!cJSON_CursorGetString(&item, buffer, sizeof(buffer)));
+
+    // escape sequences are only checked when the string is read
+    CHECK(cJSON_CursorGetObjectItem(&root, "bad", &item) && !cJSON_CursorGetString(&item, buffer, sizeof(buffer)));
+    CHECK(cJSON_CursorToItem(&item) == NULL);
+
+    CHECK(cJSON_CursorGetObjectItem(&root, "empty", &item) && cJSON_CursorGetString(&item, buffer, 1));
+    CHECK(buffer[0] == '\0');
+    cJSON_LazyDelete(document);
+}
+
+// rejected by cJSON_LazyParse and cJSON_TapeParse
+static const char *const malformed_documents[] = {
+    "", " ", "{", "}", "[1,]", "[,1]", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "{1:2}", "{\"a\" \"b\"}",
+    "[1 2]", "[tru]", "[nul]", "[01]", "[1.]", "[.5]", "[1e]", "[-]", "[+1]", "\"open", "[1]]", "[1] 2",
+    "{\"a\":1]", "[{]}", "[\"a\":1]",
+};
+
+static void test_lazy_malformed(void) {
+    for (size_t i = 0; i < sizeof(malformed_documents) / sizeof(malformed_documents[0]); i++) {
+        cJSON_Lazy *document = lazy_parse(malformed_documents[i]);
+        if (document != NULL) {
+            fprintf(stderr, "accepted %s\n", malformed_documents[i]);
+            cJSON_LazyDelete(document);
+        }
+        CHECK(document == NULL);
+    }
+    CHECK(cJSON_LazyParse(NULL, 1) == NULL);
+    cJSON_LazyDelete(NULL);
+}
+
+// ---------------- TAPE PARSING -------------
+static cJSON_Tape *tape_parse(const char *text) {
+    return cJSON_TapeParse(text, strlen(text));
+}
+
+// the value at position as a regular item, through the public tape functions
+static cJSON *tape_to_item(const cJSON_Tape *tape, size_t position) {
+    double number;
+
+    switch (cJSON_TapeType(tape, position)) {
+        case cJSON_Object:
+        case cJSON_Array: {
+            bool object = cJSON_TapeType(tape, position) == cJSON_Object;
+            cJSON *container = object ? cJSON_CreateObject() : cJSON_CreateArray();
+            for (size_t element = position + 1; cJSON_TapeType(tape, element) != cJSON_Invalid;
+                    element = cJSON_TapeNext(tape, element)) {
+                const char *key = object ? cJSON_TapeGetString(tape, element++, NULL) : NULL;
+                cJSON *item = tape_to_item(tape, element);
+                if (item == NULL) {
+                    cJSON_Delete(container);
+                    return NULL;
+                }
+                if (object) {
+                    cJSON_AddItemToObject(container, key, item);
+                }
+                else {
+                    cJSON_AddItemToArray(container, item);
+                }
+            }
+            return container;
+        }
+        case cJSON_String:
+            return cJSON_CreateString(cJSON_TapeGetString(tape, position, NULL));
+        case cJSON_Number:
+            return cJSON_TapeGetNumber(tape, position, &number) ? cJSON_CreateNumber(number) : NULL;
+        case cJSON_True:
+            return cJSON_CreateTrue();
+        case cJSON_False:
+            return cJSON_CreateFalse();
+        case cJSON_NULL:
+            return cJSON_CreateNull();
+        default:
+            return NULL;
+    }
+}
+
+// the tape holds the same values as a full parse
+static bool tape_matches_parse(const char *text) {
+    cJSON_Tape *tape = tape_parse(text);
+    cJSON *expected = cJSON_Parse(text);
+    cJSON *item = tape_to_item(tape, 0);
+    bool equal = tape != NULL && expected != NULL && cJSON_Compare(item, expected, true)
+            && cJSON_TapeNext(tape, 0) == tape->count;
+
+    if (!equal) {
+        fprintf(stderr, "tape differs for %s\n", text);
+    }
+    cJSON_Delete(item);
+    cJSON_Delete(expected);
+    cJSON_TapeDelete(tape);
+    return equal;
+}
+
+static void test_tape_navigation(void) {
+    const char *text = " {\"alarm\":{\"hour\":6,\"minute\":45,\"enabled\":true},\"days\":[1,[2,[3]],{\"x\":null},-2.5e1],"
+            "\"empty\":[],\"none\":{},\"off\":false,\"label\":\"wake \\\"up\\\"\\u00e9\"} ";
+    cJSON_Tape *tape = tape_parse(text);
+    size_t alarm, item, length;
+    double number;
+
+    CHECK(tape != NULL && cJSON_TapeType(tape, 0) == cJSON_Object);
+    CHECK(cJSON_TapeGetObjectItem(tape, 0, "alarm", &alarm) && cJSON_TapeType(tape, alarm) == cJSON_Object);
+    CHECK(cJSON_TapeGetObjectItem(tape, alarm, "minute", &item) && cJSON_TapeGetNumber(tape, item, &number));
+    CHECK(number == 45);
+    CHECK(cJSON_TapeGetObjectItem(tape, alarm, "enabled", &item) && cJSON_TapeType(tape, item) == cJSON_True);
+    CHECK(cJSON_TapeGetObjectItem(tape, 0, "off", &item) && cJSON_TapeType(tape, item) == cJSON_False);
+    // case sensitive, keys inside nested objects aren't members, and getters of the wrong type
+    CHECK(!cJSON_TapeGetObjectItem(tape, 0, "Alarm", &item) && !cJSON_TapeGetObjectItem(tape, 0, "hour", &item));
+    CHECK(!cJSON_TapeGetNumber(tape, alarm, &number) && cJSON_TapeGetString(tape, alarm, NULL) == NULL);
+    CHECK(!cJSON_TapeGetObjectItem(tape, item, "x", &item));
+
+    // the elements of days, the nested containers are stepped over
+    static const int types[] = { cJSON_Number, cJSON_Array, cJSON_Object, cJSON_Number };
+    int count = 0;
+    CHECK(cJSON_TapeGetObjectItem(tape, 0, "days", &item) && cJSON_TapeType(tape, item) == cJSON_Array);
+    for (item = item + 1; cJSON_TapeType(tape, item) != cJSON_Invalid && count < 4; item = cJSON_TapeNext(tape, item)) {
+        CHECK(cJSON_TapeType(tape, item) == types[count]);
+        count++;
+        if (count == 4) {
+            CHECK(cJSON_TapeGetNumber(tape, item, &number) && number == -25);
+        }
+    }
+    CHECK(count == 4 && cJSON_TapeType(tape, item) == cJSON_Invalid);
+
+    CHECK(cJSON_TapeGetObjectItem(tape, 0, "empty", &item) && cJSON_TapeType(tape, item + 1) == cJSON_Invalid);
+    CHECK(cJSON_TapeGetObjectItem(tape, 0, "label", &item));
+    CHECK(strcmp(cJSON_TapeGetString(tape, item, &length), "wake \"up\"\xC3\xA9") == 0 && length == 11);
+    CHECK(cJSON_TapeNext(tape, 0) == tape->count && cJSON_TapeType(tape, tape->count) == cJSON_Invalid);
+    cJSON_TapeDelete(tape);
+
+    CHECK(tape_matches_parse(text));
+    CHECK(tape_matches_parse("42") && tape_matches_parse("\"\"") && tape_matches_parse("[[],{},[[{}]]]"));
+    CHECK(tape_matches_parse("\xEF\xBB\xBF{\"bom\":null}\n"));
+}
+
+// numbers are converted without strtod where that is exact, the result has to be the same to the bit
+static void test_tape_numbers(void) {
+    static const char *const numbers[] = {
+        "0", "-0", "7", "-45", "2.5", "0.1", "-0.3", "3.14159", "1e22", "1e23", "1E-7", "2.5e+3", "0.000001",
+        "9007199254740992", "9007199254740993", "18446744073709551615", "123456789012345678901234567890",
+        "1.7976931348623157e308", "2.2250738585072014e-308", "4.9e-324", "1e400", "-1e400", "1e-400", "0e99999",
+        "0.30000000000000004", "12345678901234567", "1234567.8901234567", "123e-20", "-9.5367431640625e-7",
+    };
+    char text[64];
+
+    for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+        snprintf(text, sizeof(text), "[%s]", numbers[i]);
+        cJSON_Tape *tape = tape_parse(text);
+        double number = 0, expected = strtod(numbers[i], NULL);
+        bool same = tape != NULL && cJSON_TapeGetNumber(tape, 1, &number) && memcmp(&number, &expected, sizeof(number)) == 0;
+        if (!same) {
+            fprintf(stderr, "%s: %.17g, expected %.17g\n", numbers[i], number, expected);
+        }
+        cJSON_TapeDelete(tape);
+        CHECK(same);
+    }
+}
+
+static void test_tape_malformed(void) {
+    // unlike cJSON_LazyParse, the tape decodes every string, so bad escapes are found too
+    static const char *const malformed[] = { "[\"\\x\"]", "[\"\\u12\"]", "[1.5.3]", "[truex]", "[-01]", "[1e5e5]" };
+
+    for (size_t i = 0; i < sizeof(malformed_documents) / sizeof(malformed_documents[0]); i++) {
+        CHECK(tape_parse(malformed_documents[i]) == NULL);
+    }
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        CHECK(tape_parse(malformed[i]) == NULL);
+    }
+    CHECK(cJSON_TapeParse(NULL, 1) == NULL);
+    cJSON_TapeDelete(NULL);
+}
+
+// ---------------- NDJSON SHARDS -------------
+typedef struct {
+    pthread_mutex_t lock;
+    long sum;
+    size_t records;
+    bool ranges_ok;
+    const char *content;
+} shard_totals_t;
+
+static void sum_record(const cJSON *record, size_t start, size_t end, void *context) {
+    shard_totals_t *totals = context;
+    const cJSON *value = cJSON_GetObjectItem(record, "v");
+
+    pthread_mutex_lock(&totals->lock);
+    totals->sum += (value != NULL) ? value->valueint : 0;
+    totals->records++;
+    totals->ranges_ok &= totals->content[start] == '{' && totals->content[end - 1] == '}';
+    pthread_mutex_unlock(&totals->lock);
+}
+
+static void test_ndjson_sharded(void) {
+    size_t capacity = 1000 * 32, length = 0;
+    char *content = malloc(capacity);
+    long expected = 0;
+    CHECK(content != NULL);
+
+    // records of different lengths so the shard boundaries land inside them, and one that doesn't parse
+    for (int i = 0; i < 1000; i++) {
+        if (i == 500) {
+            length += (size_t)snprintf(content + length, capacity - length, "{\"v\":}\n");
+            continue;
+        }
+        length += (size_t)snprintf(content + length, capacity - length, "{\"v\":%d%s}\n", i, (i % 3) ? ",\"x\":[]" : "");
+        expected += i;
+    }
+
+    static const int thread_counts[] = { 1, 2, 3, 8, 64 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); t++) {
+        shard_totals_t totals = { .lock = PTHREAD_MUTEX_INITIALIZER, .ranges_ok = true, .content = content };
+        ndjson_shard_result_t result;
+
+        CHECK(ndjson_parse_sharded(content, length, thread_counts[t], 0, sum_record, &totals, &result));
+        CHECK(result.records == 999 && result.errors == 1);
+        CHECK(totals.records == 999 && totals.sum == expected && totals.ranges_ok);
+    }
+
+    // more threads than records, and no input at all
+    ndjson_shard_result_t result;
+    shard_totals_t totals = { .lock = PTHREAD_MUTEX_INITIALIZER, .ranges_ok = true, .content = "{\"v\":1}" };
+    CHECK(ndjson_parse_sharded(totals.content, 7, 4, 0, sum_record, &totals, &result));
+    CHECK(result.records == 1 && totals.sum == 1);
+    CHECK(ndjson_parse_sharded("", 0, 4, 0, sum_record, &totals, &result) && result.records == 0);
+    free(content);
+}
+
+// ---------------- STRUCTURAL INDEX -------------
+// cJSON_LazyParse indexes 16 bytes at a time with SSE2 (json_test_scalar runs the same checks byte by byte), so
+// every document is tried at all offsets in a block: escapes, quotes and brackets in strings must not be indexed.
+static void test_structural_index(void) {
+    const char *document = "{\"a\\\"[{,:}]\\\\\":\"x\\\\\",\"b\":[1,{\"c\":\"]\\\"\"},true],\"d\":\"\\\\\"}";
+    const char *malformed[] = { "{\"a\":1\\}", "{\"a\":\"x}", "[1,2", "{\"a\" 1}", "[1 2]" };
+    char text[128];
+
+    cJSON *expected = cJSON_Parse(document);
+    CHECK(expected != NULL);
+    char *expected_text = cJSON_PrintUnformatted(expected);
+    cJSON_Delete(expected);
+    CHECK(expected_text != NULL);
+
+    for (int padding = 0; padding < 34; padding++) {
+        int length = snprintf(text, sizeof(text), "%*s%s", padding, "", document);
+        cJSON_Lazy *lazy = cJSON_LazyParse(text, (size_t)length);
+        CHECK(lazy != NULL);
+        cJSON_Cursor root;
+        CHECK(cJSON_LazyRoot(lazy, &root));
+        cJSON *item = cJSON_CursorToItem(&root);
+        cJSON_LazyDelete(lazy);
+        CHECK_PRINTS(item, expected_text);
+        cJSON_Delete(item);
+        CHECK(tape_matches_parse(text));
+
+        for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+            length = snprintf(text, sizeof(text), "%*s%s", padding, "", malformed[i]);
+            CHECK(cJSON_LazyParse(text, (size_t)length) == NULL);
+            CHECK(cJSON_TapeParse(text, (size_t)length) == NULL);
+        }
+    }
+    cJSON_free(expected_text);
+}
+
+// ---------------- UTF-8 VALIDATION -------------
+// the invalid byte sequences are placed at every offset in a word, the scan skips plain ASCII a word at a time
+static void test_utf8_validation(void) {
+    static const char *const valid[] = {
+        "\x7F", "\xC2\x80", "\xDF\xBF", "\xE0\xA0\x80", "\xED\x9F\xBF", "\xEE\x80\x80", "\xEF\xBF\xBF",
+        "\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF", "gr\xC3\xBC\xC3\x9F \xE2\x82\xAC \xF0\x9F\x92\xA1",
+    };
+    static const char *const invalid[] = {
+        "\x80", "\xBF",                                         // continuation byte without a lead byte
+        "\xC0\x80", "\xC1\xBF", "\xE0\x9F\xBF", "\xF0\x8F\xBF\xBF", // overlong
+        "\xED\xA0\x80", "\xED\xBF\xBF",                         // surrogates
+        "\xF4\x90\x80\x80", "\xF5\x80\x80\x80", "\xFF",         // above U+10FFFF
+        "\xC3", "\xE2\x82", "\xF0\x9F\x92", "\xE2\x28\xA1",     // cut short
+    };
+    char text[64];
+
+    for (int padding = 0; padding < 9; padding++) {
+        for (size_t i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+            int length = snprintf(text, sizeof(text), "[\"%.*s%s\"]", padding, "abcdefgh", valid[i]);
+            cJSON *array = cJSON_ParseWithLengthHints(text, (size_t)length, cJSON_ValidateUTF8);
+            CHECK(array != NULL);
+            CHECK(strcmp(cJSON_GetArrayItem(array, 0)->valuestring + padding, valid[i]) == 0);
+            cJSON_Delete(array);
+        }
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+            int length = snprintf(text, sizeof(text), "[\"%.*s%s\"]", padding, "abcdefgh", invalid[i]);
+            CHECK(cJSON_ParseWithLengthHints(text, (size_t)length, cJSON_ValidateUTF8) == NULL);
+            // the error points at the sequence
+            CHECK(cJSON_GetErrorPtr() == text + 2 + padding);
+
+            // without the hint the bytes are taken as they are
+            cJSON *array = cJSON_ParseWithLengthHints(text, (size_t)length, 0);
+            CHECK(array != NULL);
+            cJSON_Delete(array);
+        }
+    }
+
+    // keys are checked too, and the hint combines with the packed ones
+    CHECK(parse("{\"\xC0\xAF\":1}", cJSON_ValidateUTF8) == NULL);
+    cJSON *object = parse("{\"\xC3\xBC\":[1,2],\"t\":\"\\u00fc\\\"\"}", cJSON_ValidateUTF8 | cJSON_PackedInt);
+    CHECK(object != NULL);
+    CHECK(cJSON_IsPackedArray(cJSON_GetObjectItemCaseSensitive(object, "\xC3\xBC")));
+    CHECK(strcmp(cJSON_GetObjectItemCaseSensitive(object, "t")->valuestring, "\xC3\xBC\"") == 0);
+    cJSON_Delete(object);
+
+    // a backslash at the end of the input
+    CHECK(cJSON_ParseWithLengthHints("[\"ab\\", 5, cJSON_ValidateUTF8) == NULL);
+}
+
+// ---------------- PRINTING -------------
+static void test_print_escapes(void) {
+    char all[128], expected[512];
+    size_t length = 0;
+
+    // every byte from 0x01 to 0x7F, in the order of the table in print_string_ptr
+    for (int c = 1; c < 128; c++) {
+        all[c - 1] = (char)c;
+    }
+    all[127] = '\0';
+    expected[length++] = '"';
+    for (int c = 1; c < 128; c++) {
+        const char *escape = (c == '"') ? "\\\"" : (c == '\\') ? "\\\\" : (c == '\b') ? "\\b" : (c == '\f') ? "\\f"
+                : (c == '\n') ? "\\n" : (c == '\r') ? "\\r" : (c == '\t') ? "\\t" : NULL;
+        if (escape != NULL) {
+            length += (size_t)sprintf(expected + length, "%s", escape);
+        }
+        else if (c < 0x20) {
+            length += (size_t)sprintf(expected + length, "\\u%04x", c);
+        }
+        else {
+            expected[length++] = (char)c;
+        }
+    }
+    expected[length++] = '"';
+    expected[length] = '\0';
+
+    cJSON *string = cJSON_CreateString(all);
+    CHECK(string != NULL);
+    CHECK_PRINTS(string, expected);
+    cJSON_Delete(string);
+
+    // UTF-8 and '/' are copied as they are, escapes between runs of safe bytes and at both ends
+    string = cJSON_CreateString("\x1f" "caf\xC3\xA9/\"x\"\\n\x7F\xE2\x82\xAC\n");
+    CHECK(string != NULL);
+    CHECK_PRINTS(string, "\"\\u001fcaf\xC3\xA9/\\\"x\\\"\\\\n\x7F\xE2\x82\xAC\\n\"");
+    cJSON_Delete(string);
+
+    // keys go through the same code
+    cJSON *object = cJSON_CreateObject();
+    CHECK(object != NULL);
+    cJSON_AddStringToObject(object, "a\tb\"", "");
+    CHECK_PRINTS(object, "{\"a\\tb\\\"\":\"\"}");
+
+    // and parse back to what was printed from
+    char *printed = cJSON_PrintUnformatted(object);
+    cJSON *parsed = cJSON_Parse(printed);
+    cJSON_free(printed);
+    CHECK(parsed != NULL);
+    CHECK(cJSON_Compare(parsed, object, true));
+    cJSON_Delete(parsed);
+    cJSON_Delete(object);
+}
+
+static void test_print_formatted(void) {
+    cJSON *root = parse("{\"alarm\":{\"hour\":6,\"days\":[1,2,{\"skip\":true}],\"empty\":{}},\"name\":\"x\",\"list\":[]}", 0);
+    CHECK(root != NULL);
+
+    char *printed = cJSON_Print(root);
+    CHECK(printed != NULL);
+    bool equal = strcmp(printed,
+            "{\n"
+            "\t\"alarm\":\t{\n"
+            "\t\t\"hour\":\t6,\n"
+            "\t\t\"days\":\t[1, 2, {\n"
+            "\t\t\t\t\"skip\":\ttrue\n"
+            "\t\t\t}],\n"
+            "\t\t\"empty\":\t{\n"
+            "\t\t}\n"
+            "\t},\n"
+            "\t\"name\":\t\"x\",\n"
+            "\t\"list\":\t[]\n"
+            "}") == 0;
+    if (!equal) {
+        fprintf(stderr, "printed:\n%s\n", printed);
+    }
+    cJSON_free(printed);
+    cJSON_Delete(root);
+    CHECK(equal);
+}
+
+// ---------------- GENERATED BINDINGS -------------
+static esp_err_t parse_alarm(const char *text, alarm_config_t *config) {
+    return alarm_config_parse(text, strlen(text), config);
+}
+
+static void test_bind_alarm_config(void) {
+    alarm_config_t config;
+    char buffer[64];
+    size_t length;
+
+    CHECK(parse_alarm("{\"alarm\":{\"enabled\":true,\"hour\":6,\"minute\":45}}", &config) == ESP_OK);
+    CHECK(config.enabled && config.hour == 6 && config.minute == 45);
+
+    // unknown keys and values of any type are skipped, the order doesn't matter
+    CHECK(parse_alarm(" {\"v\":[1,{\"x\":\"}\"}],\"alarm\":{\"minute\":0,\"note\":null,\"hour\":23,\"enabled\":false}} ",
+            &config) == ESP_OK);
+    CHECK(!config.enabled && config.hour == 23 && config.minute == 0);
+
+    // keys match like with cJSON_GetObjectItem: case is ignored and the first of duplicates counts, also for objects
+    CHECK(parse_alarm("{\"Alarm\":{\"ENABLED\":true,\"Hour\":7,\"hour\":8,\"minute\":5,\"MINUTE\":99},"
+            "\"alarm\":{\"hour\":9}}", &config) == ESP_OK);
+    CHECK(config.enabled && config.hour == 7 && config.minute == 5);
+    cJSON *tree = cJSON_Parse("{\"Alarm\":{\"Hour\":7,\"hour\":8}}");
+    CHECK(tree != NULL);
+    int cjson_hour = cJSON_GetObjectItem(cJSON_GetObjectItem(tree, "alarm"), "hour")->valueint;
+    cJSON_Delete(tree);
+    CHECK(cjson_hour == 7);
+
+    // config is left alone on errors
+    CHECK(parse_alarm("{\"alarm\":{\"enabled\":true,\"hour\":6}}", &config) == ESP_ERR_NOT_FOUND);
+    CHECK(parse_alarm("{\"alarm\":{\"enabled\":true,\"hour\":24,\"minute\":0}}", &config) == ESP_ERR_INVALID_ARG);
+    CHECK(parse_alarm("{\"alarm\":{\"enabled\":true,\"hour\":-1,\"minute\":0}}", &config) == ESP_ERR_INVALID_ARG);
+    CHECK(parse_alarm("{\"alarm\":{\"enabled\":1,\"hour\":6,\"minute\":0}}", &config) == ESP_FAIL);
+    CHECK(parse_alarm("{\"alarm\":{\"enabled\":true,\"hour\":6.5,\"minute\":0}}", &config) == ESP_FAIL);
+    CHECK(parse_alarm("{\"alarm\":{\"enabled\":true,\"hour\":6,\"minute\":0}", &config) == ESP_FAIL);
+    CHECK(parse_alarm("{\"alarm\":{\"enabled\":true,\"hour\":6,\"minute\":0}} x", &config) == ESP_FAIL);
+    CHECK(parse_alarm("", &config) == ESP_FAIL);
+    CHECK(config.enabled && config.hour == 7 && config.minute == 5);
+
+    CHECK(alarm_config_serialize(&config, buffer, sizeof(buffer), &length) == ESP_OK);
+    CHECK(strcmp(buffer, "{\"alarm\":{\"enabled\":true,\"hour\":7,\"minute\":5}}") == 0 && length == strlen(buffer));
+    CHECK(alarm_config_serialize(&config, buffer, 10, &length) == ESP_ERR_INVALID_SIZE);
+    CHECK(length == strlen("{\"alarm\":{\"enabled\":true,\"hour\":7,\"minute\":5}}"));
+}
+
+// bind_test.json has paths that only differ in where the '_' is, a key that isn't a C identifier, a string and
+// an optional double with a range
+static void test_bind_generated_names(void) {
+    bind_test_t config, parsed;
+    char buffer[128];
+    size_t length;
+
+    const char *text = "{\"a\":{\"b_c\":2,\"label\":\"caf\\u00e9\"},\"a_b\":{\"c\":1},\"odd key-\xC3\xA9\":{\"ON\":true}}";
+    CHECK(bind_test_parse(text, strlen(text), &config) == ESP_OK);
+    CHECK(config.a_b_c == 1 && config.a_b_c2 == 2 && config.on && config.level == 0);
+    CHECK(strcmp(config.label, "caf\xC3\xA9") == 0);
+
+    // serialize and parse back
+    config.level = 0.25;
+    CHECK(bind_test_serialize(&config, buffer, sizeof(buffer), &length) == ESP_OK);
+    CHECK(bind_test_parse(buffer, length, &parsed) == ESP_OK);
+    CHECK(parsed.a_b_c == 1 && parsed.a_b_c2 == 2 && parsed.on && parsed.level == 0.25);
+    CHECK(strcmp(parsed.label, config.label) == 0);
+
+    // the range of an optional field is only checked when it is there, strings have to fit
+    text = "{\"a\":{\"b_c\":2,\"level\":1.5},\"a_b\":{\"c\":1}}";
+    CHECK(bind_test_parse(text, strlen(text), &parsed) == ESP_ERR_INVALID_ARG);
+    text = "{\"a\":{\"b_c\":2,\"label\":\"12345678\"},\"a_b\":{\"c\":1}}";
+    CHECK(bind_test_parse(text, strlen(text), &parsed) == ESP_FAIL);
+    text = "{\"a\":{\"b_c\":2},\"a_b\":{\"c\":1}}";
+    CHECK(bind_test_parse(text, strlen(text), &parsed) == ESP_OK);
+    CHECK(parsed.label[0] == '\0' && !parsed.on);
+}
+
+static const json_test_t tests[] = {
+    { "packed_create", test_packed_create },
+    { "packed_parse", test_packed_parse },
+    { "packed_duplicate_compare", test_packed_duplicate_compare },
+    { "case_insensitive_lookup", test_case_insensitive_lookup },
+    { "case_insensitive_by_name", test_case_insensitive_by_name },
+    { "stream_records", test_stream_records },
+    { "stream_chunks", test_stream_chunks },
+    { "stream_pool_reuse", test_stream_pool_reuse },
+    { "pool_classes", test_pool_classes },
+    { "pool_tree", test_pool_tree },
+    { "pool_init", test_pool_init },
+    { "lazy_navigation", test_lazy_navigation },
+    { "lazy_strings", test_lazy_strings },
+    { "lazy_malformed", test_lazy_malformed },
+    { "tape_navigation", test_tape_navigation },
+    { "tape_numbers", test_tape_numbers },
+    { "tape_malformed", test_tape_malformed },
+    { "ndjson_sharded", test_ndjson_sharded },
+    { "structural_index", test_structural_index },
+    { "utf8_validation", test_utf8_validation },
+    { "print_escapes", test_print_escapes },
+    { "print_formatted", test_print_formatted },
+    { "bind_alarm_config", test_bind_alarm_config },
+    { "bind_generated_names", test_bind_generated_names },
+};
+
+int main(int argc, char **argv) {
+    int failed = 0, run = 0;
+
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+        bool selected = (argc < 2);
+        for (int arg = 1; arg < argc && !selected; arg++) {
+            selected = strcmp(argv[arg], tests[i].name) == 0;
+        }
+        if (!selected) {
+            continue;
+        }
+
+        test_failed = false;
+        live_allocations = 0;
+        install_counting_hooks();
+        tests[i].run();
+        if (!test_failed && live_allocations != 0) {
+            fprintf(stderr, "%s: %zu allocations not freed\n", tests[i].name, live_allocations);
+            test_failed = true;
+        }
+        printf("%-32s %s\n", tests[i].name, test_failed ? "FAILED" : "ok");
+        failed += test_failed;
+        run++;
+    }
+    printf("%d of %d tests failed\n", failed, run);
+    return (failed > 0 || run == 0) ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ndjson_shard.h"
+
+typedef struct {
+    const char *content;
+    size_t offset;      // of the shard in the whole input
+    size_t length;
+    int hints;
+    ndjson_record_cb_t callback;
+    void *context;
+    ndjson_shard_result_t result;
+    pthread_t thread;
+    bool started;
+} ndjson_shard_t;
+
+// ---------------- PRIVATE FUNCTIONS -------------
+/**
+ * @brief the start of the first record at or after position: right after the next newline
+ */
+static size_t record_boundary(const char *content, size_t length, size_t position) {
+    if (position == 0 || position >= length) {
+        return (position == 0) ? 0 : length;
+    }
+    if (content[position - 1] == '\n') {
+        return position;
+    }
+    const char *newline = memchr(content + position, '\n', length - position);
+    return (newline != NULL) ? (size_t)(newline - content) + 1 : length;
+}
+
+static void *parse_shard(void *argument) {
+    ndjson_shard_t *shard = argument;
+    cJSON_Stream stream;
+    size_t start, end;
+
+    cJSON_InitStream(&stream, shard->content + shard->offset, shard->length, true);
+    stream.hints = shard->hints;
+    for (;;) {
+        cJSON *record = cJSON_ParseStreamNext(&stream, &start, &end);
+        if (record != NULL) {
+            shard->callback(record, shard->offset + start, shard->offset + end, shard->context);
+            cJSON_Delete(record);
+            shard->result.records++;
+        }
+        else if (stream.status == cJSON_StreamError) {
+            shard->result.errors++;
+        }
+        else {
+            break;
+        }
+    }
+    return NULL;
+}
+
+// ---------------- PUBLIC FUNCTIONS -------------
+bool ndjson_parse_sharded(const char *content, size_t length, int threads, int hints, ndjson_record_cb_t callback,
+        void *context, ndjson_shard_result_t *result) {
+    bool started_all = true;
+
+    memset(result, 0, sizeof(*result));
+    if (threads < 1) {
+        threads = 1;
+    }
+    ndjson_shard_t *shards = calloc((size_t)threads, sizeof(ndjson_shard_t));
+    if (shards == NULL) {
+        return false;
+    }
+
+    // equal parts, each moved to the start of the next record; a shard can end up empty if records are long
+    size_t offset = 0;
+    for (int i = 0; i < threads; i++) {
+        size_t next = (i + 1 == threads) ? length : record_boundary(content, length, length / threads * (i + 1));
+        if (next < offset) {
+            next = offset;
+        }
+        shards[i] = (ndjson_shard_t) {
+            .content = content,
+            .offset = offset,
+            .length = next - offset,
+            .hints = hints,
+            .callback = callback,
+            .context = context,
+        };
+        offset = next;
+    }
+
+    if (threads == 1) {
+        parse_shard(&shards[0]);
+    }
+    else {
+        for (int i = 0; i < threads; i++) {
+            shards[i].started = pthread_create(&shards[i].thread, NULL, parse_shard, &shards[i]) == 0;
+            started_all &= shards[i].started;
+        }
+        for (int i = 0; i < threads; i++) {
+            if (shards[i].started) {
+                pthread_join(shards[i].thread, NULL);
+            }
+        }
+    }
+
+    for (int i = 0; i < threads; i++) {
+        result->records += shards[i].result.records;
+        result->errors += shards[i].result.errors;
+    }
+    free(shards);
+    return started_all;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "cJSON.h"
+
+// Host only: parses newline delimited JSON on several threads, for tools that go through recorded event logs and
+// telemetry. The input is split into one shard per thread at record boundaries, and every thread runs its own
+// cJSON_Stream over its shard. cJSON's hooks are process-wide, so the records come from malloc (a json_pool is
+// for one task at a time).
+
+// Gets every record that parsed, with its byte range in the whole input. The record is deleted when the callback
+// returns. Called from the worker threads at the same time, in no particular order.
+typedef void (*ndjson_record_cb_t)(const cJSON *record, size_t start, size_t end, void *context);
+
+typedef struct {
+    size_t records;     // parsed and passed to the callback
+    size_t errors;      // records that didn't parse, skipped like cJSON_ParseStreamNext does
+} ndjson_shard_result_t;
+
+// Parses content with up to threads threads (1 parses in the calling thread) and the cJSON_Parse* hints.
+// Returns false if a thread couldn't be started, result then only covers the shards that were parsed.
+bool ndjson_parse_sharded(const char *content, size_t length, int threads, int hints, ndjson_record_cb_t callback,
+        void *context, ndjson_shard_result_t *result);
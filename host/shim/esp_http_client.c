@@ -0,0 +1,768 @@
+// Host build: esp_http_client over POSIX sockets and OpenSSL, for running components/http.c against a local server.
+// Only the calls http.c makes are implemented. Where it matters to the caller this behaves like ESP-IDF's client:
+//  - esp_http_client_open() connects (or reuses the kept-alive connection to the same host) and sends the headers
+//  - ON_CONNECTED fires after TCP connect + TLS handshake, ON_HEADER for every response header
+//  - esp_http_client_read() takes the chunk framing off and fills the buffer unless the body ends first
+//  - the request carries only the headers the client holds: Host is one of them, set by esp_http_client_init and
+//    again by esp_http_client_set_url only when the host changes
+// Certificates are checked against HTTP_SHIM_CA_FILE if that is set, otherwise not at all (a local test server).
+
+#define _GNU_SOURCE  // strcasestr
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include "esp_http_client.h"
+#include "esp_log.h"
+
+#define SHIM_HOST_MAX_LEN       256
+#define SHIM_PATH_MAX_LEN       1024
+#define SHIM_LINE_MAX_LEN       2048
+#define SHIM_INPUT_BUFFER_SIZE  4096
+#define SHIM_DEFAULT_TIMEOUT_MS 5000
+
+static const char *TAG = "http_shim";
+
+typedef struct shim_header {
+    char *key;
+    char *value;
+    struct shim_header *next;
+} shim_header_t;
+
+typedef struct {
+    bool https;
+    char host[SHIM_HOST_MAX_LEN];
+    int port;
+    char path[SHIM_PATH_MAX_LEN];   // with the query
+} shim_url_t;
+
+struct esp_http_client {
+    esp_http_client_config_t config;
+    shim_url_t url;
+    esp_http_client_method_t method;
+    shim_header_t *headers;
+
+    // connection
+    int fd;                     // -1 while not connected
+    shim_url_t connected_to;    // scheme, host and port of the open connection
+    SSL_CTX *ssl_ctx;
+    SSL *ssl;
+    char input[SHIM_INPUT_BUFFER_SIZE];     // received but not yet parsed
+    size_t input_start, input_end;
+
+    // current response
+    int status;
+    int64_t content_length;     // -1 if not given
+    bool chunked;
+    bool server_closes;         // Connection: close, or a body that ends with the connection
+    char location[SHIM_PATH_MAX_LEN];
+    int64_t body_received;
+    int64_t chunk_remaining;    // of the current chunk, 0 between chunks
+    bool first_chunk;
+    bool body_done;
+};
+
+// ---------------- PRIVATE FUNCTIONS -------------
+static void dispatch_event(esp_http_client_handle_t client, esp_http_client_event_id_t event_id, void *data, int data_len,
+        char *header_key, char *header_value) {
+    esp_http_client_event_t event = {
+        .event_id = event_id,
+        .client = client,
+        .data = data,
+        .data_len = data_len,
+        .user_data = client->config.user_data,
+        .header_key = header_key,
+        .header_value = header_value,
+    };
+
+    if (client->config.event_handler != NULL) {
+        client->config.event_handler(&event);
+    }
+}
+
+/**
+ * @brief splits an absolute http(s) URL. Returns false for anything else
+ */
+static bool parse_url(const char *url, shim_url_t *parsed) {
+    const char *host, *host_end, *port;
+    size_t length;
+
+    memset(parsed, 0, sizeof(*parsed));
+    if (strncasecmp(url, "https://", 8) == 0) {
+        parsed->https = true;
+        parsed->port = 443;
+        host = url + 8;
+    }
+    else if (strncasecmp(url, "http://", 7) == 0) {
+        parsed->port = 80;
+        host = url + 7;
+    }
+    else {
+        return false;
+    }
+
+    host_end = host + strcspn(host, ":/?#");
+    length = host_end - host;
+    if (length == 0 || length >= sizeof(parsed->host)) {
+        return false;
+    }
+    memcpy(parsed->host, host, length);
+
+    port = host_end;
+    if (*port == ':') {
+        char *end;
+        long number = strtol(port + 1, &end, 10);
+        if (end == port + 1 || number <= 0 || number > 65535) {
+            return false;
+        }
+        parsed->port = (int)number;
+        port = end;
+    }
+
+    length = strcspn(port, "#");
+    if (length == 0 || *port == '?') {
+        // no path, the request goes to /
+        if (length + 2 > sizeof(parsed->path)) {
+            return false;
+        }
+        snprintf(parsed->path, sizeof(parsed->path), "/%.*s", (int)length, port);
+    }
+    else {
+        if (length >= sizeof(parsed->path)) {
+            return false;
+        }
+        memcpy(parsed->path, port, length);
+    }
+    return true;
+}
+
+static bool same_origin(const shim_url_t *a, const shim_url_t *b) {
+    return a->https == b->https && a->port == b->port && strcasecmp(a->host, b->host) == 0;
+}
+
+/**
+ * @brief strdup through malloc, which the bench counts (libc's strdup doesn't go through the wrapped malloc)
+ */
+static char *copy_string(const char *text) {
+    size_t size = strlen(text) + 1;
+    char *copy = malloc(size);
+    if (copy != NULL) {
+        memcpy(copy, text, size);
+    }
+    return copy;
+}
+
+static shim_header_t *find_header(esp_http_client_handle_t client, const char *key) {
+    for (shim_header_t *header = client->headers; header != NULL; header = header->next) {
+        if (strcasecmp(header->key, key) == 0) {
+            return header;
+        }
+    }
+    return NULL;
+}
+
+static void disconnect(esp_http_client_handle_t client) {
+    if (client->fd < 0) {
+        return;
+    }
+    if (client->ssl != NULL) {
+        // a quiet shutdown sends nothing, the server may already be gone
+        SSL_set_quiet_shutdown(client->ssl, 1);
+        SSL_shutdown(client->ssl);
+        SSL_free(client->ssl);
+        client->ssl = NULL;
+    }
+    close(client->fd);
+    client->fd = -1;
+    client->input_start = client->input_end = 0;
+    dispatch_event(client, HTTP_EVENT_DISCONNECTED, NULL, 0, NULL, NULL);
+}
+
+static esp_err_t start_tls(esp_http_client_handle_t client) {
+    // like ESP-IDF's client, a common_name is used for every connection, whatever host the URL points to
+    const char *server_name = (client->config.common_name != NULL) ? client->config.common_name : client->url.host;
+
+    if (client->ssl_ctx == NULL) {
+        const char *ca_file = getenv("HTTP_SHIM_CA_FILE");
+        client->ssl_ctx = SSL_CTX_new(TLS_client_method());
+        if (client->ssl_ctx == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+#ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+        // a server closing without close_notify ends a read-until-close body, as with mbedTLS
+        SSL_CTX_set_options(client->ssl_ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+#endif
+        if (ca_file != NULL && ca_file[0] != '\0') {
+            if (SSL_CTX_load_verify_locations(client->ssl_ctx, ca_file, NULL) != 1) {
+                ESP_LOGE(TAG, "Can't load the certificates in %s", ca_file);
+                SSL_CTX_free(client->ssl_ctx);
+                client->ssl_ctx = NULL;
+                return ESP_ERR_INVALID_ARG;
+            }
+            SSL_CTX_set_verify(client->ssl_ctx, SSL_VERIFY_PEER, NULL);
+        }
+        else {
+            ESP_LOGW(TAG, "HTTP_SHIM_CA_FILE not set, the server certificate isn't checked");
+            SSL_CTX_set_verify(client->ssl_ctx, SSL_VERIFY_NONE, NULL);
+        }
+    }
+
+    client->ssl = SSL_new(client->ssl_ctx);
+    if (client->ssl == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    SSL_set_fd(client->ssl, client->fd);
+    SSL_set_tlsext_host_name(client->ssl, server_name);
+    SSL_set1_host(client->ssl, server_name);
+    if (SSL_connect(client->ssl) != 1) {
+        unsigned long error = ERR_get_error();
+        ESP_LOGE(TAG, "TLS handshake with %s failed: %s", server_name, ERR_error_string(error, NULL));
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    ESP_LOGD(TAG, "%s", SSL_get_version(client->ssl));
+    return ESP_OK;
+}
+
+static void set_socket_timeout(esp_http_client_handle_t client) {
+    int timeout_ms = (client->config.timeout_ms > 0) ? client->config.timeout_ms : SHIM_DEFAULT_TIMEOUT_MS;
+    struct timeval timeout = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+
+    setsockopt(client->fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client->fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+static esp_err_t connect_to_server(esp_http_client_handle_t client) {
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *result, *address;
+    char port[8];
+    int one = 1;
+
+    snprintf(port, sizeof(port), "%d", client->url.port);
+    if (getaddrinfo(client->url.host, port, &hints, &result) != 0) {
+        ESP_LOGE(TAG, "Can't resolve %s", client->url.host);
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    for (address = result; address != NULL; address = address->ai_next) {
+        client->fd = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (client->fd < 0) {
+            continue;
+        }
+        set_socket_timeout(client);
+        if (connect(client->fd, address->ai_addr, address->ai_addrlen) == 0) {
+            break;
+        }
+        close(client->fd);
+        client->fd = -1;
+    }
+    freeaddrinfo(result);
+    if (client->fd < 0) {
+        ESP_LOGE(TAG, "Can't connect to %s:%d: %s", client->url.host, client->url.port, strerror(errno));
+        return ESP_ERR_HTTP_CONNECT;
+    }
+    // the headers go out in one write anyway, don't let Nagle hold back the body behind them
+    setsockopt(client->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (client->url.https) {
+        esp_err_t err = start_tls(client);
+        if (err != ESP_OK) {
+            SSL_free(client->ssl);
+            client->ssl = NULL;
+            close(client->fd);
+            client->fd = -1;
+            return err;
+        }
+    }
+    client->connected_to = client->url;
+    dispatch_event(client, HTTP_EVENT_ON_CONNECTED, NULL, 0, NULL, NULL);
+    return ESP_OK;
+}
+
+static int transport_read(esp_http_client_handle_t client, void *buffer, size_t size) {
+    if (client->ssl != NULL) {
+        int read_len = SSL_read(client->ssl, buffer, (int)size);
+        if (read_len > 0) {
+            return read_len;
+        }
+        int error = SSL_get_error(client->ssl, read_len);
+        return (error == SSL_ERROR_ZERO_RETURN || (error == SSL_ERROR_SYSCALL && errno == 0)) ? 0 : -1;
+    }
+    ssize_t read_len;
+    do {
+        read_len = recv(client->fd, buffer, size, 0);
+    } while (read_len < 0 && errno == EINTR);
+    return (int)read_len;
+}
+
+static bool transport_write(esp_http_client_handle_t client, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written;
+        if (client->ssl != NULL) {
+            written = SSL_write(client->ssl, data, (int)length);
+        }
+        else {
+            written = send(client->fd, data, length, MSG_NOSIGNAL);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+    return true;
+}
+
+/**
+ * @brief reads up to size body bytes, from what is buffered first. Returns 0 once the connection is closed
+ */
+static int input_read(esp_http_client_handle_t client, char *buffer, size_t size) {
+    size_t buffered = client->input_end - client->input_start;
+    if (buffered > 0) {
+        size_t length = (buffered < size) ? buffered : size;
+        memcpy(buffer, client->input + client->input_start, length);
+        client->input_start += length;
+        return (int)length;
+    }
+    return transport_read(client, buffer, size);
+}
+
+/**
+ * @brief reads one CRLF terminated line into line, without the CRLF. Returns false on a closed connection,
+ * an error or a line that doesn't fit
+ */
+static bool input_read_line(esp_http_client_handle_t client, char *line, size_t size) {
+    size_t length = 0;
+
+    for (;;) {
+        while (client->input_start < client->input_end) {
+            char c = client->input[client->input_start++];
+            if (c == '\n') {
+                if (length > 0 && line[length - 1] == '\r') {
+                    length--;
+                }
+                line[length] = '\0';
+                return true;
+            }
+            if (length + 1 >= size) {
+                return false;
+            }
+            line[length++] = c;
+        }
+        int read_len = transport_read(client, client->input, sizeof(client->input));
+        if (read_len <= 0) {
+            return false;
+        }
+        client->input_start = 0;
+        client->input_end = read_len;
+    }
+}
+
+static void reset_response(esp_http_client_handle_t client) {
+    client->status = 0;
+    client->content_length = -1;
+    client->chunked = false;
+    client->server_closes = false;
+    client->location[0] = '\0';
+    client->body_received = 0;
+    client->chunk_remaining = 0;
+    client->first_chunk = true;
+    client->body_done = false;
+}
+
+/**
+ * @brief takes the framing off the body. Returns the body bytes read, 0 at the end of it (or if the
+ * connection closed early, see body_done) and -1 on errors
+ */
+static int read_body_part(esp_http_client_handle_t client, char *buffer, size_t size) {
+    char line[SHIM_LINE_MAX_LEN];
+
+    if (client->body_done) {
+        return 0;
+    }
+    if (client->chunked) {
+        if (client->chunk_remaining == 0) {
+            // the CRLF after the previous chunk, then the size line of the next one
+            if ((!client->first_chunk && !input_read_line(client, line, sizeof(line))) ||
+                    !input_read_line(client, line, sizeof(line))) {
+                return 0;
+            }
+            client->first_chunk = false;
+            char *end;
+            client->chunk_remaining = strtoll(line, &end, 16);
+            if (end == line || client->chunk_remaining < 0) {
+                ESP_LOGE(TAG, "Bad chunk size line \"%s\"", line);
+                return -1;
+            }
+            if (client->chunk_remaining == 0) {
+                // trailers, up to an empty line
+                while (input_read_line(client, line, sizeof(line)) && line[0] != '\0') {
+                }
+                client->body_done = true;
+                return 0;
+            }
+        }
+        if ((int64_t)size > client->chunk_remaining) {
+            size = (size_t)client->chunk_remaining;
+        }
+        int read_len = input_read(client, buffer, size);
+        if (read_len > 0) {
+            client->chunk_remaining -= read_len;
+        }
+        return (read_len < 0) ? -1 : read_len;
+    }
+
+    if (client->content_length >= 0) {
+        int64_t remaining = client->content_length - client->body_received;
+        if (remaining == 0) {
+            client->body_done = true;
+            return 0;
+        }
+        if ((int64_t)size > remaining) {
+            size = (size_t)remaining;
+        }
+        return input_read(client, buffer, size);
+    }
+
+    // no length: the body ends with the connection
+    int read_len = input_read(client, buffer, size);
+    if (read_len == 0) {
+        client->body_done = true;
+    }
+    return read_len;
+}
+
+// ---------------- PUBLIC FUNCTIONS -------------
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config) {
+    esp_http_client_handle_t client = calloc(1, sizeof(*client));
+
+    if (client == NULL) {
+        return NULL;
+    }
+    client->config = *config;
+    client->method = config->method;
+    client->fd = -1;
+    reset_response(client);
+    if (config->url == NULL || !parse_url(config->url, &client->url)) {
+        ESP_LOGE(TAG, "Unsupported URL %s", (config->url != NULL) ? config->url : "(null)");
+        free(client);
+        return NULL;
+    }
+    char host[SHIM_HOST_MAX_LEN + 8];
+    bool default_port = client->url.port == (client->url.https ? 443 : 80);
+    snprintf(host, sizeof(host), default_port ? "%s" : "%s:%d", client->url.host, client->url.port);
+    esp_http_client_set_header(client, "Host", host);
+    esp_http_client_set_header(client, "User-Agent", "ESP32 HTTP Client/1.0");
+    return client;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client) {
+    if (client == NULL) {
+        return ESP_FAIL;
+    }
+    disconnect(client);
+    while (client->headers != NULL) {
+        shim_header_t *next = client->headers->next;
+        free(client->headers->key);
+        free(client->headers->value);
+        free(client->headers);
+        client->headers = next;
+    }
+    SSL_CTX_free(client->ssl_ctx);
+    free(client);
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url) {
+    shim_url_t parsed;
+
+    if (!parse_url(url, &parsed)) {
+        ESP_LOGE(TAG, "Unsupported URL %s", url);
+        return ESP_ERR_INVALID_ARG;
+    }
+    // another host needs another connection, the same one keeps it
+    if (client->fd >= 0 && !same_origin(&parsed, &client->connected_to)) {
+        disconnect(client);
+    }
+    // like ESP-IDF: the name only, and a new port on the same host leaves the header as it was
+    if (strcasecmp(parsed.host, client->url.host) != 0 &&
+            esp_http_client_set_header(client, "Host", parsed.host) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    client->url = parsed;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_get_url(esp_http_client_handle_t client, char *url, const int len) {
+    int length = snprintf(url, len, "%s://%s:%d%s", client->url.https ? "https" : "http", client->url.host,
+            client->url.port, client->url.path);
+    return (length >= 0 && length < len) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method) {
+    client->method = method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t client, int timeout_ms) {
+    client->config.timeout_ms = timeout_ms;
+    if (client->fd >= 0) {
+        set_socket_timeout(client);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value) {
+    shim_header_t *header = find_header(client, key);
+    char *copy = copy_string(value);
+
+    if (copy == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (header == NULL) {
+        header = calloc(1, sizeof(*header));
+        if (header == NULL || (header->key = copy_string(key)) == NULL) {
+            free(header);
+            free(copy);
+            return ESP_ERR_NO_MEM;
+        }
+        header->next = client->headers;
+        client->headers = header;
+    }
+    free(header->value);
+    header->value = copy;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client, const char *key) {
+    for (shim_header_t **link = &client->headers; *link != NULL; link = &(*link)->next) {
+        shim_header_t *header = *link;
+        if (strcasecmp(header->key, key) == 0) {
+            *link = header->next;
+            free(header->key);
+            free(header->value);
+            free(header);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len) {
+    static const char *method_names[] = { "GET", "POST", "PUT", "PATCH", "DELETE", "HEAD" };
+    char request[SHIM_INPUT_BUFFER_SIZE];
+    int length;
+
+    // the kept-alive connection is only good if the last response was read to the end and the server keeps it open
+    if (client->fd >= 0 && (!client->config.keep_alive_enable || client->server_closes || !client->body_done ||
+            !same_origin(&client->url, &client->connected_to))) {
+        disconnect(client);
+    }
+    if (client->fd < 0) {
+        esp_err_t err = connect_to_server(client);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    reset_response(client);
+
+    length = snprintf(request, sizeof(request), "%s %s HTTP/1.1\r\n", method_names[client->method], client->url.path);
+    for (shim_header_t *header = client->headers; header != NULL && length < (int)sizeof(request); header = header->next) {
+        length += snprintf(request + length, sizeof(request) - length, "%s: %s\r\n", header->key, header->value);
+    }
+    if (write_len > 0 && length < (int)sizeof(request)) {
+        length += snprintf(request + length, sizeof(request) - length, "Content-Length: %d\r\n", write_len);
+    }
+    if (length < (int)sizeof(request)) {
+        length += snprintf(request + length, sizeof(request) - length, "\r\n");
+    }
+    if (length >= (int)sizeof(request)) {
+        ESP_LOGE(TAG, "Request headers too long");
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (!transport_write(client, request, length)) {
+        ESP_LOGE(TAG, "Error sending the request headers");
+        disconnect(client);
+        return ESP_ERR_HTTP_WRITE_DATA;
+    }
+    dispatch_event(client, HTTP_EVENT_HEADER_SENT, NULL, 0, NULL, NULL);
+    return ESP_OK;
+}
+
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len) {
+    if (client->fd < 0 || !transport_write(client, buffer, len)) {
+        return -1;
+    }
+    return len;
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client) {
+    char line[SHIM_LINE_MAX_LEN];
+    int minor_version;
+
+    if (client->fd < 0) {
+        return ESP_FAIL;
+    }
+    // skip interim responses (100 Continue)
+    do {
+        if (!input_read_line(client, line, sizeof(line)) ||
+                sscanf(line, "HTTP/1.%d %d", &minor_version, &client->status) != 2) {
+            ESP_LOGD(TAG, "No status line in the response");
+            client->status = 0;
+            return ESP_FAIL;
+        }
+        while (input_read_line(client, line, sizeof(line)) && line[0] != '\0') {
+            if (client->status >= 200) {
+                char *value = strchr(line, ':');
+                if (value == NULL) {
+                    continue;
+                }
+                *value++ = '\0';
+                value += strspn(value, " \t");
+                if (strcasecmp(line, "Content-Length") == 0) {
+                    client->content_length = strtoll(value, NULL, 10);
+                }
+                else if (strcasecmp(line, "Transfer-Encoding") == 0 && strcasestr(value, "chunked") != NULL) {
+                    client->chunked = true;
+                }
+                else if (strcasecmp(line, "Connection") == 0 && strcasestr(value, "close") != NULL) {
+                    client->server_closes = true;
+                }
+                else if (strcasecmp(line, "Location") == 0) {
+                    snprintf(client->location, sizeof(client->location), "%s", value);
+                }
+                dispatch_event(client, HTTP_EVENT_ON_HEADER, NULL, 0, line, value);
+            }
+        }
+    } while (client->status < 200);
+
+    if (minor_version == 0 && !client->server_closes) {
+        // HTTP/1.0 keeps the connection only when asked to, which this client doesn't do
+        client->server_closes = true;
+    }
+    if (client->chunked) {
+        client->content_length = -1;
+    }
+    else if (client->status == HttpStatus_NotModified || client->status == 204 || client->method == HTTP_METHOD_HEAD) {
+        // no body, whatever the headers say
+        client->content_length = 0;
+        client->body_done = true;
+    }
+    else if (client->content_length < 0) {
+        client->server_closes = true;
+    }
+    if (client->content_length == 0) {
+        client->body_done = true;
+    }
+    return client->content_length;
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len) {
+    int filled = 0;
+
+    if (client->fd < 0) {
+        return -1;
+    }
+    // like ESP-IDF's client, only return with a partly filled buffer at the end of the body
+    while (filled < len && !client->body_done) {
+        int read_len = read_body_part(client, buffer + filled, len - filled);
+        if (read_len < 0) {
+            ESP_LOGE(TAG, "Error reading the response body");
+            return (filled > 0) ? filled : -1;
+        }
+        if (read_len == 0) {
+            if (!client->body_done && !client->server_closes) {
+                ESP_LOGW(TAG, "Connection closed after %" PRId64 " body bytes", client->body_received);
+                client->server_closes = true;
+            }
+            break;
+        }
+        dispatch_event(client, HTTP_EVENT_ON_DATA, buffer + filled, read_len, NULL, NULL);
+        client->body_received += read_len;
+        filled += read_len;
+        if (!client->chunked && client->content_length >= 0 && client->body_received == client->content_length) {
+            client->body_done = true;
+        }
+    }
+    if (client->body_done && filled > 0) {
+        dispatch_event(client, HTTP_EVENT_ON_FINISH, NULL, 0, NULL, NULL);
+    }
+    return filled;
+}
+
+esp_err_t esp_http_client_flush_response(esp_http_client_handle_t client, int *len) {
+    char buffer[512];
+    int total = 0;
+
+    for (;;) {
+        int read_len = esp_http_client_read(client, buffer, sizeof(buffer));
+        if (read_len < 0) {
+            return ESP_FAIL;
+        }
+        if (read_len == 0) {
+            break;
+        }
+        total += read_len;
+    }
+    if (len != NULL) {
+        *len = total;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client) {
+    disconnect(client);
+    return ESP_OK;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client) {
+    return client->status;
+}
+
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client) {
+    return client->chunked;
+}
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client) {
+    // like ESP-IDF's client, which compares the bytes read with Content-Length: a body that ends with the
+    // connection never counts as complete
+    return client->body_done && (client->chunked || client->content_length >= 0);
+}
+
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t client) {
+    char url[SHIM_HOST_MAX_LEN + 2 * SHIM_PATH_MAX_LEN + 16];
+
+    if (client->location[0] == '\0') {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strstr(client->location, "://") != NULL) {
+        return esp_http_client_set_url(client, client->location);
+    }
+
+    int length = snprintf(url, sizeof(url), "%s://%s:%d", client->url.https ? "https" : "http", client->url.host,
+            client->url.port);
+    if (client->location[0] == '/') {
+        snprintf(url + length, sizeof(url) - length, "%s", client->location);
+    }
+    else {
+        // relative to the directory of the current path
+        size_t directory = strcspn(client->url.path, "?");
+        while (directory > 0 && client->url.path[directory - 1] != '/') {
+            directory--;
+        }
+        snprintf(url + length, sizeof(url) - length, "%.*s%s", (int)directory, client->url.path, client->location);
+    }
+    return esp_http_client_set_url(client, url);
+}
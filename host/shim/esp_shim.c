@@ -0,0 +1,99 @@
+// Host build: the rest of the ESP-IDF functions the code under components/ calls.
+
+#include <string.h>
+#include <time.h>
+#include "esp_crt_bundle.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_tls.h"
+#include "miniz.h"
+
+int esp_log_host_level = 2;
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK: return "ESP_OK";
+        case ESP_FAIL: return "ESP_FAIL";
+        case ESP_ERR_NO_MEM: return "ESP_ERR_NO_MEM";
+        case ESP_ERR_INVALID_ARG: return "ESP_ERR_INVALID_ARG";
+        case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+        case ESP_ERR_INVALID_SIZE: return "ESP_ERR_INVALID_SIZE";
+        case ESP_ERR_NOT_FOUND: return "ESP_ERR_NOT_FOUND";
+        case ESP_ERR_TIMEOUT: return "ESP_ERR_TIMEOUT";
+        case ESP_ERR_HTTP_MAX_REDIRECT: return "ESP_ERR_HTTP_MAX_REDIRECT";
+        case ESP_ERR_HTTP_CONNECT: return "ESP_ERR_HTTP_CONNECT";
+        case ESP_ERR_HTTP_WRITE_DATA: return "ESP_ERR_HTTP_WRITE_DATA";
+        case ESP_ERR_HTTP_FETCH_HEADER: return "ESP_ERR_HTTP_FETCH_HEADER";
+        case ESP_ERR_HTTP_INVALID_TRANSPORT: return "ESP_ERR_HTTP_INVALID_TRANSPORT";
+        default: return "UNKNOWN ERROR";
+    }
+}
+
+int64_t esp_timer_get_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+esp_err_t esp_crt_bundle_attach(void *conf) {
+    (void)conf;
+    return ESP_OK;
+}
+
+esp_err_t esp_tls_get_and_clear_last_error(esp_tls_error_handle_t h, int *esp_tls_code, int *esp_tls_flags) {
+    (void)h;
+    if (esp_tls_code != NULL) {
+        *esp_tls_code = 0;
+    }
+    if (esp_tls_flags != NULL) {
+        *esp_tls_flags = 0;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief tinfl_decompress over zlib, with the same status codes for the cases http_inflate.c tells apart
+ */
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *in_buf, size_t *in_buf_size, uint8_t *out_buf_start,
+        uint8_t *out_buf_next, size_t *out_buf_size, uint32_t decomp_flags) {
+    (void)out_buf_start;
+
+    if (!r->initialized) {
+        // windowBits 15 is a zlib stream, -15 raw deflate
+        if (inflateInit2(&r->stream, (decomp_flags & TINFL_FLAG_PARSE_ZLIB_HEADER) ? 15 : -15) != Z_OK) {
+            return TINFL_STATUS_FAILED;
+        }
+        r->initialized = 1;
+    }
+    r->stream.next_in = (uint8_t *)in_buf;
+    r->stream.avail_in = (uInt)*in_buf_size;
+    r->stream.next_out = out_buf_next;
+    r->stream.avail_out = (uInt)*out_buf_size;
+
+    int ret = inflate(&r->stream, Z_NO_FLUSH);
+    *in_buf_size -= r->stream.avail_in;
+    *out_buf_size -= r->stream.avail_out;
+
+    tinfl_status status;
+    if (ret == Z_STREAM_END) {
+        status = TINFL_STATUS_DONE;
+    }
+    else if (ret < 0 && ret != Z_BUF_ERROR) {
+        status = (r->stream.msg != NULL && strcmp(r->stream.msg, "incorrect data check") == 0) ? TINFL_STATUS_ADLER32_MISMATCH : TINFL_STATUS_FAILED;
+    }
+    else if (r->stream.avail_out == 0) {
+        return TINFL_STATUS_HAS_MORE_OUTPUT;
+    }
+    else if (!(decomp_flags & TINFL_FLAG_HAS_MORE_INPUT)) {
+        status = TINFL_STATUS_FAILED_CANNOT_MAKE_PROGRESS;
+    }
+    else {
+        return TINFL_STATUS_NEEDS_MORE_INPUT;
+    }
+
+    // the stream is finished either way, http_inflate.c frees the decompressor without telling
+    inflateEnd(&r->stream);
+    r->initialized = 0;
+    return status;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+// Host build: there is no deep sleep, RTC memory is ordinary memory.
+#define RTC_SLOW_ATTR
+#define RTC_DATA_ATTR
@@ -0,0 +1,6 @@
+#pragma once
+
+#include "esp_err.h"
+
+// Host build: the client shim verifies against HTTP_SHIM_CA_FILE instead of the bundle, see esp_http_client.c.
+esp_err_t esp_crt_bundle_attach(void *conf);
@@ -0,0 +1,44 @@
+#pragma once
+
+// Host build: the subset of esp_err.h used by the code under components/.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK                  0
+#define ESP_FAIL                -1
+#define ESP_ERR_NO_MEM          0x101
+#define ESP_ERR_INVALID_ARG     0x102
+#define ESP_ERR_INVALID_STATE   0x103
+#define ESP_ERR_INVALID_SIZE    0x104
+#define ESP_ERR_NOT_FOUND       0x105
+#define ESP_ERR_TIMEOUT         0x107
+
+#define ESP_ERR_HTTP_BASE           0x7000
+#define ESP_ERR_HTTP_MAX_REDIRECT   (ESP_ERR_HTTP_BASE + 1)
+#define ESP_ERR_HTTP_CONNECT        (ESP_ERR_HTTP_BASE + 2)
+#define ESP_ERR_HTTP_WRITE_DATA     (ESP_ERR_HTTP_BASE + 3)
+#define ESP_ERR_HTTP_FETCH_HEADER   (ESP_ERR_HTTP_BASE + 4)
+#define ESP_ERR_HTTP_INVALID_TRANSPORT  (ESP_ERR_HTTP_BASE + 5)
+
+const char *esp_err_to_name(esp_err_t code);
+
+#define ESP_ERROR_CHECK(x) do {                                         \
+        esp_err_t err_rc_ = (x);                                        \
+        if (err_rc_ != ESP_OK) {                                        \
+            fprintf(stderr, "ESP_ERROR_CHECK failed: %s at %s:%d\n",   \
+                    esp_err_to_name(err_rc_), __FILE__, __LINE__);      \
+            abort();                                                    \
+        }                                                               \
+    } while (0)
+
+#define ESP_ERROR_CHECK_WITHOUT_ABORT(x) ({                             \
+        esp_err_t err_rc_ = (x);                                        \
+        if (err_rc_ != ESP_OK) {                                        \
+            fprintf(stderr, "ESP_ERROR_CHECK_WITHOUT_ABORT failed: %s at %s:%d\n", \
+                    esp_err_to_name(err_rc_), __FILE__, __LINE__);      \
+        }                                                               \
+        err_rc_;                                                        \
+    })
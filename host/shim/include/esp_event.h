@@ -0,0 +1,4 @@
+#pragma once
+
+// Host build: nothing from the event loop is used by the HTTP code.
+#include "esp_err.h"
@@ -0,0 +1,94 @@
+#pragma once
+
+// Host build: the esp_http_client API as used by components/http.c, implemented over POSIX sockets and OpenSSL
+// in esp_http_client.c. Only what http.c needs is there; the behaviour follows ESP-IDF's client where it matters
+// to the caller (events, keep-alive, chunked bodies, redirects).
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef struct esp_http_client *esp_http_client_handle_t;
+
+typedef enum {
+    HTTP_EVENT_ERROR = 0,
+    HTTP_EVENT_ON_CONNECTED,
+    HTTP_EVENT_HEADERS_SENT,
+    HTTP_EVENT_HEADER_SENT = HTTP_EVENT_HEADERS_SENT,
+    HTTP_EVENT_ON_HEADER,
+    HTTP_EVENT_ON_DATA,
+    HTTP_EVENT_ON_FINISH,
+    HTTP_EVENT_DISCONNECTED,
+    HTTP_EVENT_REDIRECT,
+} esp_http_client_event_id_t;
+
+typedef struct esp_http_client_event {
+    esp_http_client_event_id_t event_id;
+    esp_http_client_handle_t client;
+    void *data;
+    int data_len;
+    void *user_data;
+    char *header_key;
+    char *header_value;
+} esp_http_client_event_t;
+
+typedef esp_err_t (*http_event_handle_cb)(esp_http_client_event_t *evt);
+
+typedef enum {
+    HTTP_METHOD_GET = 0,
+    HTTP_METHOD_POST,
+    HTTP_METHOD_PUT,
+    HTTP_METHOD_PATCH,
+    HTTP_METHOD_DELETE,
+    HTTP_METHOD_HEAD,
+} esp_http_client_method_t;
+
+typedef enum {
+    HttpStatus_Ok = 200,
+    HttpStatus_MultipleChoices = 300,
+    HttpStatus_MovedPermanently = 301,
+    HttpStatus_Found = 302,
+    HttpStatus_SeeOther = 303,
+    HttpStatus_NotModified = 304,
+    HttpStatus_TemporaryRedirect = 307,
+    HttpStatus_PermanentRedirect = 308,
+    HttpStatus_BadRequest = 400,
+    HttpStatus_NotFound = 404,
+    HttpStatus_InternalError = 500,
+} HttpStatus_Code;
+
+typedef struct {
+    const char *url;
+    const char *common_name;            // TLS server name to check the certificate against, instead of the URL's host
+    esp_http_client_method_t method;
+    int timeout_ms;
+    http_event_handle_cb event_handler;
+    void *user_data;
+    int buffer_size;
+    int buffer_size_tx;
+    bool keep_alive_enable;
+    esp_err_t (*crt_bundle_attach)(void *conf);
+} esp_http_client_config_t;
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config);
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client);
+
+esp_err_t esp_http_client_set_url(esp_http_client_handle_t client, const char *url);
+esp_err_t esp_http_client_get_url(esp_http_client_handle_t client, char *url, const int len);
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method);
+esp_err_t esp_http_client_set_timeout_ms(esp_http_client_handle_t client, int timeout_ms);
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value);
+esp_err_t esp_http_client_delete_header(esp_http_client_handle_t client, const char *key);
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len);
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len);
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t client);
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len);
+esp_err_t esp_http_client_flush_response(esp_http_client_handle_t client, int *len);
+esp_err_t esp_http_client_close(esp_http_client_handle_t client);
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client);
+bool esp_http_client_is_chunked_response(esp_http_client_handle_t client);
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client);
+esp_err_t esp_http_client_set_redirection(esp_http_client_handle_t client);
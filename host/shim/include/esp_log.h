@@ -0,0 +1,21 @@
+#pragma once
+
+// Host build: ESP_LOGx print to stderr. Errors and warnings always, the rest only at esp_log_host_level >= 3.
+
+#include <inttypes.h>
+#include <stdio.h>
+#include "esp_err.h"
+
+extern int esp_log_host_level;  // 1 error, 2 warning, 3 info, 4 debug
+
+#define ESP_LOG_HOST(level, letter, tag, format, ...) do {                          \
+        if (esp_log_host_level >= (level)) {                                        \
+            fprintf(stderr, letter " (%s) " format "\n", tag, ##__VA_ARGS__);      \
+        }                                                                           \
+    } while (0)
+
+#define ESP_LOGE(tag, format, ...) ESP_LOG_HOST(1, "E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) ESP_LOG_HOST(2, "W", tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) ESP_LOG_HOST(3, "I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) ESP_LOG_HOST(4, "D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) ESP_LOG_HOST(5, "V", tag, format, ##__VA_ARGS__)
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Host build: good enough for backoff jitter.
+static inline uint32_t esp_random(void) {
+    return (uint32_t)random() ^ ((uint32_t)random() << 16);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdint.h>
+#include <zlib.h>
+
+// Host build: zlib's crc32 is the same CRC as the ROM's crc32_le.
+static inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t *buf, uint32_t len) {
+    return (uint32_t)crc32(crc, buf, len);
+}
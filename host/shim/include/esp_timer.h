@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// microseconds since an arbitrary point (CLOCK_MONOTONIC on the host)
+int64_t esp_timer_get_time(void);
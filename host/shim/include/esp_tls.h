@@ -0,0 +1,8 @@
+#pragma once
+
+#include "esp_err.h"
+
+typedef void *esp_tls_error_handle_t;
+
+// Host build: TLS errors are logged by the client shim as they happen, there is nothing to fetch later.
+esp_err_t esp_tls_get_and_clear_last_error(esp_tls_error_handle_t h, int *esp_tls_code, int *esp_tls_flags);
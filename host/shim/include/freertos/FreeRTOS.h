@@ -0,0 +1,13 @@
+#pragma once
+
+// Host build: ticks are milliseconds, which is all the code under components/ needs from FreeRTOS.
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+
+#define pdFALSE             0
+#define pdTRUE              1
+
+#define portMAX_DELAY       ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
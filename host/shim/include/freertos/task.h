@@ -0,0 +1,8 @@
+#pragma once
+
+#include <unistd.h>
+#include "freertos/FreeRTOS.h"
+
+static inline void vTaskDelay(TickType_t ticks) {
+    usleep((useconds_t)ticks * 1000);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+#include <netdb.h>
+#include <netinet/in.h>
+
+// Host build: lwIP's resolver over getaddrinfo(), IPv4 only. Lookups finish inside the call, like a name in
+// lwIP's own cache, so found is never called later.
+typedef int8_t err_t;
+
+#define ERR_OK          0
+#define ERR_INPROGRESS  -5
+#define ERR_ARG         -16
+
+typedef struct {
+    uint32_t addr;  // network byte order
+} ip_addr_t;
+
+#define IP_IS_V4(address)           1
+#define ip_2_ip4(address)           (address)
+#define ip4_addr_get_u32(address)   ((address)->addr)
+
+#define LWIP_DNS_ADDRTYPE_IPV4  0
+
+typedef void (*dns_found_callback)(const char *name, const ip_addr_t *address, void *callback_arg);
+
+static inline err_t dns_gethostbyname_addrtype(const char *hostname, ip_addr_t *address, dns_found_callback found,
+        void *callback_arg, uint8_t dns_addrtype) {
+    const struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+    struct addrinfo *result = NULL;
+
+    (void)found;
+    (void)callback_arg;
+    (void)dns_addrtype;
+    if (getaddrinfo(hostname, NULL, &hints, &result) != 0 || result == NULL) {
+        return ERR_ARG;
+    }
+    address->addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(result);
+    return ERR_OK;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "lwip/dns.h"
+
+typedef void (*tcpip_callback_fn)(void *ctx);
+
+// Host build: there is no lwIP thread, the function runs right away in the caller's
+static inline err_t tcpip_callback(tcpip_callback_fn function, void *ctx) {
+    function(ctx);
+    return ERR_OK;
+}
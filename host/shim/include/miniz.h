@@ -0,0 +1,35 @@
+#pragma once
+
+// Host build: the part of the ROM's tinfl API that http_inflate.c uses, implemented with zlib's inflate.
+// zlib keeps its own window, so the wrapping output buffer is only written to, never read back.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+#define TINFL_LZ_DICT_SIZE 32768
+
+enum {
+    TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+    TINFL_FLAG_HAS_MORE_INPUT = 2,
+};
+
+typedef enum {
+    TINFL_STATUS_FAILED_CANNOT_MAKE_PROGRESS = -4,
+    TINFL_STATUS_BAD_PARAM = -3,
+    TINFL_STATUS_ADLER32_MISMATCH = -2,
+    TINFL_STATUS_FAILED = -1,
+    TINFL_STATUS_DONE = 0,
+    TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+    TINFL_STATUS_HAS_MORE_OUTPUT = 2,
+} tinfl_status;
+
+typedef struct {
+    z_stream stream;
+    int initialized;
+} tinfl_decompressor;
+
+#define tinfl_init(r) ((r)->initialized = 0)
+
+tinfl_status tinfl_decompress(tinfl_decompressor *r, const uint8_t *in_buf, size_t *in_buf_size, uint8_t *out_buf_start,
+        uint8_t *out_buf_next, size_t *out_buf_size, uint32_t decomp_flags);
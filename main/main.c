@@ -15,19 +15,76 @@
 #include "servo.h"
 #include "wifi.h"
 #include "esp_wifi.h"
-#include "esp_netif_sntp.h"
 #include "http.h"
-#include "cJSON.h"
+#include "telemetry.h"
+#include "alarm_config.h"
+#include "push.h"
+#include "time_sync.h"
+#include "sync_policy.h"
+#include "esp_rom_crc.h"
 
 #define WIFI_SSID   CONFIG_WIFI_SSID
 #define WIFI_PASSWORD   CONFIG_WIFI_PASSWORD
 
+#define SNTP_SERVER             "pool.ntp.org"
+#define SNTP_TIMEOUT_MS         10000   // counted from the IP address, see wait_for_time
+#define HTTP_MIN_TIME_MS        1000    // not worth sending a request with less than this left
+#define SETTINGS_FETCH_ATTEMPTS 3
+#define PUSH_MAX_WAIT_MS        (60 * 60 * 1000)    // push mode looks at the time to the alarm again after this
+
 static const char *TAG = "main";
 RTC_SLOW_ATTR static struct timeval last_sleep;
 
-static int ALARM_HOUR;
-static int ALARM_MIN;
-static bool ALARM_ENABLED;
+static alarm_config_t alarm_config;    // parsed from the website's JSON, see alarm_config.json
+
+// network time of this wake, shared by Wi-Fi, HTTP and SNTP (see wake_budget.h)
+static wake_budget_t wake_budget;
+static bool wifi_connected = false;
+static bool network_used = false;       // this wake brought up Wi-Fi, see sync_policy.h
+static bool settings_fetched = false;   // and got the settings from the website
+
+static const sync_policy_config_t sync_policy = {
+    .min_interval_s = CONFIG_SYNC_MIN_INTERVAL_MIN * 60,
+    .max_interval_s = CONFIG_SYNC_MAX_INTERVAL_MIN * 60,
+    .max_local_wakes = CONFIG_SYNC_MAX_LOCAL_WAKES,
+};
+
+// IR receiver, set up in app_main
+static rmt_channel_handle_t rx_channel = NULL;
+static QueueHandle_t receive_queue = NULL;
+static rmt_symbol_word_t raw_symbols[64]; // 64 symbols should be sufficient for a standard NEC frame
+// the following timing requirement is based on NEC protocol
+static const rmt_receive_config_t receive_config = {
+    .signal_range_min_ns = 1250,     // the shortest duration for NEC signal is 560us, 1250ns < 560us, valid signal won't be treated as noise
+    .signal_range_max_ns = 12000000, // the longest duration for NEC signal is 9000us, 12000000ns > 9000us, the receive won't stop early
+};
+
+// the last settings from the website and their validators, so an unchanged document isn't downloaded again
+RTC_SLOW_ATTR static struct {
+    bool valid;
+    http_validators_t validators;
+    alarm_config_t config;
+} cached_settings;
+
+/**
+ * @brief waits for the SNTP answer, which has been on its way since Wi-Fi got the IP address. At most 10s after
+ * that, and not beyond budget (NULL for no budget). Without an answer the clock keeps running on the RTC time
+ * from the last sync
+ */
+static void wait_for_time(wake_budget_t *budget) {
+    uint32_t elapsed_ms = time_sync_elapsed_ms();
+    uint32_t wait_ms = wake_budget_limit_ms(budget, (elapsed_ms < SNTP_TIMEOUT_MS) ? SNTP_TIMEOUT_MS - elapsed_ms : 0);
+    esp_err_t err = ESP_OK;
+
+    if (!time_sync_done()) {
+        err = (wait_ms > 0) ? time_sync_wait(pdMS_TO_TICKS(wait_ms)) : ESP_ERR_TIMEOUT;
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "No time from SNTP within %"PRIu32" ms", time_sync_elapsed_ms());
+    }
+    wake_budget_stage_record(budget, WAKE_STAGE_SNTP, time_sync_elapsed_ms(),
+            (err == ESP_OK) ? WAKE_STAGE_OK : WAKE_STAGE_FAILED);
+}
 
 /**
  * @brief calculates amount of time in microseconds between the current time and the desired wake-up time.
@@ -40,14 +97,6 @@ bool calculate_sleep_time(int wakeup_hour, int wakeup_min, uint64_t *sleep_us_ou
         return false;
     }
 
-
-    esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG("pool.ntp.org");
-    esp_netif_sntp_init(&config);
-    if (esp_netif_sntp_sync_wait(pdMS_TO_TICKS(10000)) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to update system time within 10s timeout");
-    }
-
-
     time_t now;
     struct tm target_time;
     time(&now);
@@ -90,7 +139,30 @@ static bool example_rmt_rx_done_callback(rmt_channel_handle_t channel, const rmt
     return high_task_wakeup == pdTRUE;
 }
 
+/**
+ * @brief identifies the alarm settings for sync_policy, field by field since the struct has padding
+ */
+static uint32_t settings_hash(const alarm_config_t *config) {
+    int32_t fields[] = { config->enabled, config->hour, config->minute };
+    return esp_rom_crc32_le(0, (const uint8_t *)fields, sizeof(fields));
+}
+
 static void deep_sleep_task() {
+    if (network_used) {
+        // the settings are in, now the clock has to be right as well
+        if (wifi_connected) {
+            wait_for_time(&wake_budget);
+        }
+        wake_budget_log(&wake_budget);
+        telemetry_record_budget(&wake_budget);  // uploaded on the next wake
+    }
+    if (settings_fetched) {
+        sync_policy_record_sync(&sync_policy, settings_hash(&alarm_config));
+    }
+    else {
+        sync_policy_record_local();
+    }
+
     // first we just print what time it is now 
     gettimeofday(&last_sleep, NULL);
     struct tm *time = localtime(&last_sleep.tv_sec);
@@ -99,18 +171,21 @@ static void deep_sleep_task() {
     
     // now we find out how many us we need to sleep for using calculate_sleep_time
     uint64_t wake_time_us;
-    if (calculate_sleep_time(ALARM_HOUR, ALARM_MIN, &wake_time_us) == false) {
+    if (calculate_sleep_time(alarm_config.hour, alarm_config.minute, &wake_time_us) == false) {
         ESP_LOGE(TAG, "Failed to compute sleep time");
         return;
     }
     
     // now that we have gotten all the HTTP and SNTP data we need, wifi is
     // no longer needed
-    ESP_ERROR_CHECK(wifi_disconnect());
-    ESP_ERROR_CHECK(wifi_deinitialize());
+    if (network_used) {
+        time_sync_deinit();
+        ESP_ERROR_CHECK_WITHOUT_ABORT(wifi_disconnect());
+        ESP_ERROR_CHECK(wifi_deinitialize());
+    }
 
     // if the alarm is enabled, we should set a wakeup time
-    if (ALARM_ENABLED) {
+    if (alarm_config.enabled) {
         esp_sleep_enable_timer_wakeup(wake_time_us);
         ESP_LOGI(TAG, "Waking up in %llu microseconds", wake_time_us);
     }
@@ -145,46 +220,214 @@ void print_wakeup_cause() {
     }
 }
 
-esp_err_t process_web_data(char *buffer) {
-    cJSON *json;    // cJSON variables for each cJSON object we access
-    cJSON *alarm;
-    cJSON *enabled;
-    cJSON *hour;
-    cJSON *minute;
-    
-    // Parsing the JSON
-    json = cJSON_Parse(buffer);
-
-    if (json == NULL) { // checking for errors, per cJSON docs, only need to do after parse
-        const char *error_ptr = cJSON_GetErrorPtr();
-        if (error_ptr != NULL)
-        {
-            ESP_LOGE(TAG, "Error before: %s\n", error_ptr);
+/**
+ * @brief moves the servo like when the alarm goes off
+ */
+static void ring_alarm(void) {
+    servo_set_angle(15);
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    servo_set_angle(0);
+    vTaskDelay(pdMS_TO_TICKS(1000));
+}
+
+/**
+ * @brief handles remote button presses until none comes for idle_timeout
+ */
+static void handle_remote(TickType_t idle_timeout) {
+    rmt_rx_done_event_data_t rx_data;
+    int angle = 0;
+
+    while (xQueueReceive(receive_queue, &rx_data, idle_timeout) == pdPASS) {
+        // parse the receive symbols and print the result
+        // example_parse_nec_frame(rx_data.received_symbols, rx_data.num_symbols);
+        int parsed_frame = example_parse_nec_frame(rx_data.received_symbols, rx_data.num_symbols);
+        if (parsed_frame == 0xE916) {
+            ESP_LOGI(TAG, "0 was pressed!");
+            angle = -15;
+            servo_set_angle(angle);
+        }
+        else if (parsed_frame == 0xF30C) {
+            ESP_LOGI(TAG, "1 was pressed!");
+            angle = 15;
+            servo_set_angle(angle);
+        } 
+        else {
+            ESP_LOGE(TAG, "Bad input (neither 1 or 0)");
         }
-        return ESP_FAIL;
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        angle = 0;
+        servo_set_angle(angle);
+        // start receive again
+        ESP_ERROR_CHECK(rmt_receive(rx_channel, raw_symbols, sizeof(raw_symbols), &receive_config));
+    }
+}
+
+esp_err_t process_web_data(const char *buffer, size_t length) {
+    // the generated parser checks the types and ranges and fills the struct directly, no cJSON tree needed
+    esp_err_t err = alarm_config_parse(buffer, length, &alarm_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Bad alarm settings from the website: %s", esp_err_to_name(err));
+        return err;
     }
 
-    // After parsing the JSON, we get each key-value pair with GetObjectItem
-    alarm = cJSON_GetObjectItem(json, "alarm");
-    enabled = cJSON_GetObjectItem(alarm, "enabled");
-    hour = cJSON_GetObjectItem(alarm, "hour");
-    minute = cJSON_GetObjectItem(alarm, "minute");
-
-    // we set the ALARM variables to their correct values
-    ALARM_ENABLED = (enabled->type == cJSON_True) ? true : false;
-    ESP_LOGI(TAG, "ALARM_ENABLED = %d", ALARM_ENABLED);
-    ALARM_HOUR = hour->valueint;
-    ESP_LOGI(TAG, "ALARM_HOUR = %d", ALARM_HOUR);
-    ALARM_MIN = minute->valueint;
-    ESP_LOGI(TAG, "ALARM_MIN = %d", ALARM_MIN);
-
-    // we no longer need the JSON items, so we can free all the memory associated with it
-    cJSON_Delete(json);
+    ESP_LOGI(TAG, "ALARM_ENABLED = %d", alarm_config.enabled);
+    ESP_LOGI(TAG, "ALARM_HOUR = %d", alarm_config.hour);
+    ESP_LOGI(TAG, "ALARM_MIN = %d", alarm_config.minute);
     return ESP_OK;
 }
 
+/**
+ * @brief body consumer for http_send_request. The alarm settings are one small document, so this waits
+ * until all of it has arrived and then parses it straight out of the HTTP receive buffer
+ */
+static int web_data_consumer(const char *data, size_t length, bool last, void *context) {
+    esp_err_t *result = context;
+
+    if (!last) {
+        return 0;
+    }
+    ESP_LOGI(TAG, "Received: %.*s", (int)length, data);
+    *result = process_web_data(data, length);
+    return (*result == ESP_OK) ? (int)length : -1;
+}
+
+/**
+ * @brief body producer for the telemetry upload, the JSON is already in context
+ */
+static int telemetry_producer(char *buffer, size_t size, size_t offset, void *context) {
+    memcpy(buffer, (const char *)context + offset, size);
+    return (int)size;
+}
+
+/**
+ * @brief body consumer that throws the response away
+ */
+static int discard_body(const char *data, size_t length, bool last, void *context) {
+    return (int)length;
+}
+
+/**
+ * @brief POSTs the telemetry to CONFIG_TELEMETRY_URL, if there is one and there is time left. Failing is only logged
+ */
+static void upload_telemetry(http_session_t *session) {
+    static char telemetry_json[4096];  // up to TELEMETRY_TIMING_SAMPLES samples
+    size_t length;
+
+    if (CONFIG_TELEMETRY_URL[0] == '\0') {
+        return;
+    }
+    if (wake_budget_remaining_ms(&wake_budget) < HTTP_MIN_TIME_MS) {
+        ESP_LOGW(TAG, "No time left to upload the telemetry");
+        return;
+    }
+    if (telemetry_serialize(telemetry_json, sizeof(telemetry_json), &length) != ESP_OK) {
+        ESP_LOGE(TAG, "Telemetry doesn't fit into %d bytes", (int)sizeof(telemetry_json));
+        return;
+    }
+    esp_err_t err = http_session_post(session, CONFIG_TELEMETRY_URL, "application/json", length,
+            telemetry_producer, discard_body, telemetry_json);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Telemetry upload failed: %s", esp_err_to_name(err));
+    }
+}
+
+/**
+ * @brief Gets the alarm settings, or the word that the cached ones are still current. Failed requests are
+ * retried with backoff while the budget allows. Returns ESP_ERR_TIMEOUT if it ran out, and
+ * ESP_ERR_INVALID_RESPONSE for settings that can't be used, without asking again
+ */
+static esp_err_t fetch_settings(http_session_t *session, wake_budget_t *budget) {
+    esp_err_t err = ESP_ERR_TIMEOUT;
+
+    for (int attempt = 0; attempt < SETTINGS_FETCH_ATTEMPTS; attempt++) {
+        if (attempt > 0 && wake_budget_backoff(budget, attempt - 1, 1000, 4000) != ESP_OK) {
+            return ESP_ERR_TIMEOUT;
+        }
+        if (wake_budget_remaining_ms(budget) < HTTP_MIN_TIME_MS) {
+            return ESP_ERR_TIMEOUT;
+        }
+
+        esp_err_t web_data_err = ESP_ERR_NOT_FINISHED;  // until web_data_consumer has the whole document
+        http_validators_t validators = { 0 };
+        if (cached_settings.valid) {
+            validators = cached_settings.validators;
+        }
+        // the session stops the request once the budget has run out
+        err = http_session_get(session, NULL, &validators, web_data_consumer, &web_data_err);
+        if (err == HTTP_ERR_STATUS) {
+            // an error page, e.g. from a proxy while the server restarts: worth asking again like a lost connection
+            continue;
+        }
+        if (web_data_err != ESP_ERR_NOT_FINISHED && web_data_err != ESP_OK) {
+            // a 2xx with settings we can't use, asking again won't change that
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        if (err != ESP_OK) {
+            continue;
+        }
+        if (validators.not_modified) {
+            ESP_LOGI(TAG, "Alarm settings unchanged, using the cached ones");
+            alarm_config = cached_settings.config;
+            return ESP_OK;
+        }
+        cached_settings.validators = validators;
+        cached_settings.config = alarm_config;
+        cached_settings.valid = true;
+        return ESP_OK;
+    }
+    return err;
+}
+
+/**
+ * @brief stage result for an error from wifi_connect or fetch_settings, where ESP_ERR_TIMEOUT means the budget ran out
+ */
+static wake_stage_result_t stage_result(esp_err_t err) {
+    if (err == ESP_OK) {
+        return WAKE_STAGE_OK;
+    }
+    return (err == ESP_ERR_TIMEOUT) ? WAKE_STAGE_OUT_OF_TIME : WAKE_STAGE_FAILED;
+}
+
+#ifdef CONFIG_ALARM_PUSH_MODE
+/**
+ * @brief stay-connected replacement for deep_sleep_task: rings the alarm on time and applies the settings that
+ * come in over the push channel in between. This task owns alarm_config from now on
+ */
+static void push_alarm_task(void *arg) {
+    static push_message_t message;  // too big for the stack
+
+    wait_for_time(NULL);
+    while (true) {
+        TickType_t wait = portMAX_DELAY;
+        bool alarm_due = false;     // the alarm is at the end of this wait
+        uint64_t alarm_in_us;
+        if (alarm_config.enabled && calculate_sleep_time(alarm_config.hour, alarm_config.minute, &alarm_in_us)) {
+            // up to a day away, too long for pdMS_TO_TICKS' 32-bit arithmetic. SNTP can also still move the clock,
+            // so wait at most an hour and work out the time to the alarm again
+            uint64_t wait_ms = alarm_in_us / 1000;
+            alarm_due = (wait_ms <= PUSH_MAX_WAIT_MS);
+            if (!alarm_due) {
+                wait_ms = PUSH_MAX_WAIT_MS;
+            }
+            wait = (TickType_t)(wait_ms / portTICK_PERIOD_MS);
+        }
+
+        if (push_receive(&message, wait) == ESP_OK) {
+            ESP_LOGI(TAG, "Pushed: %.*s", (int)message.length, message.data);
+            // a bad message leaves the settings as they were
+            process_web_data(message.data, message.length);
+        }
+        else if (alarm_due) {
+            ESP_LOGI(TAG, "Alarm!");
+            ring_alarm();
+        }
+    }
+}
+#endif
+
 void app_main(void)
 {
+    telemetry_wake_start();
     print_wakeup_cause();
 
     // ----------- IR RECEIVER SET UP ---------------------
@@ -195,30 +438,20 @@ void app_main(void)
         .mem_block_symbols = 64, // amount of RMT symbols that the channel can store at a time
         .gpio_num = EXAMPLE_IR_RX_GPIO_NUM,
     };
-    rmt_channel_handle_t rx_channel = NULL;
     ESP_ERROR_CHECK(rmt_new_rx_channel(&rx_channel_cfg, &rx_channel));
 
     ESP_LOGI(TAG, "register RX done callback");
-    QueueHandle_t receive_queue = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
+    receive_queue = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
     assert(receive_queue);
     rmt_rx_event_callbacks_t cbs = {
         .on_recv_done = example_rmt_rx_done_callback,
     };
     ESP_ERROR_CHECK(rmt_rx_register_event_callbacks(rx_channel, &cbs, receive_queue));
 
-    // the following timing requirement is based on NEC protocol
-    rmt_receive_config_t receive_config = {
-        .signal_range_min_ns = 1250,     // the shortest duration for NEC signal is 560us, 1250ns < 560us, valid signal won't be treated as noise
-        .signal_range_max_ns = 12000000, // the longest duration for NEC signal is 9000us, 12000000ns > 9000us, the receive won't stop early
-    };
-
     ESP_LOGI(TAG, "enable RMT RX channel");
     // ESP_ERROR_CHECK(rmt_enable(tx_channel));
     ESP_ERROR_CHECK(rmt_enable(rx_channel));
 
-    // save the received RMT symbols
-    rmt_symbol_word_t raw_symbols[64]; // 64 symbols should be sufficient for a standard NEC frame
-    rmt_rx_done_event_data_t rx_data;
     // ready to receive
     ESP_ERROR_CHECK(rmt_receive(rx_channel, raw_symbols, sizeof(raw_symbols), &receive_config));
     // ----------------------------- END OF IR REC SET UP -----------------------
@@ -226,54 +459,76 @@ void app_main(void)
     setup_servo();
 
     ext_wakeup_setup();
-    
-    int angle = 0;
 
     if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER)
     {
-        angle = 15;
-        servo_set_angle(angle);
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        angle = 0;
-        servo_set_angle(angle);
-        vTaskDelay(pdMS_TO_TICKS(1000));
+        ring_alarm();
     }
 
-    while (xQueueReceive(receive_queue, &rx_data, pdMS_TO_TICKS(5000)) == pdPASS) {
-        // parse the receive symbols and print the result
-        // example_parse_nec_frame(rx_data.received_symbols, rx_data.num_symbols);
-        int parsed_frame = example_parse_nec_frame(rx_data.received_symbols, rx_data.num_symbols);
-        if (parsed_frame == 0xE916) {
-            ESP_LOGI(TAG, "0 was pressed!");
-            angle = -15;
-            servo_set_angle(angle);
+    handle_remote(pdMS_TO_TICKS(5000));
+
+#ifndef CONFIG_ALARM_PUSH_MODE
+    if (!sync_policy_should_sync(&sync_policy, cached_settings.valid)) {
+        // the radio stays off, the alarm is set from what the last sync got
+        alarm_config = cached_settings.config;
+        xTaskCreate(deep_sleep_task, "deep_sleep_task", 4096, NULL, 6, NULL);
+        return;
+    }
+#endif
+
+    network_used = true;
+    ESP_ERROR_CHECK(wifi_initialize());
+    // started by wifi.c as soon as there is an IP address, so it runs alongside the HTTP requests
+    ESP_ERROR_CHECK_WITHOUT_ABORT(time_sync_init(SNTP_SERVER));
+    // from here on every network wait comes out of the same budget
+    wake_budget_init(&wake_budget, CONFIG_WAKE_BUDGET_MS);
+    wake_budget_stage_begin(&wake_budget, WAKE_STAGE_WIFI);
+    esp_err_t err = wifi_connect(WIFI_SSID, WIFI_PASSWORD, &wake_budget);
+    wake_budget_stage_end(&wake_budget, WAKE_STAGE_WIFI, stage_result(err));
+    wifi_connected = (err == ESP_OK);
+
+    err = ESP_FAIL;
+    if (wifi_connected) {
+        http_session_t session;
+        wake_budget_stage_begin(&wake_budget, WAKE_STAGE_HTTP);
+        err = http_session_init(&session, CONFIG_DATABASE_URL, &wake_budget);
+        if (err == ESP_OK) {
+            err = fetch_settings(&session, &wake_budget);
+            // a bad document came over the network just fine, the address isn't the problem then
+            if (err != ESP_OK && err != ESP_ERR_TIMEOUT && err != ESP_ERR_INVALID_RESPONSE && wifi_address_cached() &&
+                    wifi_renew_address(&wake_budget) == ESP_OK) {
+                // the cached lease may not be good any more (address taken, different network behind the SSID)
+                err = fetch_settings(&session, &wake_budget);
+            }
+            telemetry_log();
+            upload_telemetry(&session);
+        }
+        http_session_deinit(&session);
+        wake_budget_stage_end(&wake_budget, WAKE_STAGE_HTTP, stage_result(err));
+        settings_fetched = (err == ESP_OK);
+    }
+    if (err != ESP_OK) {
+        // no network or no usable answer in time: go on with what the last wake got
+        if (cached_settings.valid) {
+            ESP_LOGW(TAG, "Using the cached alarm settings");
+            alarm_config = cached_settings.config;
         }
-        else if (parsed_frame == 0xF30C) {
-            ESP_LOGI(TAG, "1 was pressed!");
-            angle = 15;
-            servo_set_angle(angle);
-        } 
         else {
-            ESP_LOGE(TAG, "Bad input (neither 1 or 0)");
+            ESP_LOGW(TAG, "No alarm settings yet, the alarm stays off until the next wake");
         }
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        angle = 0;
-        servo_set_angle(angle);
-        // start receive again
-        ESP_ERROR_CHECK(rmt_receive(rx_channel, raw_symbols, sizeof(raw_symbols), &receive_config));
     }
-    
-    ESP_ERROR_CHECK(wifi_initialize());
-    ESP_ERROR_CHECK(wifi_connect(WIFI_SSID, WIFI_PASSWORD));
-
-    char *buf;
-    ESP_ERROR_CHECK(http_send_request(&buf));
-    ESP_LOGI(TAG, "PRINTING FROM MAIN:");
-    printf("%s\r\n", buf);
-
-    ESP_ERROR_CHECK(process_web_data(buf));
-    
-    
 
+#ifdef CONFIG_ALARM_PUSH_MODE
+    // mains powered: stay awake, take settings updates as they are published and keep serving the remote
+    if (!wifi_connected) {
+        // the budget is for battery wakes, here it is better to start over than to stay offline
+        ESP_LOGE(TAG, "No Wi-Fi, restarting");
+        esp_restart();
+    }
+    ESP_ERROR_CHECK(push_start(CONFIG_ALARM_PUSH_BROKER_URI, CONFIG_ALARM_PUSH_TOPIC));
+    xTaskCreate(push_alarm_task, "push_alarm_task", 4096, NULL, 6, NULL);
+    handle_remote(portMAX_DELAY);
+#else
     xTaskCreate(deep_sleep_task, "deep_sleep_task", 4096, NULL, 6, NULL);
+#endif
 }
@@ -0,0 +1,324 @@
+#!/usr/bin/env python3
+"""Generate typed C parse/serialize functions for a JSON document from a small schema.
+
+    json_bindgen.py <schema.json> <output dir>
+
+The schema names the struct and lists its fields, each with the dotted path of the
+value in the document:
+
+    {
+        "name": "alarm_config",
+        "fields": [
+            { "name": "hour", "path": "alarm.hour", "type": "int", "min": 0, "max": 23 },
+            ...
+        ]
+    }
+
+Field types are "bool", "int", "double" and "string" (which needs a "size" for the
+char array, including the terminating NUL). Fields are required unless they have
+"optional": true; "min"/"max" can only be given for int and double fields.
+
+For a schema named foo this writes foo.h with foo_t, foo_parse() and foo_serialize(),
+and foo.c, which uses the json_bind runtime (components/json_bind.c). The parser
+dispatches on key length and then compares the key, writes straight into the struct
+and allocates nothing. The serializer writes into a caller supplied buffer.
+
+Keys are matched like cJSON_GetObjectItem() does: ASCII case is ignored, and if a key
+comes more than once in an object the first one counts. Keys with escape sequences
+never match.
+"""
+
+import json
+import os
+import sys
+
+C_TYPES = {'bool': 'bool', 'int': 'int', 'double': 'double', 'string': 'char'}
+MAX_FIELDS = 32
+
+
+def fail(message):
+    sys.exit('json_bindgen: ' + message)
+
+
+def c_string(text):
+    # bytes other than printable ASCII as octal escapes, which can't run into the next character like \x can
+    escaped = ''
+    for byte in text.encode():
+        char = chr(byte)
+        if char in '\\"?':
+            escaped += '\\' + char
+        elif 0x20 <= byte < 0x7F:
+            escaped += char
+        else:
+            escaped += '\\%03o' % byte
+    return '"' + escaped + '"'
+
+
+def load_schema(path):
+    with open(path) as f:
+        schema = json.load(f)
+
+    name = schema.get('name')
+    if not name or not name.isidentifier():
+        fail('schema needs a "name" that is a C identifier')
+    fields = schema.get('fields', [])
+    if not fields or len(fields) > MAX_FIELDS:
+        fail('schema needs between 1 and %d fields' % MAX_FIELDS)
+
+    names = set()
+    for field in fields:
+        if not field.get('name', '').isidentifier() or field['name'] in names:
+            fail('field names have to be unique C identifiers')
+        names.add(field['name'])
+        if field.get('type') not in C_TYPES:
+            fail('field %s has unknown type %r' % (field['name'], field.get('type')))
+        if field['type'] == 'string' and int(field.get('size', 0)) < 1:
+            fail('string field %s needs a size' % field['name'])
+        for limit in ('min', 'max'):
+            if limit not in field:
+                continue
+            if field['type'] not in ('int', 'double'):
+                fail('field %s: %s only works for int and double fields' % (field['name'], limit))
+            if isinstance(field[limit], bool) or not isinstance(field[limit], (int, float)):
+                fail('field %s: %s has to be a number' % (field['name'], limit))
+        if not field.get('path'):
+            fail('field %s needs a path' % field['name'])
+    return schema
+
+
+def build_tree(fields):
+    """Nest the fields by path: an object is a dict of key -> field or object (insertion ordered)."""
+    root = {}
+    for index, field in enumerate(fields):
+        keys = field['path'].split('.')
+        node = root
+        for key in keys[:-1]:
+            check_key_case(node, key, field['path'])
+            child = node.setdefault(key, {})
+            if is_field(child):
+                fail('%s is both a value and an object' % key)
+            node = child
+        if keys[-1] in node:
+            fail('path %s is used twice' % field['path'])
+        check_key_case(node, keys[-1], field['path'])
+        node[keys[-1]] = dict(field, index=index)
+    return root
+
+
+def check_key_case(node, key, path):
+    # keys are compared ignoring case, so two of them that only differ in case could never both match
+    for other in node:
+        if other != key and other.lower() == key.lower():
+            fail('path %s: keys %s and %s only differ in case' % (path, other, key))
+
+
+def is_field(node):
+    return 'type' in node and 'path' in node
+
+
+def object_functions(name, node, path, out):
+    """Emit one parse function per object, children first so no prototypes are needed. The functions are
+    numbered, keys don't have to be C identifiers. Returns the name of the function for node."""
+    children = {}
+    for key, child in node.items():
+        if not is_field(child):
+            children[key] = object_functions(name, child, path + [key], out)
+
+    function = 'parse_object_%d' % len(out) if path else 'parse_object_root'
+    lines = []
+    lines.append('// %s' % (json.dumps('.'.join(path)) if path else 'the document'))
+    lines.append('static bool %s(json_bind_reader_t *reader, %s_t *config, uint32_t *seen) {' % (function, name))
+    lines.append('    const char *key;')
+    lines.append('    size_t key_length;')
+    lines.append('    bool first = true;')
+    lines.append('    uint32_t members = 0;    // of this object that were read, later duplicates are skipped')
+    lines.append('')
+    lines.append('    if (!json_bind_begin_object(reader)) {')
+    lines.append('        return false;')
+    lines.append('    }')
+    lines.append('    while (json_bind_next_key(reader, first, &key, &key_length)) {')
+    lines.append('        bool ok;')
+    lines.append('        first = false;')
+    lines.append('')
+    lines.append('        switch (key_length) {')
+
+    by_length = {}
+    for member, (key, child) in enumerate(node.items()):
+        by_length.setdefault(len(key.encode()), []).append((member, key, child))
+
+    for length in sorted(by_length):
+        lines.append('            case %d:' % length)
+        for position, (member, key, child) in enumerate(by_length[length]):
+            keyword = 'if' if position == 0 else 'else if'
+            bit = '(UINT32_C(1) << %d)' % member
+            lines.append('                %s (!(members & %s) && json_bind_key_equals(key, %s, %d)) {'
+                         % (keyword, bit, c_string(key), length))
+            if is_field(child):
+                lines.extend('                    ' + line for line in read_field(child))
+            else:
+                lines.append('                    ok = %s(reader, config, seen);' % children[key])
+            lines.append('                    members |= %s;' % bit)
+            lines.append('                }')
+        lines.append('                else {')
+        lines.append('                    ok = json_bind_skip_value(reader);')
+        lines.append('                }')
+        lines.append('                break;')
+    lines.append('            default:')
+    lines.append('                ok = json_bind_skip_value(reader);')
+    lines.append('                break;')
+    lines.append('        }')
+    lines.append('        if (!ok) {')
+    lines.append('            return false;')
+    lines.append('        }')
+    lines.append('    }')
+    lines.append('    return json_bind_end_object(reader);')
+    lines.append('}')
+    out.append('\n'.join(lines))
+    return function
+
+
+def read_field(field):
+    member = 'config->' + field['name']
+    if field['type'] == 'bool':
+        read = 'json_bind_read_bool(reader, &%s)' % member
+    elif field['type'] == 'int':
+        read = 'json_bind_read_int(reader, &%s)' % member
+    elif field['type'] == 'double':
+        read = 'json_bind_read_double(reader, &%s)' % member
+    else:
+        read = 'json_bind_read_string(reader, %s, sizeof(%s))' % (member, member)
+    return ['ok = %s;' % read, '*seen |= %s;' % field_bit(field)]
+
+
+def field_bit(field):
+    return '(UINT32_C(1) << %d)' % field['index']
+
+
+def serialize_ops(node):
+    """Flatten the tree into a list of ('raw', text) and ('field', field) operations."""
+    ops = [('raw', '{')]
+    for position, (key, child) in enumerate(node.items()):
+        ops.append(('raw', (',' if position else '') + json.dumps(key, ensure_ascii=False) + ':'))
+        if is_field(child):
+            ops.append(('field', child))
+        else:
+            ops.extend(serialize_ops(child))
+    ops.append(('raw', '}'))
+    return ops
+
+
+def merge_raw(ops):
+    merged = []
+    for op in ops:
+        if op[0] == 'raw' and merged and merged[-1][0] == 'raw':
+            merged[-1] = ('raw', merged[-1][1] + op[1])
+        else:
+            merged.append(op)
+    return merged
+
+
+def generate_header(schema):
+    name = schema['name']
+    lines = ['// Generated by tools/json_bindgen.py, do not edit.', '#pragma once', '',
+             '#include <stdbool.h>', '#include <stddef.h>', '#include "esp_err.h"', '',
+             'typedef struct {']
+    for field in schema['fields']:
+        if field['type'] == 'string':
+            lines.append('    char %s[%d];    // %s' % (field['name'], int(field['size']), field['path']))
+        else:
+            lines.append('    %s %s;    // %s' % (C_TYPES[field['type']], field['name'], field['path']))
+    lines.append('} %s_t;' % name)
+    lines.append('')
+    lines.append('// Parses the document into config. Returns ESP_FAIL if it is malformed or a value has the wrong type,')
+    lines.append('// ESP_ERR_NOT_FOUND if a required value is missing and ESP_ERR_INVALID_ARG if one is out of range.')
+    lines.append('// config is only written on success.')
+    lines.append('esp_err_t %s_parse(const char *json, size_t length, %s_t *config);' % (name, name))
+    lines.append('')
+    lines.append('// Writes config as JSON into buffer. Returns ESP_ERR_INVALID_SIZE if it doesn\'t fit, length (if not NULL)')
+    lines.append('// receives the length of the output without the terminating \'\\0\'.')
+    lines.append('esp_err_t %s_serialize(const %s_t *config, char *buffer, size_t size, size_t *length);' % (name, name))
+    return '\n'.join(lines) + '\n'
+
+
+def generate_source(schema):
+    name = schema['name']
+    fields = schema['fields']
+    tree = build_tree(fields)
+
+    out = ['// Generated by tools/json_bindgen.py, do not edit.\n'
+           '#include <stdint.h>\n#include <string.h>\n#include "json_bind.h"\n#include "%s.h"' % name]
+
+    required = [field for field in fields if not field.get('optional', False)]
+    mask = ' | '.join(field_bit(dict(field, index=fields.index(field))) for field in required) or '0'
+    out.append('#define REQUIRED_FIELDS (%s)' % mask)
+
+    functions = []
+    object_functions(name, tree, [], functions)
+    out.extend(functions)
+
+    lines = ['esp_err_t %s_parse(const char *json, size_t length, %s_t *config) {' % (name, name),
+             '    json_bind_reader_t reader;',
+             '    %s_t parsed;' % name,
+             '    uint32_t seen = 0;',
+             '',
+             '    memset(&parsed, 0, sizeof(parsed));',
+             '    json_bind_reader_init(&reader, json, length);',
+             '    if (!parse_object_root(&reader, &parsed, &seen) || !json_bind_end_document(&reader)) {',
+             '        return ESP_FAIL;',
+             '    }',
+             '    if ((seen & REQUIRED_FIELDS) != REQUIRED_FIELDS) {',
+             '        return ESP_ERR_NOT_FOUND;',
+             '    }']
+    for index, field in enumerate(fields):
+        checks = []
+        if 'min' in field:
+            checks.append('parsed.%s < %s' % (field['name'], field['min']))
+        if 'max' in field:
+            checks.append('parsed.%s > %s' % (field['name'], field['max']))
+        if checks:
+            condition = ' || '.join(checks)
+            if field.get('optional', False):
+                condition = '(seen & %s) && (%s)' % (field_bit(dict(field, index=index)), condition)
+            lines.append('    if (%s) {' % condition)
+            lines.append('        return ESP_ERR_INVALID_ARG;')
+            lines.append('    }')
+    lines.extend(['', '    *config = parsed;', '    return ESP_OK;', '}'])
+    out.append('\n'.join(lines))
+
+    lines = ['esp_err_t %s_serialize(const %s_t *config, char *buffer, size_t size, size_t *length) {' % (name, name),
+             '    json_bind_writer_t writer;',
+             '',
+             '    json_bind_writer_init(&writer, buffer, size);']
+    for op in merge_raw(serialize_ops(tree)):
+        if op[0] == 'raw':
+            lines.append('    json_bind_write_raw(&writer, %s, %d);' % (c_string(op[1]), len(op[1].encode())))
+        else:
+            lines.append('    json_bind_write_%s(&writer, config->%s);' % (op[1]['type'], op[1]['name']))
+    lines.append('    return json_bind_writer_finish(&writer, length);')
+    lines.append('}')
+    out.append('\n'.join(lines))
+
+    return '\n\n'.join(out) + '\n'
+
+
+def write_if_changed(path, text):
+    # keeps the timestamp (and so the build) stable if the output didn't change
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return
+    with open(path, 'w') as f:
+        f.write(text)
+
+
+def main():
+    if len(sys.argv) != 3:
+        fail('usage: json_bindgen.py <schema.json> <output dir>')
+    schema = load_schema(sys.argv[1])
+    os.makedirs(sys.argv[2], exist_ok=True)
+    write_if_changed(os.path.join(sys.argv[2], schema['name'] + '.h'), generate_header(schema))
+    write_if_changed(os.path.join(sys.argv[2], schema['name'] + '.c'), generate_source(schema))
+
+
+if __name__ == '__main__':
+    main()
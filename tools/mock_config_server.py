@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+"""Local stand-in for the alarm settings server, for the host benchmark (host/bench.c).
+
+    mock_config_server.py [--port 8080] [--certfile cert.pem --keyfile key.pem]
+
+Every GET returns the alarm settings document with an ETag. How the response is
+sent is chosen per request with query parameters, so one server covers all the
+scenarios in tools/run_host_bench.sh:
+
+    latency=MS      wait before sending the response headers
+    size=N          pad the document to about N bytes (an extra "padding" member)
+    chunked=1       Transfer-Encoding: chunked, in chunks of chunk=N bytes (default 256)
+    gzip=1          gzip the body if the request has Accept-Encoding: gzip
+    drip=MS         wait this long between chunks (slow link)
+    disconnect=N    close the connection after N bytes of the body
+    close=1         Connection: close after the response
+    unframed=1      neither Content-Length nor chunks, the body ends when the server closes the connection
+    drop_after=N    close kept-alive connections after N responses without answering the next request
+    redirect=1      answer with a 302 to the same URL without redirect=1
+    redirect_host=H answer with a 302 to the same URL on host H (name:port), e.g. a second server
+    status=N        answer with status N and a small HTML error page instead (GET and POST)
+
+If-None-Match with the current ETag gets a 304. POSTs are read and answered
+with 204, so the telemetry upload can point here too. A request without a Host
+header gets a 400, like from a virtual-hosted server.
+"""
+
+import argparse
+import gzip
+import hashlib
+import http.server
+import json
+import ssl
+import sys
+import time
+import urllib.parse
+
+SETTINGS = {'alarm': {'enabled': True, 'hour': 7, 'minute': 30}}
+
+
+def settings_document(size):
+    document = dict(SETTINGS)
+    body = json.dumps(document, separators=(',', ':')).encode()
+    if size > len(body):
+        document['padding'] = 'x' * (size - len(body) - len(',"padding":""'))
+        body = json.dumps(document, separators=(',', ':')).encode()
+    return body
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = 'HTTP/1.1'   # keep-alive unless a scenario says otherwise
+    server_version = 'mock_config_server'
+    disable_nagle_algorithm = True  # headers and body are separate writes, don't hold the body for an ACK
+
+    def setup(self):
+        super().setup()
+        self.answered = 0
+
+    def log_message(self, format, *args):
+        if self.server.verbose:
+            super().log_message(format, *args)
+
+    def options(self):
+        url = urllib.parse.urlsplit(self.path)
+        return url, {key: values[-1] for key, values in urllib.parse.parse_qs(url.query).items()}
+
+    def reject_without_host(self):
+        if self.headers.get('Host'):
+            return False
+        self.send_response(400)
+        self.send_header('Content-Length', '0')
+        self.end_headers()
+        return True
+
+    def send_error_page(self, status):
+        body = b'<html><body><h1>%d</h1></body></html>' % status
+        self.send_response(status)
+        self.send_header('Content-Type', 'text/html')
+        self.send_header('Content-Length', str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_GET(self):
+        if self.reject_without_host():
+            return
+        url, options = self.options()
+        drop_after = int(options.get('drop_after', 0))
+        if drop_after and self.answered >= drop_after:
+            # like a server whose keep-alive timeout ran out: the request gets no answer at all
+            self.close_connection = True
+            return
+        self.answered += 1
+
+        if 'latency' in options:
+            time.sleep(int(options['latency']) / 1000)
+        if 'status' in options:
+            self.send_error_page(int(options['status']))
+            return
+
+        if options.get('redirect') == '1' or 'redirect_host' in options:
+            query = urllib.parse.urlencode({k: v for k, v in options.items() if k not in ('redirect', 'redirect_host')})
+            location = url.path + ('?' + query if query else '')
+            if 'redirect_host' in options:
+                location = '%s://%s%s' % (self.server.scheme, options['redirect_host'], location)
+            self.send_response(302)
+            self.send_header('Location', location)
+            self.send_header('Content-Length', '0')
+            self.end_headers()
+            return
+
+        body = settings_document(int(options.get('size', 0)))
+        etag = '"%s"' % hashlib.sha1(body).hexdigest()[:16]
+        if self.headers.get('If-None-Match') == etag:
+            self.send_response(304)
+            self.send_header('ETag', etag)
+            self.end_headers()
+            return
+
+        encoded = body
+        gzipped = options.get('gzip') == '1' and 'gzip' in self.headers.get('Accept-Encoding', '')
+        if gzipped:
+            encoded = gzip.compress(body)
+
+        chunked = options.get('chunked') == '1'
+        unframed = options.get('unframed') == '1' and not chunked
+        self.send_response(200)
+        self.send_header('Content-Type', 'application/json')
+        self.send_header('ETag', etag)
+        if gzipped:
+            self.send_header('Content-Encoding', 'gzip')
+        if chunked:
+            self.send_header('Transfer-Encoding', 'chunked')
+        elif not unframed:
+            self.send_header('Content-Length', str(len(encoded)))
+        if options.get('close') == '1' or unframed:
+            self.send_header('Connection', 'close')
+            self.close_connection = True
+        self.end_headers()
+
+        limit = int(options.get('disconnect', len(encoded)))
+        if limit < len(encoded):
+            self.close_connection = True
+        self.send_body(encoded[:limit], chunked, int(options.get('chunk', 256)), int(options.get('drip', 0)),
+                       finish=limit >= len(encoded))
+
+    def send_body(self, body, chunked, chunk_size, drip_ms, finish):
+        step = chunk_size if (chunked or drip_ms) else max(len(body), 1)
+        for start in range(0, len(body), step):
+            piece = body[start:start + step]
+            if chunked:
+                piece = b'%x\r\n%s\r\n' % (len(piece), piece)
+            self.wfile.write(piece)
+            self.wfile.flush()
+            if drip_ms:
+                time.sleep(drip_ms / 1000)
+        if chunked and finish:
+            self.wfile.write(b'0\r\n\r\n')
+
+    def do_POST(self):
+        self.rfile.read(int(self.headers.get('Content-Length', 0)))
+        if self.reject_without_host():
+            return
+        self.answered += 1
+        options = self.options()[1]
+        if 'status' in options:
+            self.send_error_page(int(options['status']))
+            return
+        self.send_response(204)
+        self.end_headers()
+
+
+class Server(http.server.ThreadingHTTPServer):
+    daemon_threads = True
+    allow_reuse_address = True
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Mock alarm settings server for the host benchmark.')
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=8080)
+    parser.add_argument('--certfile', help='serve HTTPS with this certificate')
+    parser.add_argument('--keyfile')
+    parser.add_argument('--verbose', action='store_true', help='log every request')
+    args = parser.parse_args()
+
+    server = Server((args.host, args.port), Handler)
+    server.verbose = args.verbose
+    server.scheme = 'https' if args.certfile else 'http'
+    if args.certfile:
+        context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+        context.load_cert_chain(args.certfile, args.keyfile)
+        server.socket = context.wrap_socket(server.socket, server_side=True)
+
+    print('serving on %s://%s:%d' % (server.scheme, args.host, args.port), file=sys.stderr)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,96 @@
+#!/bin/sh
+# Builds the host benchmark (host/) and runs it against tools/mock_config_server.py, once per scenario.
+#
+#     tools/run_host_bench.sh [-t] [-n requests] [build dir]
+#
+#  -t  HTTPS with a throw-away self-signed certificate (needs openssl), to include the TLS handshake
+#
+# The numbers are for this machine's loopback, so compare scenarios with each other rather than with the device.
+set -e
+
+repo_dir=$(cd "$(dirname "$0")/.." && pwd)
+tls=0
+requests=50
+while getopts "tn:" option; do
+    case $option in
+        t) tls=1 ;;
+        n) requests=$OPTARG ;;
+        *) echo "usage: $0 [-t] [-n requests] [build dir]" >&2; exit 2 ;;
+    esac
+done
+shift $((OPTIND - 1))
+build_dir=${1:-"$repo_dir/build/host"}
+port=${BENCH_PORT:-8080}
+
+cmake -S "$repo_dir/host" -B "$build_dir" -DCMAKE_BUILD_TYPE=RelWithDebInfo >/dev/null
+cmake --build "$build_dir" >/dev/null
+bench="$build_dir/http_bench"
+
+# a second server stands for another host (the telemetry server, a redirect target): 127.0.0.2, with a
+# certificate of its own for that address
+scheme=http
+server_options=
+second_server_options=
+if [ $tls = 1 ]; then
+    scheme=https
+    openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj "/CN=localhost" -addext "subjectAltName=DNS:localhost" \
+        -keyout "$build_dir/key.pem" -out "$build_dir/cert.pem" 2>/dev/null
+    openssl req -x509 -newkey rsa:2048 -nodes -days 1 -subj "/CN=127.0.0.2" -addext "subjectAltName=IP:127.0.0.2" \
+        -keyout "$build_dir/second_key.pem" -out "$build_dir/second_cert.pem" 2>/dev/null
+    cat "$build_dir/cert.pem" "$build_dir/second_cert.pem" > "$build_dir/ca.pem"
+    server_options="--certfile $build_dir/cert.pem --keyfile $build_dir/key.pem"
+    second_server_options="--certfile $build_dir/second_cert.pem --keyfile $build_dir/second_key.pem"
+    export HTTP_SHIM_CA_FILE="$build_dir/ca.pem"
+fi
+
+python3 "$repo_dir/tools/mock_config_server.py" --port "$port" $server_options 2>/dev/null &
+server=$!
+python3 "$repo_dir/tools/mock_config_server.py" --host 127.0.0.2 --port "$port" $second_server_options 2>/dev/null &
+second_server=$!
+trap 'kill $server $second_server 2>/dev/null' EXIT INT TERM
+sleep 1
+
+url="$scheme://localhost:$port/config"
+second_host="127.0.0.2:$port"
+run() {
+    name=$1
+    shift
+    echo "==== $name"
+    "$bench" -n "$requests" "$@" 2>/dev/null | grep -v '^url' || true
+    echo
+}
+
+# the same with the DNS cache: connects to the cached address, checking the certificate against the name
+run_dns_cache() {
+    bench="$build_dir/http_bench_dns_cache"
+    run "$@"
+    bench="$build_dir/http_bench"
+}
+
+run "keep-alive"                        "$url"
+run "new session per request"       -s  "$url"
+run "conditional (304)"             -c  "$url"
+run "conditional, new session"      -c -s "$url"
+run "100 ms server latency"             "$url?latency=100"
+run "chunked, 64 byte chunks"           "$url?chunked=1&chunk=64"
+run "gzip"                              "$url?gzip=1"
+run "gzip, chunked"                     "$url?gzip=1&chunked=1&chunk=64"
+run "slow link, 10 ms per 64 bytes"     "$url?size=1024&drip=10&chunk=64"
+run "slow drip past a 500 ms budget (all fail)"  -b 500 "$url?size=1024&drip=100&chunk=64"
+run "64 KB body"                    -r  "$url?size=65536"
+run "64 KB body, gzip"              -r  "$url?size=65536&gzip=1"
+run "Connection: close"                 "$url?close=1"
+run "no length, ends at the close"      "$url?unframed=1"
+run "no length, gzip"                   "$url?unframed=1&gzip=1"
+run "server drops idle connections"     "$url?drop_after=1"
+run "redirect"                          "$url?redirect=1"
+run "redirect to a second host"         "$url?redirect_host=$second_host"
+run "POST to a second host"         -p "$scheme://$second_host/telemetry" "$url"
+run_dns_cache "DNS cache"                   "$url"
+run_dns_cache "DNS cache, redirect to a second host"  "$url?redirect_host=$second_host"
+run_dns_cache "DNS cache, POST to a second host"  -p "$scheme://$second_host/telemetry" "$url"
+run_dns_cache "DNS cache, POST to the same host"  -p "$scheme://localhost:$port/telemetry" "$url"
+run_dns_cache "DNS cache, address in the URL"   "$scheme://$second_host/config"
+run "truncated body (all fail)"         "$url?disconnect=10"
+run "503 with an error page (all fail)"  "$url?status=503"
+run "POST answered with 404 (all fail)" -p "$scheme://$second_host/telemetry?status=404" "$url"